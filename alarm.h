@@ -0,0 +1,308 @@
+/*
+  Header: alarm.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the local alarm: a buzzer and an LED driven with a pattern while a
+  sensor is outside its thresholds, and a silence button. It does not depend on the network, so
+  people nearby are warned even when the alert webhooks cannot be delivered.
+
+  Each sensor maps its low and high thresholds to a pattern (see AlarmPattern); the most urgent
+  pattern of all alarming sensors is played. The alarm follows the readings: it starts with the
+  first reading outside a threshold and stops with the first reading back in range.
+
+  Pressing the silence button (or "/alarm?silence=1") silences the buzzer for ALARM_SILENCE_MS for
+  the sensors alarming at that moment; the LED keeps showing their pattern. A sensor that starts
+  alarming afterwards, or moves to a more urgent pattern, sounds the buzzer again.
+
+  Usage:
+  - Call setupAlarmOutputs() once.
+  - Call updateAlarm() for each sensor after every read, before anything that may block.
+  - Call runAlarmOutputs() every ALARM_TICK_MS from a task of its own to play the patterns and
+    read the button.
+
+  Notes:
+  - The state is shared between the main loop, the alarm task and the web server with a single
+    writer per field: the loop owns the patterns and raise counters, the alarm task owns the
+    silencing, and the web server only counts silence requests.
+  - Only the Arduino GPIO functions are used, so the module can be compiled on a host against the
+    stubs in tools/host.
+*/
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include <stdint.h>
+#include <string.h>
+
+// GPIOs of the buzzer, the LED and the silence button (active low, with pull-up); -1 disables one.
+// May be set as build flags (e.g. -DALARM_BUZZER_PIN=27).
+#ifndef ALARM_BUZZER_PIN
+#define ALARM_BUZZER_PIN 25
+#endif
+#ifndef ALARM_LED_PIN
+#define ALARM_LED_PIN 2
+#endif
+#ifndef ALARM_BUTTON_PIN
+#define ALARM_BUTTON_PIN 0
+#endif
+
+// Period of runAlarmOutputs().
+const unsigned long ALARM_TICK_MS = 20;
+
+// Time the button must be stable to count as pressed.
+const unsigned long ALARM_DEBOUNCE_MS = 40;
+
+// Duration of a silence.
+const unsigned long ALARM_SILENCE_MS = 1800000; // 30 minutes
+
+// Number of sensors (MAX_SENSORS).
+const int ALARM_MAX_SENSORS = 8;
+
+// NVS namespace and key of the alarm rules.
+const char* ALARM_NVS_NAMESPACE = "alarm";
+const char* ALARM_NVS_KEY = "rules";
+
+// Alarm patterns, in increasing urgency.
+enum AlarmPattern {
+  ALARM_NONE,       // No alarm
+  ALARM_CHIRP,      // 0.1 s every 10 s
+  ALARM_SLOW,       // 0.5 s on, 0.5 s off
+  ALARM_FAST,       // 0.125 s on, 0.125 s off
+  ALARM_STEADY,     // Continuous
+  ALARM_PATTERN_COUNT
+};
+
+// On time and period of each pattern, in milliseconds.
+const unsigned long ALARM_PATTERN_ON_MS[ALARM_PATTERN_COUNT] = { 0, 100, 500, 125, 1 };
+const unsigned long ALARM_PATTERN_PERIOD_MS[ALARM_PATTERN_COUNT] = { 1, 10000, 1000, 250, 1 };
+
+// Patterns of a sensor's thresholds.
+struct AlarmRule {
+  uint8_t lowPattern;         // Played below the minimum temperature
+  uint8_t highPattern;        // Played above the maximum temperature
+};
+
+// Alarm rule of each sensor, persisted in NVS. Read and written by the main loop only.
+AlarmRule alarmRules[ALARM_MAX_SENSORS];
+
+// State of the local alarm.
+struct AlarmState {
+  // Written by the main loop.
+  volatile uint8_t pattern[ALARM_MAX_SENSORS];     // Current pattern of each sensor
+  volatile uint32_t raises[ALARM_MAX_SENSORS];     // Alarms started or escalated, per sensor
+  volatile unsigned long raisedMs;                 // Time of the last raise
+  // Written by the web server.
+  volatile uint32_t silenceRequests;
+  // Written by the alarm task.
+  uint32_t silencedRaises[ALARM_MAX_SENSORS];      // 'raises' of each sensor when it was silenced
+  volatile unsigned long silencedUntilMs;
+  volatile bool silenced;                          // A silence is running
+  uint32_t silenceRequestsHandled;
+  volatile uint32_t silences;                      // Silences from the button or the web server
+  bool buttonLevel;                                // Debounced button state (true when pressed)
+  bool buttonRaw;
+  unsigned long buttonChangedMs;
+  volatile uint8_t ledPattern;                     // Pattern on the LED
+  volatile uint8_t buzzerPattern;                  // Pattern on the buzzer
+  unsigned long patternStartMs;
+  uint32_t lastOutputRaises;                       // Sum of 'raises' when the outputs last changed
+  volatile unsigned long latencyMs;                // Time from the last raise to the outputs
+};
+
+AlarmState alarmState;
+
+/**
+ * Returns the name of an alarm pattern.
+ */
+const char* alarmPatternName(uint8_t pattern) {
+  switch (pattern) {
+    case ALARM_NONE: return "none";
+    case ALARM_CHIRP: return "chirp";
+    case ALARM_SLOW: return "slow";
+    case ALARM_FAST: return "fast";
+    case ALARM_STEADY: return "steady";
+    default: return "unknown";
+  }
+}
+
+/**
+ * Finds an alarm pattern by name.
+ *
+ * @return The pattern, or ALARM_PATTERN_COUNT if the name is unknown.
+ */
+AlarmPattern findAlarmPattern(const char* name) {
+  for (int p = 0; p < ALARM_PATTERN_COUNT; p++) {
+    if (strcmp(name, alarmPatternName(p)) == 0) {
+      return (AlarmPattern)p;
+    }
+  }
+  return ALARM_PATTERN_COUNT;
+}
+
+/**
+ * Sets the default rule of every sensor: a slow pattern below the minimum temperature and a fast
+ * one above the maximum.
+ */
+void defaultAlarmRules() {
+  for (int s = 0; s < ALARM_MAX_SENSORS; s++) {
+    alarmRules[s].lowPattern = ALARM_SLOW;
+    alarmRules[s].highPattern = ALARM_FAST;
+  }
+}
+
+/**
+ * Configures the alarm GPIOs, with the outputs off.
+ */
+void setupAlarmOutputs() {
+  if (ALARM_BUZZER_PIN >= 0) {
+    pinMode(ALARM_BUZZER_PIN, OUTPUT);
+    digitalWrite(ALARM_BUZZER_PIN, LOW);
+  }
+  if (ALARM_LED_PIN >= 0) {
+    pinMode(ALARM_LED_PIN, OUTPUT);
+    digitalWrite(ALARM_LED_PIN, LOW);
+  }
+  if (ALARM_BUTTON_PIN >= 0) {
+    pinMode(ALARM_BUTTON_PIN, INPUT_PULLUP);
+  }
+}
+
+/**
+ * Updates the alarm of a sensor from a new reading.
+ *
+ * @param sensor The sensor.
+ * @param centiC The reading in hundredths of a degree; an invalid reading keeps the alarm as it is.
+ * @param minCentiC The minimum temperature of the sensor.
+ * @param maxCentiC The maximum temperature of the sensor.
+ * @param invalid The value of an invalid reading.
+ * @param nowMs The current time in milliseconds.
+ * @return The pattern of the sensor.
+ */
+uint8_t updateAlarm(int sensor, int16_t centiC, int32_t minCentiC, int32_t maxCentiC, int16_t invalid, unsigned long nowMs) {
+  if (sensor < 0 || sensor >= ALARM_MAX_SENSORS) {
+    return ALARM_NONE;
+  }
+  uint8_t previous = alarmState.pattern[sensor];
+  if (centiC == invalid) {
+    return previous;
+  }
+  uint8_t pattern = ALARM_NONE;
+  if (centiC < minCentiC) {
+    pattern = alarmRules[sensor].lowPattern;
+  }
+  else if (centiC > maxCentiC) {
+    pattern = alarmRules[sensor].highPattern;
+  }
+  if (pattern > previous) {
+    alarmState.raisedMs = nowMs;
+    alarmState.raises[sensor] = alarmState.raises[sensor] + 1;
+  }
+  alarmState.pattern[sensor] = pattern;
+  return pattern;
+}
+
+/**
+ * Clears the alarm of a sensor that is no longer read (e.g. a removed sensor).
+ */
+void clearAlarm(int sensor) {
+  if (sensor >= 0 && sensor < ALARM_MAX_SENSORS) {
+    alarmState.pattern[sensor] = ALARM_NONE;
+  }
+}
+
+/**
+ * Requests a silence from another task than the alarm task (e.g. the web server).
+ */
+void requestAlarmSilence() {
+  alarmState.silenceRequests = alarmState.silenceRequests + 1;
+}
+
+/**
+ * Returns whether a sensor's alarm is silenced.
+ */
+bool alarmSilenced(int sensor) {
+  return alarmState.silenced && alarmState.silencedRaises[sensor] == alarmState.raises[sensor];
+}
+
+/**
+ * Returns whether a pattern drives its output at a time since the pattern started.
+ */
+bool alarmPatternOn(uint8_t pattern, unsigned long elapsedMs) {
+  if (pattern == ALARM_NONE || pattern >= ALARM_PATTERN_COUNT) {
+    return false;
+  }
+  return elapsedMs % ALARM_PATTERN_PERIOD_MS[pattern] < ALARM_PATTERN_ON_MS[pattern];
+}
+
+/**
+ * Plays the alarm patterns and reads the silence button; called every ALARM_TICK_MS by the alarm
+ * task.
+ */
+void runAlarmOutputs(unsigned long nowMs) {
+  AlarmState& state = alarmState;
+
+  bool pressed = false;
+  if (ALARM_BUTTON_PIN >= 0) {
+    bool raw = digitalRead(ALARM_BUTTON_PIN) == LOW;
+    if (raw != state.buttonRaw) {
+      state.buttonRaw = raw;
+      state.buttonChangedMs = nowMs;
+    }
+    if (raw != state.buttonLevel && nowMs - state.buttonChangedMs >= ALARM_DEBOUNCE_MS) {
+      state.buttonLevel = raw;
+      pressed = raw;
+    }
+  }
+  uint32_t requests = state.silenceRequests;
+  if (requests != state.silenceRequestsHandled) {
+    state.silenceRequestsHandled = requests;
+    pressed = true;
+  }
+  if (pressed) {
+    for (int s = 0; s < ALARM_MAX_SENSORS; s++) {
+      state.silencedRaises[s] = state.raises[s];
+    }
+    state.silencedUntilMs = nowMs + ALARM_SILENCE_MS;
+    state.silenced = true;
+    state.silences = state.silences + 1;
+  }
+  if (state.silenced && (long)(nowMs - state.silencedUntilMs) >= 0) {
+    state.silenced = false;
+  }
+
+  uint8_t led = ALARM_NONE;
+  uint8_t buzzer = ALARM_NONE;
+  uint32_t raises = 0;
+  for (int s = 0; s < ALARM_MAX_SENSORS; s++) {
+    uint8_t pattern = state.pattern[s];
+    raises += state.raises[s];
+    if (pattern > led) {
+      led = pattern;
+    }
+    if (pattern > buzzer && !alarmSilenced(s)) {
+      buzzer = pattern;
+    }
+  }
+  if (led != state.ledPattern) {
+    state.patternStartMs = nowMs;
+  }
+  if (raises != state.lastOutputRaises) {
+    state.lastOutputRaises = raises;
+    state.latencyMs = nowMs - state.raisedMs;
+  }
+  state.ledPattern = led;
+  state.buzzerPattern = buzzer;
+
+  unsigned long elapsed = nowMs - state.patternStartMs;
+  if (ALARM_LED_PIN >= 0) {
+    digitalWrite(ALARM_LED_PIN, alarmPatternOn(led, elapsed) ? HIGH : LOW);
+  }
+  if (ALARM_BUZZER_PIN >= 0) {
+    digitalWrite(ALARM_BUZZER_PIN, alarmPatternOn(buzzer, elapsed) ? HIGH : LOW);
+  }
+}
+
+#endif
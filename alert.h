@@ -0,0 +1,210 @@
+/*
+  Header: alert.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the threshold alert logic of a sensor: when a reading leaves the
+  sensor's range an alert is raised, and its notification is repeated every repeat period while
+  the reading is still out of range. The first reading back in range closes the alert; the next
+  excursion raises a new one. The logic only decides when to notify; sending the webhook is left
+  to the caller.
+
+  An open alert can be acknowledged: its repeats are then suppressed until the alert closes, or
+  until the end of a snooze if one was given, whichever comes first.
+
+  The state of an alert can be saved as an AlertRecord, with Unix times in place of the times
+  since boot, and restored after a reboot so the repeat schedule continues where it left off.
+
+  Usage:
+  - Keep one AlertState per sensor, zero-initialized.
+  - Call updateAlert() once per sample with the sensor's rule and reading, and send a
+    notification when it returns ALERT_RAISED or ALERT_REPEATED. Give a raised alert its id.
+    ALERT_RECOVERED reports that the alert was closed.
+  - Call acknowledgeAlert() to acknowledge an alert.
+  - Save alertRecord() when the state changed (see alertChanged()), and restore it at boot with
+    restoreAlert().
+
+  Notes:
+  - The logic does not depend on Arduino types so it can also be compiled on a host; the replay
+    tool in tools/ runs recorded traces through it.
+*/
+
+#ifndef ALERT_H
+#define ALERT_H
+
+#include <stdint.h>
+
+// NVS namespace and keys of the saved alert states.
+const char* ALERT_NVS_NAMESPACE = "alerts";
+const char* ALERT_NVS_RECORDS_KEY = "records";
+const char* ALERT_NVS_NEXT_ID_KEY = "nextId";
+
+// Alert thresholds and repeat period of a sensor.
+struct AlertRule {
+  float minC;
+  float maxC;
+  unsigned long repeatMs;
+};
+
+// Alert state of a sensor.
+struct AlertState {
+  bool active;                // An alert is open: raised and not recovered yet
+  unsigned long lastNotifyMs; // Time of the last notification or repeat check
+  uint32_t id;                // Id of the alert, given by the caller when raised
+  uint32_t startEpoch;        // Unix time the alert was raised (0 if unknown)
+  uint32_t lastNotifyEpoch;   // Unix time of lastNotifyMs (0 if unknown)
+  uint32_t ackUntilEpoch;     // Unix time until which the alert is acknowledged (0 if not)
+};
+
+// Saved alert state of a sensor (16 bytes). Times are Unix times, as the time since boot
+// restarts with the device; an alert is active if its id is not 0.
+struct AlertRecord {
+  uint32_t id;
+  uint32_t startEpoch;
+  uint32_t lastNotifyEpoch;
+  uint32_t ackUntilEpoch;
+};
+
+// Acknowledgment of an alert until it closes, without a snooze.
+const uint32_t ALERT_ACK_UNTIL_RECOVERY = 0xFFFFFFFF;
+
+// Notification decided by updateAlert().
+enum AlertAction {
+  ALERT_NONE,
+  ALERT_RAISED,    // First reading out of range
+  ALERT_REPEATED,  // Still out of range after the repeat period
+  ALERT_SUPPRESSED, // A repeat that is not sent, as the alert is acknowledged
+  ALERT_RECOVERED   // First reading back in range: the alert is closed
+};
+
+/**
+ * Returns the name of an alert action, used in reports.
+ */
+const char* alertActionName(AlertAction action) {
+  switch (action) {
+  case ALERT_RAISED:
+    return "raised";
+  case ALERT_REPEATED:
+    return "repeated";
+  case ALERT_SUPPRESSED:
+    return "suppressed";
+  case ALERT_RECOVERED:
+    return "cleared";
+  default:
+    return "none";
+  }
+}
+
+/**
+ * Checks a reading against a sensor's alert rule.
+ *
+ * A reading out of range raises an alert if none is open. The first reading back in range closes
+ * the open alert and its acknowledgment; the id and start time are kept for the caller until the
+ * next alert is raised.
+ *
+ * @param state The alert state of the sensor.
+ * @param rule The alert rule of the sensor.
+ * @param tempC The reading in Celsius.
+ * @param nowMs The time of the reading in milliseconds.
+ * @param epoch The time of the reading in seconds since the Unix epoch, or 0 if unknown.
+ * @return The notification to send, if any.
+ */
+AlertAction updateAlert(AlertState& state, const AlertRule& rule, float tempC, unsigned long nowMs, uint32_t epoch) {
+  bool outOfRange = tempC < rule.minC || tempC > rule.maxC;
+  if (!state.active) {
+    if (!outOfRange) {
+      return ALERT_NONE;
+    }
+    state.active = true;
+    state.lastNotifyMs = nowMs;
+    state.startEpoch = epoch;
+    state.lastNotifyEpoch = epoch;
+    state.ackUntilEpoch = 0;
+    return ALERT_RAISED;
+  }
+  if (!outOfRange) {
+    state.active = false;
+    state.ackUntilEpoch = 0;
+    return ALERT_RECOVERED;
+  }
+  bool snoozeEnded = state.ackUntilEpoch != ALERT_ACK_UNTIL_RECOVERY && epoch != 0 && epoch >= state.ackUntilEpoch;
+  if (state.ackUntilEpoch != 0 && snoozeEnded) {
+    state.ackUntilEpoch = 0;
+  }
+  if ((nowMs - state.lastNotifyMs) > rule.repeatMs) {
+    state.lastNotifyMs = nowMs;
+    state.lastNotifyEpoch = epoch;
+    return state.ackUntilEpoch != 0 ? ALERT_SUPPRESSED : ALERT_REPEATED;
+  }
+  return ALERT_NONE;
+}
+
+/**
+ * Acknowledges an active alert.
+ *
+ * @param state The alert state.
+ * @param epoch The current Unix time.
+ * @param snoozeSec The snooze duration in seconds, or 0 to acknowledge until the alert closes.
+ */
+void acknowledgeAlert(AlertState& state, uint32_t epoch, uint32_t snoozeSec) {
+  if (!state.active) {
+    return;
+  }
+  state.ackUntilEpoch = snoozeSec == 0 ? ALERT_ACK_UNTIL_RECOVERY : epoch + snoozeSec;
+}
+
+/**
+ * Returns the record to save for an alert state; a closed alert saves a cleared record.
+ */
+AlertRecord alertRecord(const AlertState& state) {
+  AlertRecord record = { 0, 0, 0, 0 };
+  if (state.active) {
+    record.id = state.id;
+    record.startEpoch = state.startEpoch;
+    record.lastNotifyEpoch = state.lastNotifyEpoch;
+    record.ackUntilEpoch = state.ackUntilEpoch;
+  }
+  return record;
+}
+
+/**
+ * Returns whether an alert state differs from its saved record.
+ */
+bool alertChanged(const AlertState& state, const AlertRecord& record) {
+  AlertRecord current = alertRecord(state);
+  return current.id != record.id || current.startEpoch != record.startEpoch ||
+    current.lastNotifyEpoch != record.lastNotifyEpoch || current.ackUntilEpoch != record.ackUntilEpoch;
+}
+
+/**
+ * Restores an alert state from its saved record after a reboot.
+ *
+ * The time of the last notification is placed as far in the past as it was at the current Unix
+ * time, so a repeat is due when it would have been without the reboot. If the time is unknown
+ * (clock not synchronized, or the record was saved without a time), the repeat period restarts now.
+ *
+ * @param state The alert state to restore.
+ * @param record The saved record.
+ * @param nowMs The current time in milliseconds since boot.
+ * @param epoch The current Unix time, or 0 if unknown.
+ */
+void restoreAlert(AlertState& state, const AlertRecord& record, unsigned long nowMs, uint32_t epoch) {
+  state.active = record.id != 0;
+  state.id = record.id;
+  state.startEpoch = record.startEpoch;
+  state.lastNotifyEpoch = record.lastNotifyEpoch;
+  state.ackUntilEpoch = record.ackUntilEpoch;
+  state.lastNotifyMs = nowMs;
+  if (state.active && epoch != 0 && record.lastNotifyEpoch != 0 && epoch >= record.lastNotifyEpoch) {
+    // Limited so the subtraction stays within the range of the millisecond clock.
+    uint32_t elapsed = epoch - record.lastNotifyEpoch;
+    if (elapsed > 2000000) {
+      elapsed = 2000000;
+    }
+    state.lastNotifyMs = nowMs - elapsed * 1000UL;
+  }
+}
+
+#endif
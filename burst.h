@@ -0,0 +1,241 @@
+/*
+  Header: burst.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides burst capture: a few sensors are sampled at a short interval (down to
+  one second) for a limited time into a preallocated buffer, separate from the sensor histories,
+  to diagnose fast events such as a defrost cycle or a leaking door seal. The regular sampling,
+  alerts and histories are not affected, and the burst ends by itself after its duration.
+
+  The capture can be streamed as CSV while it runs: a response follows the buffer, sending rows as
+  they are recorded, and completes when the burst ends. The buffer is kept until the next burst
+  starts, so a finished capture can be downloaded afterwards.
+
+  Usage:
+  - From the main loop, call startBurst() with the sensors, interval and duration, and stopBurst()
+    to end it early. A request from another task can check its parameters with checkBurst().
+  - In the main loop, when burstDue() returns true, read the burst sensors and pass their
+    readings to recordBurstRow().
+  - Stream or download the capture with a BurstStream and fillBurstResponse().
+
+  Notes:
+  - The module does not depend on Arduino types so it can also be compiled on a host.
+  - Rows are written by the main loop and read by the web server task: a row is complete before
+    the row count includes it, and a stream stops if a new burst replaces the one it follows.
+  - The burst is only started and stopped by the main loop, so the burst state never changes
+    while the loop samples it.
+*/
+
+#ifndef BURST_H
+#define BURST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Maximum number of sensors in a burst.
+const int BURST_MAX_SENSORS = 4;
+
+// Capacity of the burst buffer: 30 minutes at one sample per second.
+const int BURST_MAX_ROWS = 1800;
+
+// Shortest and longest sampling interval of a burst.
+const unsigned long BURST_MIN_INTERVAL_MS = 1000;
+const unsigned long BURST_MAX_INTERVAL_MS = 60000;
+
+// A row of the burst buffer.
+struct BurstRow {
+  uint32_t offsetMs;                     // Time since the start of the burst
+  int16_t centiC[BURST_MAX_SENSORS];     // Reading of each burst sensor, in hundredths of a degree
+};
+
+// State of the current or last burst.
+struct BurstState {
+  volatile uint32_t id;        // Number of the burst, 0 before the first one
+  volatile bool active;        // The burst is sampling
+  volatile int rows;           // Rows recorded
+  int maxRows;                 // Rows planned for the duration
+  int sensorCount;
+  int sensors[BURST_MAX_SENSORS];
+  unsigned long intervalMs;
+  unsigned long startMs;       // millis() at the start
+  unsigned long nextMs;        // millis() of the next row
+  time_t startEpoch;           // Time of the start (0 if the clock is not synchronized)
+};
+
+BurstState burst;
+
+// Preallocated burst buffer.
+BurstRow burstRows[BURST_MAX_ROWS];
+
+/**
+ * Streaming state of a burst capture response.
+ */
+struct BurstStream {
+  uint32_t id;         // Burst being streamed
+  int row;             // Next row to send
+  bool started;        // The header line was produced
+  char pending[96];    // Formatted output not yet copied into a chunk
+  size_t pendingLen;
+  size_t pendingPos;
+};
+
+/**
+ * Checks the parameters of a burst.
+ *
+ * @return An error message, or nullptr if a burst can start with them.
+ */
+const char* checkBurst(int sensorCount, unsigned long intervalMs, unsigned long durationMs) {
+  if (sensorCount < 1 || sensorCount > BURST_MAX_SENSORS) {
+    return "A burst takes 1 to 4 sensors";
+  }
+  if (intervalMs < BURST_MIN_INTERVAL_MS || intervalMs > BURST_MAX_INTERVAL_MS) {
+    return "Invalid interval";
+  }
+  unsigned long rows = durationMs / intervalMs;
+  if (rows < 1 || rows > (unsigned long)BURST_MAX_ROWS) {
+    return "Invalid duration";
+  }
+  return nullptr;
+}
+
+/**
+ * Starts a burst, replacing the previous capture.
+ *
+ * @param sensors The sensors to sample.
+ * @param sensorCount The number of sensors (1 to BURST_MAX_SENSORS).
+ * @param intervalMs The sampling interval.
+ * @param durationMs The duration of the burst; limited to BURST_MAX_ROWS samples.
+ * @param nowMs The current time in milliseconds.
+ * @param epoch The current time in seconds since the Unix epoch, or 0 if unknown.
+ * @return An error message, or nullptr if the burst started.
+ */
+const char* startBurst(const int* sensors, int sensorCount, unsigned long intervalMs, unsigned long durationMs, unsigned long nowMs, time_t epoch) {
+  const char* error = checkBurst(sensorCount, intervalMs, durationMs);
+  if (error != nullptr) {
+    return error;
+  }
+  burst.active = false;
+  burst.id = burst.id + 1;
+  burst.rows = 0;
+  burst.maxRows = (int)(durationMs / intervalMs);
+  burst.sensorCount = sensorCount;
+  memcpy(burst.sensors, sensors, sensorCount * sizeof(int));
+  burst.intervalMs = intervalMs;
+  burst.startMs = nowMs;
+  burst.nextMs = nowMs;
+  burst.startEpoch = epoch;
+  burst.active = true;
+  return nullptr;
+}
+
+/**
+ * Stops the current burst; the rows recorded so far are kept.
+ */
+void stopBurst() {
+  burst.active = false;
+}
+
+/**
+ * Returns whether a burst row is due, and schedules the next one.
+ */
+bool burstDue(unsigned long nowMs) {
+  if (!burst.active || (long)(nowMs - burst.nextMs) < 0) {
+    return false;
+  }
+  burst.nextMs = burst.startMs + ((nowMs - burst.startMs) / burst.intervalMs + 1) * burst.intervalMs;
+  return true;
+}
+
+/**
+ * Records a row of the burst; the burst ends after its last row.
+ *
+ * @param nowMs The time of the readings in milliseconds.
+ * @param centiC The latest reading of every sensor, indexed by sensor.
+ */
+void recordBurstRow(unsigned long nowMs, const int16_t* centiC) {
+  if (!burst.active || burst.rows >= burst.maxRows) {
+    burst.active = false;
+    return;
+  }
+  BurstRow& row = burstRows[burst.rows];
+  row.offsetMs = nowMs - burst.startMs;
+  for (int i = 0; i < burst.sensorCount; i++) {
+    row.centiC[i] = centiC[burst.sensors[i]];
+  }
+  burst.rows = burst.rows + 1;
+  if (burst.rows >= burst.maxRows) {
+    burst.active = false;
+  }
+}
+
+/**
+ * Produces the next part of a burst capture in CSV: a header "ms,epoch,s<N>,...", then one line per
+ * row with the time since the start, the Unix time and each reading in Celsius ("--" if invalid).
+ *
+ * While the burst is sampling and all recorded rows were sent, 'tryAgain' is returned so the
+ * caller can wait for more rows without blocking.
+ *
+ * @param bs The stream state.
+ * @param buffer The chunk buffer to fill.
+ * @param maxLen The size of the chunk buffer.
+ * @param invalid The value of an invalid reading.
+ * @param tryAgain The value to return while waiting for rows.
+ * @return The number of bytes written, 0 when the capture is complete, or 'tryAgain'.
+ */
+size_t fillBurstResponse(BurstStream& bs, uint8_t* buffer, size_t maxLen, int16_t invalid, size_t tryAgain) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (bs.pendingPos < bs.pendingLen) {
+      size_t n = maxLen - written < bs.pendingLen - bs.pendingPos ? maxLen - written : bs.pendingLen - bs.pendingPos;
+      memcpy(buffer + written, bs.pending + bs.pendingPos, n);
+      written += n;
+      bs.pendingPos += n;
+      continue;
+    }
+    if (burst.id != bs.id) {
+      break;
+    }
+
+    bs.pendingPos = 0;
+    bs.pendingLen = 0;
+    if (!bs.started) {
+      bs.started = true;
+      bs.pendingLen = snprintf(bs.pending, sizeof(bs.pending), "ms,epoch");
+      for (int i = 0; i < burst.sensorCount; i++) {
+        bs.pendingLen += snprintf(bs.pending + bs.pendingLen, sizeof(bs.pending) - bs.pendingLen, ",s%d", burst.sensors[i]);
+      }
+      bs.pendingLen += snprintf(bs.pending + bs.pendingLen, sizeof(bs.pending) - bs.pendingLen, "\n");
+      continue;
+    }
+    bool active = burst.active;
+    if (bs.row >= burst.rows) {
+      if (active && written == 0) {
+        return tryAgain;
+      }
+      break;
+    }
+
+    const BurstRow& row = burstRows[bs.row++];
+    unsigned long epoch = burst.startEpoch ? (unsigned long)(burst.startEpoch + row.offsetMs / 1000) : 0;
+    bs.pendingLen = snprintf(bs.pending, sizeof(bs.pending), "%lu,%lu", (unsigned long)row.offsetMs, epoch);
+    for (int i = 0; i < burst.sensorCount; i++) {
+      int16_t value = row.centiC[i];
+      if (value == invalid) {
+        bs.pendingLen += snprintf(bs.pending + bs.pendingLen, sizeof(bs.pending) - bs.pendingLen, ",--");
+      }
+      else {
+        bs.pendingLen += snprintf(bs.pending + bs.pendingLen, sizeof(bs.pending) - bs.pendingLen, ",%s%d.%02d", value < 0 ? "-" : "", abs(value) / 100, abs(value) % 100);
+      }
+    }
+    bs.pendingLen += snprintf(bs.pending + bs.pendingLen, sizeof(bs.pending) - bs.pendingLen, "\n");
+  }
+  return written;
+}
+
+#endif
@@ -0,0 +1,276 @@
+/*
+  Header: calib.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides per-probe calibration for the DS18B20 sensors. DS18B20 probes are
+  only accurate to +/-0.5 C out of the box; a calibration maps the raw reading of a probe to
+  the reference temperature, either as a linear correction (offset and gain) or as a
+  piecewise-linear table of up to CALIB_MAX_POINTS reference points.
+
+  Calibrations are keyed by the 64-bit ROM address of the probe, so they follow the probe
+  when it is moved to another position on the bus. They are applied in fixed point
+  (hundredths of a degree) during sampling and persisted in NVS with the Preferences library.
+
+  Usage:
+  - Call loadCalibrations() once at boot, before the sensors are set up.
+  - Look up a probe's entry with findCalibration() and apply it with applyCalibration().
+  - Change entries with setCalibration() / removeCalibration(); both persist the table, so they
+    are only called from the main loop. checkCalibration() validates an entry beforehand.
+  - twoPointCalibration() computes a linear calibration from two reference measurements.
+
+  Notes:
+  - A linear calibration is: corrected = raw * gain + offset, with gain in Q16.16 fixed point.
+  - A table calibration interpolates between its points and extrapolates from the end segments.
+*/
+
+#ifndef CALIB_H
+#define CALIB_H
+
+// Maximum number of probes with a stored calibration.
+const int CALIB_MAX_ENTRIES = 16;
+
+// Maximum number of points of a calibration table.
+const int CALIB_MAX_POINTS = 8;
+
+// Fixed point scale of the linear gain (Q16.16).
+const int32_t CALIB_GAIN_ONE = 65536;
+
+// NVS namespace and key of the calibration table.
+const char* CALIB_NVS_NAMESPACE = "calib";
+const char* CALIB_NVS_KEY = "table";
+
+// Kind of correction stored in a calibration entry.
+enum CalibrationMode {
+  CALIB_NONE,       // Entry unused
+  CALIB_LINEAR,     // Offset and gain
+  CALIB_TABLE       // Piecewise-linear table
+};
+
+// Calibration of one probe.
+struct Calibration {
+  uint8_t rom[8];                   // ROM address of the probe
+  uint8_t mode;                     // CalibrationMode
+  uint8_t points;                   // Number of table points
+  int32_t gain;                     // Linear gain in Q16.16
+  int16_t offset;                   // Linear offset in hundredths of a degree
+  int16_t raw[CALIB_MAX_POINTS];    // Table: raw readings, ascending, in hundredths of a degree
+  int16_t ref[CALIB_MAX_POINTS];    // Table: reference temperatures in hundredths of a degree
+};
+
+// Calibration table, persisted in NVS.
+Calibration calibrations[CALIB_MAX_ENTRIES];
+
+/**
+ * Loads the calibration table from NVS.
+ */
+void loadCalibrations() {
+  Preferences prefs;
+  memset(calibrations, 0, sizeof(calibrations));
+  if (prefs.begin(CALIB_NVS_NAMESPACE, true)) {
+    if (prefs.getBytesLength(CALIB_NVS_KEY) == sizeof(calibrations)) {
+      prefs.getBytes(CALIB_NVS_KEY, calibrations, sizeof(calibrations));
+    }
+    prefs.end();
+  }
+}
+
+/**
+ * Saves the calibration table to NVS.
+ *
+ * @return True if the table was written.
+ */
+bool saveCalibrations() {
+  Preferences prefs;
+  if (!prefs.begin(CALIB_NVS_NAMESPACE, false)) {
+    return false;
+  }
+  bool ok = prefs.putBytes(CALIB_NVS_KEY, calibrations, sizeof(calibrations)) == sizeof(calibrations);
+  prefs.end();
+  return ok;
+}
+
+/**
+ * Finds the calibration of a probe.
+ *
+ * @param rom The ROM address of the probe.
+ * @return The index of the entry in 'calibrations', or -1 if the probe is not calibrated.
+ */
+int findCalibration(const uint8_t* rom) {
+  for (int i = 0; i < CALIB_MAX_ENTRIES; i++) {
+    if (calibrations[i].mode != CALIB_NONE && memcmp(calibrations[i].rom, rom, 8) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Returns the name of a calibration, used in JSON output.
+ *
+ * @param index The index of the entry, or -1 for an uncalibrated probe.
+ */
+const char* calibrationName(int index) {
+  if (index < 0) {
+    return "none";
+  }
+  const Calibration& c = calibrations[index];
+  if (c.mode == CALIB_TABLE) {
+    return "table";
+  }
+  return (c.gain == CALIB_GAIN_ONE) ? "offset" : "linear";
+}
+
+/**
+ * Applies a calibration to a raw reading.
+ *
+ * @param index The index of the entry, or -1 for an uncalibrated probe.
+ * @param centi The raw reading in hundredths of a degree.
+ * @return The corrected reading in hundredths of a degree, clamped to the int16_t range.
+ */
+int16_t applyCalibration(int index, int16_t centi) {
+  if (index < 0) {
+    return centi;
+  }
+  const Calibration& c = calibrations[index];
+  int64_t value = centi;
+
+  if (c.mode == CALIB_LINEAR) {
+    value = ((int64_t)centi * c.gain) / CALIB_GAIN_ONE + c.offset;
+  }
+  else if (c.mode == CALIB_TABLE && c.points == 1) {
+    value = (int64_t)centi + c.ref[0] - c.raw[0];
+  }
+  else if (c.mode == CALIB_TABLE && c.points > 1) {
+    int i = 0;
+    while (i < c.points - 2 && centi > c.raw[i + 1]) {
+      i++;
+    }
+    int32_t dx = c.raw[i + 1] - c.raw[i];
+    value = c.ref[i] + ((int64_t)(centi - c.raw[i]) * (c.ref[i + 1] - c.ref[i])) / dx;
+  }
+
+  if (value <= INT16_MIN) {
+    return INT16_MIN + 1;
+  }
+  if (value > INT16_MAX) {
+    return INT16_MAX;
+  }
+  return (int16_t)value;
+}
+
+/**
+ * Checks a calibration without storing it.
+ *
+ * Table points are sorted by raw reading; raw readings must be distinct.
+ *
+ * @param entry The calibration, with the ROM address set; its table points are sorted.
+ * @return nullptr if the calibration is valid, or a short description of the error.
+ */
+const char* checkCalibration(Calibration& entry) {
+  if (entry.mode == CALIB_TABLE) {
+    if (entry.points < 1 || entry.points > CALIB_MAX_POINTS) {
+      return "invalid number of points";
+    }
+    for (int i = 1; i < entry.points; i++) {
+      for (int j = i; j > 0 && entry.raw[j - 1] > entry.raw[j]; j--) {
+        int16_t raw = entry.raw[j];
+        int16_t ref = entry.ref[j];
+        entry.raw[j] = entry.raw[j - 1];
+        entry.ref[j] = entry.ref[j - 1];
+        entry.raw[j - 1] = raw;
+        entry.ref[j - 1] = ref;
+      }
+    }
+    for (int i = 1; i < entry.points; i++) {
+      if (entry.raw[i] == entry.raw[i - 1]) {
+        return "duplicate raw reading";
+      }
+    }
+  }
+  else if (entry.mode == CALIB_LINEAR) {
+    if (entry.gain < CALIB_GAIN_ONE / 2 || entry.gain > CALIB_GAIN_ONE * 2) {
+      return "gain out of range";
+    }
+  }
+  else {
+    return "invalid mode";
+  }
+
+  int index = findCalibration(entry.rom);
+  for (int i = 0; i < CALIB_MAX_ENTRIES && index < 0; i++) {
+    if (calibrations[i].mode == CALIB_NONE) {
+      index = i;
+    }
+  }
+  if (index < 0) {
+    return "calibration table full";
+  }
+  return nullptr;
+}
+
+/**
+ * Stores a calibration for a probe, replacing any previous one, and persists the table.
+ *
+ * @param entry The calibration, with the ROM address set.
+ * @return nullptr on success, or a short description of the error.
+ */
+const char* setCalibration(Calibration entry) {
+  const char* error = checkCalibration(entry);
+  if (error != nullptr) {
+    return error;
+  }
+
+  int index = findCalibration(entry.rom);
+  for (int i = 0; i < CALIB_MAX_ENTRIES && index < 0; i++) {
+    if (calibrations[i].mode == CALIB_NONE) {
+      index = i;
+    }
+  }
+  calibrations[index] = entry;
+  if (!saveCalibrations()) {
+    return "could not save calibration";
+  }
+  return nullptr;
+}
+
+/**
+ * Removes the calibration of a probe and persists the table.
+ *
+ * @param rom The ROM address of the probe.
+ * @return True if the probe had a calibration.
+ */
+bool removeCalibration(const uint8_t* rom) {
+  int index = findCalibration(rom);
+  if (index < 0) {
+    return false;
+  }
+  memset(&calibrations[index], 0, sizeof(Calibration));
+  saveCalibrations();
+  return true;
+}
+
+/**
+ * Computes a linear calibration from two reference measurements.
+ *
+ * @param entry Receives the gain and offset; the ROM address is left unchanged.
+ * @param raw1 The raw reading at the first reference, in hundredths of a degree.
+ * @param ref1 The first reference temperature, in hundredths of a degree.
+ * @param raw2 The raw reading at the second reference, in hundredths of a degree.
+ * @param ref2 The second reference temperature, in hundredths of a degree.
+ * @return nullptr on success, or a short description of the error.
+ */
+const char* twoPointCalibration(Calibration& entry, int16_t raw1, int16_t ref1, int16_t raw2, int16_t ref2) {
+  if (abs(raw2 - raw1) < 100) {
+    return "reference points must be at least 1 C apart";
+  }
+  entry.mode = CALIB_LINEAR;
+  entry.points = 0;
+  entry.gain = (int32_t)(((int64_t)(ref2 - ref1) * CALIB_GAIN_ONE) / (raw2 - raw1));
+  entry.offset = (int16_t)(ref1 - ((int64_t)raw1 * entry.gain) / CALIB_GAIN_ONE);
+  return nullptr;
+}
+
+#endif
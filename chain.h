@@ -0,0 +1,305 @@
+/*
+  Header: chain.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the tamper-evident reading log: every stored reading is appended to
+  a block, and each full block is sealed with a SHA-256 hash over the hash of the previous block,
+  the block's sequence number and its readings. Altering, removing or reordering a reading
+  breaks every hash after it, so a verifier holding the latest hash (an anchor) can prove that
+  the readings it was given are the ones the device stored.
+
+  The last sealed hash and its sequence number are persisted in NVS every CHAIN_SAVE_BLOCKS seals
+  or CHAIN_SAVE_MS, whichever comes first, and at the first seal after a boot, so the chain
+  continues across reboots without a flash write per seal. The blocks sealed after the last save
+  are lost at a reboot; the chain then restarts CHAIN_SAVE_BLOCKS sequence numbers after the saved
+  head, linked to its hash, so no sequence number is reused and a verifier sees a gap instead of
+  two different blocks with the same number. The head is published as an anchor in the
+  heartbeats and alert webhooks.
+  The sealed blocks are kept in a ring of CHAIN_BLOCKS blocks, which is exported for offline
+  verification by tools/chain_verify.cpp.
+
+  Block hash (all integers little-endian):
+    SHA-256(prevHash[32] | seq u32 | count u32 | count * (epoch u32 | sensor u8 | 0 u8 | centiC i16))
+  The first block of a device links to a previous hash of 32 zero bytes.
+
+  Usage:
+  - Call startChain() with the head loaded from NVS.
+  - Call appendChainRecord() for each stored reading; when it returns true, call sealChainBlock(),
+    then save the new head if chainHeadSaveDue() and mark it with chainHeadSaved().
+  - Copy sealed blocks out with copyChainBlock(), which detects blocks overwritten meanwhile, or
+    export them with startChainExport() and fillChainExport().
+
+  Notes:
+  - The includer provides chainSha256(): the firmware uses the ESP32 hardware SHA accelerator
+    through mbedtls, the host verifier a software implementation.
+  - The module does not depend on Arduino types, so it can be compiled on a host.
+*/
+
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+// Readings per block.
+const int CHAIN_BLOCK_RECORDS = 16;
+
+// Sealed blocks kept for export (200 bytes each); may be set as a build flag.
+#ifndef CHAIN_BLOCKS
+#define CHAIN_BLOCKS 32
+#endif
+
+// Size of a SHA-256 hash.
+const int CHAIN_HASH_SIZE = 32;
+
+// Largest hashed message of a block.
+const int CHAIN_MESSAGE_SIZE = CHAIN_HASH_SIZE + 8 + CHAIN_BLOCK_RECORDS * 8;
+
+// The head is saved after this many seals, or this long after the last save.
+const uint32_t CHAIN_SAVE_BLOCKS = 16;
+const uint32_t CHAIN_SAVE_MS = 15 * 60 * 1000UL;
+
+// NVS namespace and key of the chain head.
+const char* CHAIN_NVS_NAMESPACE = "chain";
+const char* CHAIN_NVS_KEY = "head";
+
+// Computes the SHA-256 hash of a message; provided by the includer.
+void chainSha256(const uint8_t* data, size_t len, uint8_t hash[CHAIN_HASH_SIZE]);
+
+// A stored reading.
+struct ChainRecord {
+  uint32_t epoch;
+  uint8_t sensor;
+  uint8_t reserved;
+  int16_t centiC;
+};
+
+// A sealed block.
+struct ChainBlock {
+  volatile uint32_t seq;      // Sequence number, 0 while the slot is being written
+  uint32_t count;             // Readings in the block
+  uint8_t prevHash[CHAIN_HASH_SIZE];
+  uint8_t hash[CHAIN_HASH_SIZE];
+  ChainRecord records[CHAIN_BLOCK_RECORDS];
+};
+
+// Last sealed block, persisted in NVS.
+struct ChainHead {
+  uint32_t seq;               // 0 before the first block
+  uint8_t hash[CHAIN_HASH_SIZE];
+};
+
+// State of the chain, written by the main loop only.
+struct ChainState {
+  ChainBlock blocks[CHAIN_BLOCKS];
+  ChainRecord pending[CHAIN_BLOCK_RECORDS];  // Readings of the block being filled
+  int pendingCount;
+  ChainHead head;
+  volatile uint32_t sealed;   // Sequence number of the last sealed block (head.seq)
+  uint32_t firstSeq;          // First block sealed since boot
+  uint32_t seals;             // Blocks sealed since boot
+  uint32_t savedSeq;          // Sequence number of the head last saved
+  uint32_t savedMs;           // Time of the last save
+  unsigned long lastHashUs;   // Time taken by the last seal
+  unsigned long maxHashUs;
+};
+
+/**
+ * Starts the chain after the last saved block. Up to CHAIN_SAVE_BLOCKS - 1 blocks may have been
+ * sealed after it, so the first block sealed continues CHAIN_SAVE_BLOCKS sequence numbers later.
+ *
+ * @param state The chain state.
+ * @param head The last sealed block, as persisted; a zero head starts a new chain.
+ */
+void startChain(ChainState& state, const ChainHead& head) {
+  memset(&state, 0, sizeof(state));
+  state.head = head;
+  state.sealed = head.seq;
+  state.firstSeq = head.seq == 0 ? 1 : head.seq + CHAIN_SAVE_BLOCKS;
+  state.savedSeq = head.seq;
+}
+
+/**
+ * Appends a reading to the block being filled.
+ *
+ * @return Whether the block is full and must be sealed.
+ */
+bool appendChainRecord(ChainState& state, uint32_t epoch, int sensor, int16_t centiC) {
+  ChainRecord& record = state.pending[state.pendingCount++];
+  record.epoch = epoch;
+  record.sensor = sensor;
+  record.reserved = 0;
+  record.centiC = centiC;
+  return state.pendingCount >= CHAIN_BLOCK_RECORDS;
+}
+
+/**
+ * Writes an integer in little-endian order.
+ */
+uint8_t* chainPut(uint8_t* p, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    *p++ = (uint8_t)(value >> (8 * i));
+  }
+  return p;
+}
+
+/**
+ * Computes the hash of a block from its previous hash, sequence number and readings.
+ */
+void hashChainBlock(uint32_t seq, const uint8_t prevHash[CHAIN_HASH_SIZE], const ChainRecord* records, uint32_t count, uint8_t hash[CHAIN_HASH_SIZE]) {
+  uint8_t message[CHAIN_MESSAGE_SIZE];
+  uint8_t* p = message;
+  memcpy(p, prevHash, CHAIN_HASH_SIZE);
+  p += CHAIN_HASH_SIZE;
+  p = chainPut(p, seq, 4);
+  p = chainPut(p, count, 4);
+  for (uint32_t i = 0; i < count && i < (uint32_t)CHAIN_BLOCK_RECORDS; i++) {
+    p = chainPut(p, records[i].epoch, 4);
+    p = chainPut(p, records[i].sensor, 1);
+    p = chainPut(p, 0, 1);
+    p = chainPut(p, (uint16_t)records[i].centiC, 2);
+  }
+  chainSha256(message, p - message, hash);
+}
+
+/**
+ * Seals the block being filled into the ring and makes it the head.
+ *
+ * @return The sealed block.
+ */
+const ChainBlock& sealChainBlock(ChainState& state) {
+  uint32_t seq = state.seals == 0 ? state.firstSeq : state.head.seq + 1;
+  ChainBlock& block = state.blocks[seq % CHAIN_BLOCKS];
+  block.seq = 0;
+  block.count = state.pendingCount;
+  memcpy(block.prevHash, state.head.hash, CHAIN_HASH_SIZE);
+  memcpy(block.records, state.pending, sizeof(block.records));
+  hashChainBlock(seq, block.prevHash, block.records, block.count, block.hash);
+  block.seq = seq;
+
+  state.head.seq = seq;
+  memcpy(state.head.hash, block.hash, CHAIN_HASH_SIZE);
+  state.sealed = seq;
+  state.pendingCount = 0;
+  state.seals++;
+  return block;
+}
+
+/**
+ * Returns whether the head must be saved: at the first seal after a boot, CHAIN_SAVE_BLOCKS seals
+ * after the last save, or CHAIN_SAVE_MS after it.
+ */
+bool chainHeadSaveDue(const ChainState& state, uint32_t nowMs) {
+  return state.savedSeq < state.firstSeq || state.head.seq - state.savedSeq >= CHAIN_SAVE_BLOCKS || nowMs - state.savedMs >= CHAIN_SAVE_MS;
+}
+
+/**
+ * Records that the head was saved.
+ */
+void chainHeadSaved(ChainState& state, uint32_t nowMs) {
+  state.savedSeq = state.head.seq;
+  state.savedMs = nowMs;
+}
+
+/**
+ * Returns the oldest block still in the ring.
+ */
+uint32_t oldestChainBlock(const ChainState& state) {
+  uint32_t sealed = state.sealed;
+  uint32_t oldest = sealed >= (uint32_t)CHAIN_BLOCKS ? sealed - CHAIN_BLOCKS + 1 : 1;
+  return oldest > state.firstSeq ? oldest : state.firstSeq;
+}
+
+/**
+ * Copies a sealed block out of the ring, from another task than the main loop.
+ *
+ * @return false if the block is not in the ring, or was overwritten during the copy.
+ */
+bool copyChainBlock(const ChainState& state, uint32_t seq, ChainBlock& copy) {
+  if (seq == 0 || seq < oldestChainBlock(state) || seq > state.sealed) {
+    return false;
+  }
+  const ChainBlock& block = state.blocks[seq % CHAIN_BLOCKS];
+  if (block.seq != seq) {
+    return false;
+  }
+  memcpy((void*)&copy, (const void*)&block, sizeof(copy));
+  return block.seq == seq && copy.seq == seq;
+}
+
+/**
+ * Formats a hash as 64 hexadecimal digits.
+ */
+void chainHashHex(const uint8_t hash[CHAIN_HASH_SIZE], char hex[2 * CHAIN_HASH_SIZE + 1]) {
+  for (int i = 0; i < CHAIN_HASH_SIZE; i++) {
+    snprintf(hex + 2 * i, 3, "%02x", hash[i]);
+  }
+}
+
+// Export of the sealed blocks, produced in chunks. Each block is a line
+// "B,<seq>,<count>,<prevHash>,<hash>" followed by a line "R,<epoch>,<sensor>,<centiC>" per reading,
+// with hashes in hexadecimal and readings in hundredths of a degree (-32768 if invalid).
+struct ChainExport {
+  uint32_t next;              // Next block to export
+  uint32_t last;              // Last block to export
+  bool finished;
+  char pending[640];          // Formatted block not yet copied into a chunk
+  size_t pendingLen;
+  size_t pendingPos;
+};
+
+/**
+ * Starts an export of the blocks sealed so far, from a sequence number or the oldest block kept.
+ */
+void startChainExport(const ChainState& state, ChainExport& ex, uint32_t from) {
+  memset(&ex, 0, sizeof(ex));
+  uint32_t oldest = oldestChainBlock(state);
+  ex.next = from > oldest ? from : oldest;
+  ex.last = state.sealed;
+}
+
+/**
+ * Produces the next part of an export. A block overwritten before it was copied ends the export.
+ *
+ * @return The number of bytes written, or 0 when the export is complete.
+ */
+size_t fillChainExport(const ChainState& state, ChainExport& ex, uint8_t* buffer, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (ex.pendingPos < ex.pendingLen) {
+      size_t n = maxLen - written < ex.pendingLen - ex.pendingPos ? maxLen - written : ex.pendingLen - ex.pendingPos;
+      memcpy(buffer + written, ex.pending + ex.pendingPos, n);
+      written += n;
+      ex.pendingPos += n;
+      continue;
+    }
+    if (ex.finished) {
+      break;
+    }
+    ChainBlock block;
+    if (ex.next > ex.last || !copyChainBlock(state, ex.next, block)) {
+      ex.finished = true;
+      continue;
+    }
+    ex.next++;
+    char prev[2 * CHAIN_HASH_SIZE + 1];
+    char hash[2 * CHAIN_HASH_SIZE + 1];
+    chainHashHex(block.prevHash, prev);
+    chainHashHex(block.hash, hash);
+    int len = snprintf(ex.pending, sizeof(ex.pending), "B,%u,%u,%s,%s\n", (unsigned)block.seq, (unsigned)block.count, prev, hash);
+    for (uint32_t i = 0; i < block.count && i < (uint32_t)CHAIN_BLOCK_RECORDS; i++) {
+      const ChainRecord& r = block.records[i];
+      len += snprintf(ex.pending + len, sizeof(ex.pending) - len, "R,%u,%u,%d\n", (unsigned)r.epoch, (unsigned)r.sensor, (int)r.centiC);
+    }
+    ex.pendingLen = len;
+    ex.pendingPos = 0;
+  }
+  return written;
+}
+
+#endif
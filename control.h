@@ -0,0 +1,344 @@
+/*
+  Header: control.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the optional thermostat control: a relay output (e.g. the contactor of
+  a compressor or a heater) driven from one sensor by a hysteresis or a fixed-point PID controller.
+
+  - Hysteresis: the relay is switched on when the reading leaves the band around the setpoint on
+    the demand side, and off when it leaves it on the other side.
+  - PID: the controller computes a duty (in permille) from the error, in hundredths of a degree,
+    which is applied by time-proportioning: the relay is on for the duty's share of each window.
+    The integral term only integrates while the output is not saturated in the direction of the
+    error, and is limited to the output range (anti-windup). The derivative term is taken on the
+    reading, so setpoint changes do not kick the output.
+
+  The relay is never switched before it has been on for the minimum on time, or off for the
+  minimum off time, which protects compressors from short cycling; the minimum off time also
+  applies after boot. When the reading is invalid or older than the stale time, the sensor is
+  faulted and the relay runs at a fixed failsafe duty until a valid reading returns.
+
+  Usage:
+  - Call startControl() once, then updateControl() every control period with the latest reading
+    and its age, and drive the relay from the result.
+  - Call resetController() when the configuration changes.
+  - Call recordControlPeriod() with the measured time between two updates to track the jitter.
+
+  Notes:
+  - The module does not depend on Arduino types so it can also be compiled on a host; the plant
+    simulation in tools/ runs it against a thermal model.
+*/
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdint.h>
+#include <string.h>
+
+// GPIO of the relay and its active level; may be set as build flags (e.g. -DCONTROL_RELAY_PIN=27).
+#ifndef CONTROL_RELAY_PIN
+#define CONTROL_RELAY_PIN 26
+#endif
+#ifndef CONTROL_RELAY_ACTIVE_HIGH
+#define CONTROL_RELAY_ACTIVE_HIGH 1
+#endif
+
+// NVS namespace and key of the control configuration.
+const char* CONTROL_NVS_NAMESPACE = "control";
+const char* CONTROL_NVS_KEY = "config";
+
+// Longest time between two reads of the controlled sensor; the main loop reads it when no other
+// sample did for this long.
+const unsigned long CONTROL_SAMPLE_INTERVAL_MS = 10000;
+
+// Control algorithms.
+enum ControlMode {
+  CONTROL_OFF,          // Relay off
+  CONTROL_HYSTERESIS,   // On/off around the setpoint
+  CONTROL_PID,          // Time-proportioned PID duty
+  CONTROL_MODE_COUNT
+};
+
+// Full scale of a duty, in permille.
+const int32_t CONTROL_DUTY_MAX = 1000;
+
+// Configuration of the controller.
+struct ControlConfig {
+  uint8_t mode;               // ControlMode
+  int8_t sensor;              // Controlled sensor
+  bool cooling;               // The relay cools (on above the setpoint) rather than heats
+  int16_t setpointCentiC;     // Setpoint in hundredths of a degree
+  int16_t hysteresisCentiC;   // Width of the hysteresis band
+  int32_t kp;                 // Duty in permille per degree of error
+  int32_t ki;                 // Duty in permille per degree of error and minute
+  int32_t kd;                 // Duty in permille per degree per minute of change of the reading
+  uint32_t periodMs;          // Control period
+  uint32_t windowMs;          // Time-proportioning window of a PID duty
+  uint32_t minOnMs;           // Minimum time the relay stays on
+  uint32_t minOffMs;          // Minimum time the relay stays off
+  uint32_t staleMs;           // Age after which a reading is a sensor fault
+  uint16_t failsafeDuty;      // Duty in permille while the sensor is faulted
+};
+
+// Default configuration: off, set up for a cooler at 4 C.
+const ControlConfig CONTROL_DEFAULTS = {
+  CONTROL_OFF, 0, true, 400, 100,
+  200, 20, 0,
+  1000, 1200000, 180000, 300000, 60000, 300
+};
+
+// State of the controller and statistics of the relay.
+struct ControlState {
+  bool relayOn;
+  bool demand;                // Last relay state requested by the algorithm
+  bool faulted;               // The reading is invalid or stale
+  int32_t duty;               // Current duty in permille
+  int64_t integral;           // Integral of the error, in hundredths of a degree times milliseconds
+  bool hasLast;               // lastCentiC holds the previous reading
+  int16_t lastCentiC;
+  unsigned long lastReadingMs; // Time the previous reading was taken
+  int32_t rateCentiC;         // Change of the reading per minute, in hundredths of a degree
+  unsigned long lastMs;       // Time of the last update
+  unsigned long relayChangedMs;
+  unsigned long windowStartMs;
+
+  uint32_t updates;           // Control periods run
+  uint32_t switches;          // Relay switches
+  uint32_t faults;            // Sensor faults entered
+  uint64_t onMs;              // Time the relay was on
+  uint64_t totalMs;           // Time since the start
+  uint32_t lastJitterUs;      // Deviation of the last control period from the configured one
+  uint32_t maxJitterUs;
+  uint64_t totalJitterUs;
+  uint32_t jitterSamples;
+};
+
+/**
+ * Returns the name of a control mode.
+ */
+const char* controlModeName(uint8_t mode) {
+  switch (mode) {
+    case CONTROL_OFF: return "off";
+    case CONTROL_HYSTERESIS: return "hysteresis";
+    case CONTROL_PID: return "pid";
+    default: return "unknown";
+  }
+}
+
+/**
+ * Finds a control mode by name.
+ *
+ * @return The mode, or CONTROL_MODE_COUNT if the name is unknown.
+ */
+ControlMode findControlMode(const char* name) {
+  for (int m = 0; m < CONTROL_MODE_COUNT; m++) {
+    if (strcmp(name, controlModeName(m)) == 0) {
+      return (ControlMode)m;
+    }
+  }
+  return CONTROL_MODE_COUNT;
+}
+
+/**
+ * Checks a configuration.
+ *
+ * @param config The configuration.
+ * @param sensorCount The number of sensor slots.
+ * @return An error message, or nullptr if the configuration is valid.
+ */
+const char* checkControlConfig(const ControlConfig& config, int sensorCount) {
+  if (config.mode >= CONTROL_MODE_COUNT) {
+    return "Invalid mode";
+  }
+  if (config.sensor < 0 || config.sensor >= sensorCount) {
+    return "Invalid sensor";
+  }
+  if (config.hysteresisCentiC < 0) {
+    return "Invalid hysteresis";
+  }
+  if (config.kp < 0 || config.ki < 0 || config.kd < 0) {
+    return "Invalid gains";
+  }
+  if (config.periodMs < 100 || config.periodMs > 60000) {
+    return "Invalid period";
+  }
+  if (config.windowMs < config.periodMs || config.windowMs > 3600000) {
+    return "Invalid window";
+  }
+  if (config.minOnMs > 3600000 || config.minOffMs > 3600000) {
+    return "Invalid minimum on or off time";
+  }
+  if (config.staleMs < config.periodMs) {
+    return "Invalid stale time";
+  }
+  if (config.failsafeDuty > CONTROL_DUTY_MAX) {
+    return "Invalid failsafe duty";
+  }
+  return nullptr;
+}
+
+/**
+ * Resets the controller terms (integral, derivative, window and hysteresis demand), keeping the
+ * relay and its minimum on and off times.
+ */
+void resetController(ControlState& state, unsigned long nowMs) {
+  state.demand = state.relayOn;
+  state.duty = state.relayOn ? CONTROL_DUTY_MAX : 0;
+  state.integral = 0;
+  state.hasLast = false;
+  state.rateCentiC = 0;
+  state.windowStartMs = nowMs;
+}
+
+/**
+ * Starts the controller with the relay off. The relay is held off for the minimum off time, as the
+ * equipment may have been running until just before the start.
+ */
+void startControl(ControlState& state, unsigned long nowMs) {
+  memset(&state, 0, sizeof(state));
+  state.relayChangedMs = nowMs;
+  state.lastMs = nowMs;
+  resetController(state, nowMs);
+}
+
+/**
+ * Computes the PID duty.
+ *
+ * @param error The error in hundredths of a degree, positive when the relay should run.
+ * @param dtMs The time since the last update.
+ */
+int32_t updatePid(ControlState& state, const ControlConfig& config, int32_t error, unsigned long dtMs) {
+  // Gains are per degree (100) and per minute (60000 ms).
+  const int64_t integralScale = 100LL * 60000;
+  int64_t p = (int64_t)config.kp * error / 100;
+  int64_t d = (int64_t)config.kd * (config.cooling ? state.rateCentiC : -state.rateCentiC) / 100;
+  int64_t integral = state.integral + (int64_t)error * (int64_t)dtMs;
+  int64_t u = p + (int64_t)config.ki * integral / integralScale + d;
+  if (!((u > CONTROL_DUTY_MAX && error > 0) || (u < 0 && error < 0))) {
+    state.integral = integral;
+  }
+  int64_t maxIntegral = config.ki > 0 ? CONTROL_DUTY_MAX * integralScale / config.ki : 0;
+  if (state.integral > maxIntegral) {
+    state.integral = maxIntegral;
+  }
+  if (state.integral < 0) {
+    state.integral = 0;
+  }
+  u = p + (int64_t)config.ki * state.integral / integralScale + d;
+  return u < 0 ? 0 : (u > CONTROL_DUTY_MAX ? CONTROL_DUTY_MAX : (int32_t)u);
+}
+
+/**
+ * Tracks the rate of change of the reading. The sensor is sampled less often than the control
+ * period, so the rate is only updated when a new reading (one taken at another time) arrives.
+ */
+void trackReading(ControlState& state, int16_t centiC, unsigned long readingMs) {
+  if (state.hasLast && readingMs == state.lastReadingMs) {
+    return;
+  }
+  long spanMs = (long)(readingMs - state.lastReadingMs);
+  state.rateCentiC = (state.hasLast && spanMs > 0) ? (int32_t)(((int64_t)centiC - state.lastCentiC) * 60000 / spanMs) : 0;
+  state.hasLast = true;
+  state.lastCentiC = centiC;
+  state.lastReadingMs = readingMs;
+}
+
+/**
+ * Returns whether a duty asks for the relay to be on at a time, moving the time-proportioning
+ * window on when it ended.
+ */
+bool proportionDuty(ControlState& state, const ControlConfig& config, unsigned long nowMs) {
+  if (nowMs - state.windowStartMs >= config.windowMs) {
+    state.windowStartMs = nowMs;
+  }
+  return (uint64_t)(nowMs - state.windowStartMs) * CONTROL_DUTY_MAX < (uint64_t)state.duty * config.windowMs;
+}
+
+/**
+ * Runs one control period.
+ *
+ * @param state The controller state.
+ * @param config The configuration.
+ * @param centiC The latest reading of the controlled sensor, in hundredths of a degree.
+ * @param ageMs The time since the reading was taken.
+ * @param nowMs The current time in milliseconds.
+ * @param invalid The value of an invalid reading.
+ * @return Whether the relay is on.
+ */
+bool updateControl(ControlState& state, const ControlConfig& config, int16_t centiC, unsigned long ageMs, unsigned long nowMs, int16_t invalid) {
+  unsigned long dtMs = nowMs - state.lastMs;
+  state.lastMs = nowMs;
+  state.updates++;
+  state.totalMs += dtMs;
+  if (state.relayOn) {
+    state.onMs += dtMs;
+  }
+
+  bool faulted = config.mode != CONTROL_OFF && (centiC == invalid || ageMs > config.staleMs);
+  if (faulted && !state.faulted) {
+    state.faults++;
+  }
+  state.faulted = faulted;
+
+  int32_t error = (int32_t)centiC - config.setpointCentiC;
+  if (!config.cooling) {
+    error = -error;
+  }
+  if (config.mode == CONTROL_OFF) {
+    state.duty = 0;
+    state.demand = false;
+  }
+  else if (faulted) {
+    state.integral = 0;
+    state.hasLast = false;
+    state.rateCentiC = 0;
+    state.duty = config.failsafeDuty;
+    state.demand = proportionDuty(state, config, nowMs);
+  }
+  else if (config.mode == CONTROL_HYSTERESIS) {
+    if (error >= (config.hysteresisCentiC + 1) / 2) {
+      state.demand = true;
+    }
+    else if (error <= -(config.hysteresisCentiC + 1) / 2) {
+      state.demand = false;
+    }
+    state.duty = state.demand ? CONTROL_DUTY_MAX : 0;
+  }
+  else {
+    trackReading(state, centiC, nowMs - ageMs);
+    state.duty = updatePid(state, config, error, dtMs);
+    state.demand = proportionDuty(state, config, nowMs);
+  }
+
+  if (state.demand != state.relayOn) {
+    unsigned long held = nowMs - state.relayChangedMs;
+    if (held >= (state.relayOn ? config.minOnMs : config.minOffMs)) {
+      state.relayOn = state.demand;
+      state.relayChangedMs = nowMs;
+      state.switches++;
+    }
+  }
+  return state.relayOn;
+}
+
+/**
+ * Records the measured time between two control updates.
+ *
+ * @param intervalUs The measured time in microseconds.
+ * @param periodMs The configured control period.
+ */
+void recordControlPeriod(ControlState& state, unsigned long intervalUs, uint32_t periodMs) {
+  long deviation = (long)intervalUs - (long)periodMs * 1000;
+  uint32_t jitter = deviation < 0 ? -deviation : deviation;
+  state.lastJitterUs = jitter;
+  if (jitter > state.maxJitterUs) {
+    state.maxJitterUs = jitter;
+  }
+  state.totalJitterUs += jitter;
+  state.jitterSamples++;
+}
+
+#endif
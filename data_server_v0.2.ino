@@ -14,6 +14,21 @@
     - Web server for real-time data presentation and configuration.
     - Webhook integration for temperature alerts.
     - Configurable temperature thresholds and timer delay for alerts.
+    - Per-probe calibration (offset, gain or multi-point table) keyed by ROM address.
+    - Sensor groups of redundant probes with median or voted values and disagreement detection.
+    - Virtual sensors defined by expressions over the physical probes (e.g. delta-T, max of probes).
+    - Online thermal model per sensor with door-open, equipment-failure and insulation events.
+    - Multiple 1-Wire buses converted in parallel, with per-bus health and timing statistics.
+    - Pluggable sensor drivers (DS18B20, SHT3x, synthetic) sampled together by a common sampler.
+    - Per-sensor sampling intervals, with each sensor's history stored at its own rate.
+    - 1-Wire hot-plug detection with incremental bus searches between samples.
+    - Optional thermostat control of a relay output (hysteresis or PID) with compressor protection.
+    - Local buzzer and LED alarm with a silence button, driven without the network.
+    - Heartbeat posting a status summary at a fixed interval, so a silent device is noticed.
+    - Daily compliance report (min, max, mean, MKT, minutes out of range, alerts, hourly rollup).
+    - Tamper-evident SHA-256 hash chain of the stored readings, anchored in heartbeats and alerts.
+    - Freshness headers on data responses and sensor-to-publish and publish-to-delivery latency histograms.
+    - Per-client token-bucket rate limiting of the web server, per route class.
 
   Usage Instructions:
     1. Connect the DS18B20 sensor to the ESP32.
@@ -34,14 +49,33 @@
     - ESPAsyncWebServer: To create an asynchronous web server.
     - OneWire: Interface with DS18B20 sensor.
     - DallasTemperature: Manage the DS18B20 temperature readings.
+    - Wire: I2C bus for SHT3x sensors.
     - esp_wpa2: For WPA2-Enterprise WiFi security.
     - HTTPClient: To send HTTP requests (for webhooks).
+    - mbedtls: SHA-256 of the reading chain, run on the ESP32 hardware SHA accelerator.
+    - Preferences: To persist probe calibrations, alert states, the control configuration, the alarm rules, the heartbeat configuration, the daily reports and the chain head in NVS.
     - ArduinoJson: For JSON serialization and parsing.
 
   Additional Files:
     - secrets.h: Contains sensitive configuration like WiFi credentials and webhook URLs.
     - html.h: HTML source for the web server pages.
     - temper.h: Includes temperature-related functions and constants.
+    - expr.h: Expression compiler and evaluator for virtual sensors.
+    - vote.h: Median and majority voting for groups of redundant probes.
+    - calib.h: Per-probe calibration tables, applied in fixed point and persisted in NVS.
+    - drivers.h: Sensor drivers (DS18B20, SHT3x, synthetic) and the sampler that overlaps their conversions.
+    - model.h: Online thermal model used to classify door openings, failures and insulation degradation.
+    - alert.h: Threshold alert logic, shared with the host replay tool in tools/.
+    - query.h: Time-bucketed aggregation used by the "/query" endpoint.
+    - burst.h: Burst capture of a few sensors at a short interval into a separate buffer.
+    - recorder.h: Alert flight recorder keeping the readings around each alert in retained snapshots.
+    - control.h: Optional thermostat control of a relay by a hysteresis or PID controller.
+    - alarm.h: Local buzzer and LED alarm with a silence button, independent of the network.
+    - heartbeat.h: Heartbeat summaries of the sensors and counters between two heartbeats.
+    - report.h: Daily compliance report, accumulated sample by sample and closed at local midnight.
+    - chain.h: Hash chain of the stored readings, in blocks sealed with SHA-256.
+    - freshness.h: Conversion start and publish stamps of the samples, and their latency histograms.
+    - ratelimit.h: Token buckets per client IP address and route class, in a fixed-size LRU table.
 
   Note:
     Ensure all library dependencies are installed before compiling. Follow best practices for secure handling of WiFi credentials and webhook URLs.
@@ -53,32 +87,167 @@
 #include "ESPAsyncWebSrv.h"
 #include <OneWire.h>
 #include <DallasTemperature.h>
+#include <Wire.h>
 #include "esp_wpa2.h"
 #include <HTTPClient.h>
+#include <Preferences.h>
 #include <ArduinoJson.h>
 #include <ArduinoJson.hpp>
+#include "mbedtls/sha256.h"
 
 #include "secrets.h"
 #include "html.h"
+#include "expr.h"
+#include "vote.h"
+#include "calib.h"
+#include "drivers.h"
 #include "temper.h"
+#include "model.h"
+#include "alert.h"
+#include "query.h"
+#include "burst.h"
+#include "recorder.h"
+#include "control.h"
+#include "alarm.h"
+#include "heartbeat.h"
+#include "report.h"
+#include "chain.h"
+#include "freshness.h"
+#include "ratelimit.h"
+#include <memory>
 
 // Counter used in various loops for retry mechanisms or timing.
 int counter = 0;
 
-// Stores the last time (in milliseconds) a certain action was performed.
+// Stores the last time (in milliseconds) any sensor was sampled.
 unsigned long lastTime = 0;
 
-// Delay (in milliseconds) used for a timer, e.g., for temperature reading intervals.
+// Default sampling interval (in milliseconds) of sensors without their own interval.
 unsigned long timerDelay = 300000;  // 5 minutes
 
-// Stores the last time (in milliseconds) a notification was sent.
-unsigned long lastNotifyTime = 0;
-
 // Delay (in milliseconds) before sending another notification to prevent spam.
 unsigned long teamsNotificationDelay = 1800000; // 30 minutes
 
-// Flag to indicate whether a notification has been sent.
-bool sendNotif = false;
+// Alert state of each sensor (see alert.h).
+AlertState alertStates[MAX_SENSORS];
+
+// Alert states as last saved in NVS, and the id of the next raised alert.
+AlertRecord alertRecords[MAX_SENSORS];
+uint32_t nextAlertId = 1;
+
+// Acknowledgment of a sensor's alert requested through the web server and applied by the main
+// loop, which owns the alert states. The request counter is incremented after the other fields.
+struct AlertAckRequest {
+  volatile uint32_t id;         // Alert to acknowledge
+  volatile uint32_t snoozeSec;  // Snooze duration, 0 until the alert recovers
+  volatile uint32_t requested;  // Requests made
+  uint32_t applied;             // Requests applied
+};
+AlertAckRequest alertAckRequests[MAX_SENSORS];
+
+// Alert repeats not sent because the alert was acknowledged.
+uint32_t suppressedAlertRepeats = 0;
+
+// Kind of a sensor configuration change.
+enum SensorChangeKind {
+  CHANGE_DEFINE_VIRTUAL,        // Define or redefine the virtual sensor 'name'
+  CHANGE_REMOVE_VIRTUAL,        // Remove the virtual sensor 'name'
+  CHANGE_DEFINE_GROUP,          // Define or redefine the sensor group 'name'
+  CHANGE_REMOVE_GROUP,          // Remove the sensor group 'name'
+  CHANGE_SET_CALIBRATION,       // Store 'calibration' for its probe
+  CHANGE_REMOVE_CALIBRATION,    // Remove the calibration of the probe 'calibration.rom'
+  CHANGE_INTERVAL,              // Set the sampling interval of 'sensor' to 'intervalMs'
+  CHANGE_SYNTHETIC,             // Set the synthetic waveform to 'synthetic', and its load rate if 'setRate'
+  CHANGE_START_BURST,           // Start a burst of the sensors 'memberMask' every 'intervalMs' for 'durationMs'
+  CHANGE_STOP_BURST,            // Stop the running burst
+  CHANGE_HEARTBEAT,             // Set and save the heartbeat configuration 'heartbeat'
+  CHANGE_ALARM_RULE             // Set and save the alarm rule of 'sensor' to 'alarmRule'
+};
+
+// Change of the sensor configuration requested through the web server. The sensor table is read
+// and evaluated by the main loop while it samples, so the web server task only checks a change
+// and queues it, and the main loop applies it between samples (see applySensorChanges()).
+struct SensorChange {
+  SensorChangeKind kind;
+  char name[SENSOR_NAME_LEN];
+  char expr[SENSOR_EXPR_LEN];
+  float minTemp;
+  float maxTemp;
+  uint16_t memberMask;          // Members of a group
+  GroupMode mode;               // Combination of a group
+  float tolerance;              // Tolerance of a group, in Celsius
+  Calibration calibration;      // Calibration of a probe
+  int sensor;                   // Sensor of an interval change
+  unsigned long intervalMs;     // Sampling interval, 0 for the default
+  unsigned long durationMs;     // Duration of a burst
+  HeartbeatConfig heartbeat;    // Heartbeat interval and URL
+  AlarmRule alarmRule;          // Alarm patterns of 'sensor'
+  SyntheticConfig synthetic;    // Synthetic waveform and load rate
+  bool setRate;                 // Whether the synthetic load is restarted at 'synthetic.rateHz'
+};
+
+// Queue of sensor configuration changes, written by the web server task and read by the main
+// loop. The queued counter is incremented after the entry is written.
+const int SENSOR_CHANGE_QUEUE = 4;
+SensorChange sensorChanges[SENSOR_CHANGE_QUEUE];
+volatile uint32_t sensorChangesQueued = 0;
+volatile uint32_t sensorChangesApplied = 0;
+
+// Queued changes that were no longer valid when the main loop applied them.
+uint32_t sensorChangesFailed = 0;
+
+// Flight recorder snapshot of each sensor's last raised alert (0 if none).
+uint32_t alertSnapshots[MAX_SENSORS];
+
+static_assert(RECORDER_MAX_SENSORS == MAX_SENSORS, "The flight recorder records every sensor slot");
+
+// Thermostat control configuration (see control.h), persisted in NVS. It is changed by the web
+// server and read by the control task and the main loop, which saves it; controlConfigSeq is odd
+// while a change is being written.
+ControlConfig controlConfig = CONTROL_DEFAULTS;
+volatile uint32_t controlConfigSeq = 0;
+
+// Value of controlConfigSeq when the configuration was last saved.
+uint32_t controlConfigSavedSeq = 0;
+
+// State of the controller, updated by the control task only.
+ControlState controlState;
+
+static_assert(ALARM_MAX_SENSORS == MAX_SENSORS, "The local alarm has a rule for every sensor slot");
+
+// Heartbeat configuration (see heartbeat.h), persisted in NVS, and its state, owned by the main loop.
+HeartbeatConfig heartbeatConfig = { HEARTBEAT_DEFAULT_INTERVAL_SEC, "" };
+HeartbeatState heartbeatState;
+
+static_assert(HEARTBEAT_MAX_SENSORS == MAX_SENSORS, "The heartbeat summarizes every sensor slot");
+
+// Accumulator of the current day's compliance report (see report.h), owned by the main loop, and
+// the date of the report stored in each NVS slot (0 if none).
+ReportAccumulator reportAccumulator;
+uint32_t reportDates[REPORT_DAYS];
+
+// Whether each daily report is also posted to the temperature webhook, persisted in NVS.
+bool reportPush = false;
+
+// Time the main loop last checked for the end of the day.
+unsigned long lastReportCheckMs = 0;
+
+static_assert(REPORT_MAX_SENSORS == MAX_SENSORS, "The daily report covers every sensor slot");
+
+// Hash chain of the stored readings (see chain.h), sealed by the main loop.
+ChainState chainState;
+
+// Conversion start and publish times of each sensor's last stored sample, and the latency
+// histograms (see freshness.h).
+FreshnessState freshness;
+
+static_assert(FRESHNESS_MAX_SENSORS == MAX_SENSORS, "Every sensor slot has a freshness stamp");
+
+// Token buckets of the web clients (see ratelimit.h), used by the web server task only.
+RateLimiter rateLimiter;
+
+// Online thermal model for each sensor, updated once per sample.
+ThermalModel thermalModels[MAX_SENSORS];
 
 // NTP server for time synchronization.
 const char* ntpServer = "pool.ntp.org";
@@ -126,6 +295,11 @@ bool waiting_to_connect = true;
 // Flag indicating whether the device is in WiFi configuration mode.
 bool configuringWiFi = true;
 
+// First point of a two-point calibration in progress, for each sensor (raw and reference,
+// in hundredths of a degree). TEMP_INVALID when no calibration is in progress.
+int16_t twoPointRaw[MAX_SENSORS];
+int16_t twoPointRef[MAX_SENSORS];
+
 /**
  * Converts milliseconds to minutes.
  *
@@ -150,6 +324,518 @@ long minutesToMilliseconds(int minutes) {
   return minutes * 60 * 1000;
 }
 
+/**
+ * Formats a floating point value for JSON output.
+ *
+ * @param value The value to format.
+ * @param decimals The number of decimal places.
+ * @return The formatted number, or "null" if the value is not a number.
+ */
+String jsonNumber(float value, int decimals) {
+  if (isnan(value) || isinf(value)) {
+    return "null";
+  }
+  return String(value, decimals);
+}
+
+/**
+ * Computes a SHA-256 hash for the reading chain (see chain.h). mbedtls runs it on the ESP32
+ * hardware SHA accelerator, falling back to software while the accelerator is busy (e.g. TLS).
+ */
+void chainSha256(const uint8_t* data, size_t len, uint8_t hash[CHAIN_HASH_SIZE]) {
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, data, len);
+  mbedtls_sha256_finish(&ctx, hash);
+  mbedtls_sha256_free(&ctx);
+}
+
+/**
+ * Formats the head of the reading chain as JSON members, each prefixed with a comma, to anchor
+ * it in a webhook payload.
+ */
+String chainAnchorFields() {
+  char hash[2 * CHAIN_HASH_SIZE + 1];
+  chainHashHex(chainState.head.hash, hash);
+  return ",\"chainSeq\": " + String(chainState.head.seq) + ",\"chainHash\": \"" + String(hash) + "\"";
+}
+
+/**
+ * Formats a latency histogram in Prometheus text format, with cumulative buckets in milliseconds.
+ *
+ * @param name The metric name.
+ * @param histogram The histogram.
+ * @return The TYPE line, the buckets, the sum and the count.
+ */
+String latencyHistogramText(const String& name, const LatencyHistogram& histogram) {
+  String text = "# TYPE " + name + " histogram\n";
+  uint32_t cumulative = 0;
+  for (int b = 0; b < FRESHNESS_BUCKETS - 1; b++) {
+    cumulative += histogram.buckets[b];
+    text += name + "_bucket{le=\"" + String(FRESHNESS_BUCKET_MS[b]) + "\"} " + String(cumulative) + "\n";
+  }
+  text += name + "_bucket{le=\"+Inf\"} " + String(histogram.count) + "\n";
+  text += name + "_sum " + String((double)histogram.sumMs, 0) + "\n";
+  text += name + "_count " + String(histogram.count) + "\n";
+  return text;
+}
+
+/**
+ * Adds the freshness headers of a response:
+ * - "X-Sample-Time": start of the conversion of the reading served, in seconds since the Unix epoch (0 if unknown).
+ * - "X-Sample-Age-Ms": time since the start of the conversion.
+ * - "X-Publish-Age-Ms": time since the reading was published.
+ *
+ * @param response The response.
+ * @param startMs Start of the conversion, in milliseconds since boot.
+ * @param startEpoch Start of the conversion in seconds since the Unix epoch, or 0 if unknown.
+ * @param publishMs Time the reading was published, in milliseconds since boot.
+ */
+void addFreshnessHeaders(AsyncWebServerResponse* response, unsigned long startMs, uint32_t startEpoch, unsigned long publishMs) {
+  unsigned long now = millis();
+  response->addHeader("X-Sample-Time", String(startEpoch));
+  response->addHeader("X-Sample-Age-Ms", String(now - startMs));
+  response->addHeader("X-Publish-Age-Ms", String(now - publishMs));
+}
+
+/**
+ * Adds the freshness headers of a response serving the latest reading of every sensor, from the
+ * stalest of them, so the headers bound the age of every reading in the response.
+ */
+void addLatestFreshnessHeaders(AsyncWebServerResponse* response) {
+  unsigned long now = millis();
+  int stalest = -1;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind != SENSOR_NONE && (stalest < 0 || now - latestStartMs[i] > now - latestStartMs[stalest])) {
+      stalest = i;
+    }
+  }
+  if (stalest < 0) {
+    return;
+  }
+  time_t epoch = getEpochTime();
+  uint32_t startEpoch = epoch != 0 ? epoch - (now - latestStartMs[stalest]) / 1000 : 0;
+  addFreshnessHeaders(response, latestStartMs[stalest], startEpoch, latestReadMs[stalest]);
+}
+
+/**
+ * Adds the freshness headers of a response serving a sensor's series, from its last published
+ * sample, and records the first delivery of that sample.
+ */
+void addSeriesFreshnessHeaders(AsyncWebServerResponse* response, int sensor) {
+  const SampleStamp& stamp = freshness.stamps[sensor];
+  if (stamp.generation == 0) {
+    return;
+  }
+  addFreshnessHeaders(response, stamp.startMs, stamp.startEpoch, stamp.publishMs);
+  recordDelivery(freshness, sensor, millis());
+}
+
+/**
+ * Adds the scheduling headers of a response whose content changes with the next sample:
+ * - "Cache-Control": "max-age=<seconds until then>", or "no-cache" if a sample is due within a second.
+ * - "X-Next-Sample": Unix time of the next sample (0 before the clock is synchronized).
+ * - "X-Next-Sample-In-Ms": time until then, independent of the client's clock.
+ *
+ * @param response The response.
+ * @param waitMs Time until the next sample is published, in milliseconds.
+ */
+void addScheduleHeaders(AsyncWebServerResponse* response, unsigned long waitMs) {
+  time_t epoch = getEpochTime();
+  response->addHeader("Cache-Control", waitMs >= 1000 ? "max-age=" + String(waitMs / 1000) : String("no-cache"));
+  response->addHeader("X-Next-Sample", String(epoch != 0 ? (uint32_t)(epoch + (waitMs + 999) / 1000) : 0));
+  response->addHeader("X-Next-Sample-In-Ms", String(waitMs));
+}
+
+/**
+ * Returns the time until a sensor's next reading is published to its series: until its next
+ * scheduled sample, plus the duration of the last sample. A sensor run by the synthetic load is
+ * published continuously.
+ */
+unsigned long msUntilNextPublish(int sensor) {
+  if (syntheticConfig.rateHz != 0 && (syntheticSensors() & (1 << sensor))) {
+    return 0;
+  }
+  long remaining = (long)(nextSampleMs[sensor] - millis());
+  return (remaining > 0 ? remaining : 0) + lastSampleMs;
+}
+
+/**
+ * Returns the time until the latest readings of the sensors next change: at the next scheduled
+ * sample, or the next flight recorder read of the physical sensors, and continuously during a
+ * burst capture or a synthetic load.
+ */
+unsigned long msUntilNextReading() {
+  unsigned long now = millis();
+  if (burst.active || syntheticConfig.rateHz != 0) {
+    return 0;
+  }
+  if (RECORDER_INTERVAL_MS == 0) {
+    return msUntilNextSample(now) + lastSampleMs;
+  }
+  long recorder = (long)(recorderRing.nextMs - now);
+  return min(msUntilNextSample(now), (unsigned long)max(recorder, 0L)) + lastSampleMs;
+}
+
+/**
+ * Produces the next part of a "/query" response.
+ *
+ * @param qs The query stream.
+ * @param buffer The chunk buffer to fill.
+ * @param maxLen The size of the chunk buffer.
+ * @return The number of bytes written, or 0 when the response is complete.
+ */
+size_t fillQueryResponse(QueryStream& qs, uint8_t* buffer, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (qs.pendingPos < qs.pendingLen) {
+      size_t n = min(maxLen - written, qs.pendingLen - qs.pendingPos);
+      memcpy(buffer + written, qs.pending + qs.pendingPos, n);
+      written += n;
+      qs.pendingPos += n;
+      continue;
+    }
+    if (qs.finished) {
+      break;
+    }
+
+    qs.pendingPos = 0;
+    qs.pendingLen = 0;
+    if (!qs.started) {
+      qs.started = true;
+      qs.pendingLen = snprintf(qs.pending, sizeof(qs.pending), "[");
+      continue;
+    }
+
+    QueryBucket bucket;
+    bool completed = false;
+    while (!completed && qs.row < qs.rows) {
+      const SeriesSample& sample = sensorSeries[qs.sensor].samples[(qs.oldest + qs.row) % MAX_ROWS];
+      qs.row++;
+      if (sample.epoch == 0 || sample.epoch < qs.lastEpoch || sample.centiC == TEMP_INVALID) {
+        continue;
+      }
+      qs.lastEpoch = sample.epoch;
+      completed = queryAddSample(qs.query, sample.epoch, sample.centiC / 100.0, bucket);
+    }
+    if (!completed && qs.row >= qs.rows) {
+      completed = queryFinish(qs.query, bucket);
+    }
+    if (!completed) {
+      qs.finished = true;
+      qs.pendingLen = snprintf(qs.pending, sizeof(qs.pending), "]");
+      continue;
+    }
+
+    String time = formatEpoch(bucket.start, "%Y-%m-%d %H:%M");
+    int decimals = (qs.query.agg == QUERY_AGG_COUNT) ? 0 : 2;
+    qs.pendingLen = snprintf(qs.pending, sizeof(qs.pending), "%s{\"start\":%ld,\"time\":\"%s\",\"value\":%.*f,\"count\":%lu}",
+      qs.firstBucket ? "" : ",", (long)bucket.start, time.c_str(), decimals, bucket.value, bucket.count);
+    qs.firstBucket = false;
+  }
+  return written;
+}
+
+/**
+ * Parses a comma separated list of sensor numbers, ignoring numbers out of range.
+ *
+ * @return Bit N set for each sensor N in the list.
+ */
+uint16_t parseSensorList(const String& list) {
+  uint16_t mask = 0;
+  int start = 0;
+  while (start < (int)list.length()) {
+    int end = list.indexOf(',', start);
+    if (end < 0) {
+      end = list.length();
+    }
+    long sensor = list.substring(start, end).toInt();
+    if (sensor >= 0 && sensor < MAX_SENSORS) {
+      mask |= (1 << sensor);
+    }
+    start = end + 1;
+  }
+  return mask;
+}
+
+/**
+ * Formats the state of the current or last burst capture.
+ */
+String burstJson() {
+  String json = "{\"id\":" + String(burst.id);
+  json += ",\"active\":" + String(burst.active ? "true" : "false");
+  json += ",\"sensors\":[";
+  for (int i = 0; i < burst.sensorCount; i++) {
+    json += (i > 0 ? "," : "") + String(burst.sensors[i]);
+  }
+  json += "],\"interval\":" + String(burst.intervalMs / 1000);
+  json += ",\"rows\":" + String(burst.rows);
+  json += ",\"maxRows\":" + String(burst.maxRows);
+  json += ",\"start\":" + String((unsigned long)burst.startEpoch) + "}";
+  return json;
+}
+
+/**
+ * Formats the control configuration and the state of the controller and relay.
+ */
+String controlJson() {
+  const ControlConfig& config = controlConfig;
+  const ControlState& state = controlState;
+  String json = "{\"mode\":\"" + String(controlModeName(config.mode)) + "\"";
+  json += ",\"sensor\":" + String(config.sensor);
+  json += ",\"action\":\"" + String(config.cooling ? "cool" : "heat") + "\"";
+  json += ",\"setpoint\":" + String(config.setpointCentiC / 100.0);
+  json += ",\"hysteresis\":" + String(config.hysteresisCentiC / 100.0);
+  json += ",\"kp\":" + String(config.kp);
+  json += ",\"ki\":" + String(config.ki);
+  json += ",\"kd\":" + String(config.kd);
+  json += ",\"period\":" + String(config.periodMs);
+  json += ",\"window\":" + String(config.windowMs / 1000);
+  json += ",\"minOn\":" + String(config.minOnMs / 1000);
+  json += ",\"minOff\":" + String(config.minOffMs / 1000);
+  json += ",\"stale\":" + String(config.staleMs / 1000);
+  json += ",\"failsafe\":" + String(config.failsafeDuty / 10.0, 1);
+  json += ",\"pin\":" + String(CONTROL_RELAY_PIN);
+  json += ",\"relay\":" + String(state.relayOn ? "true" : "false");
+  json += ",\"faulted\":" + String(state.faulted ? "true" : "false");
+  json += ",\"duty\":" + String(state.duty / 10.0, 1);
+  json += ",\"onRatio\":" + String(state.totalMs > 0 ? (double)state.onMs / state.totalMs : 0.0, 3);
+  json += ",\"switches\":" + String(state.switches);
+  json += ",\"faults\":" + String(state.faults);
+  json += ",\"jitterMaxUs\":" + String(state.maxJitterUs) + "}";
+  return json;
+}
+
+/**
+ * Formats the state of the local alarm and the alarm rule of each sensor in use.
+ */
+String alarmJson() {
+  const AlarmState& state = alarmState;
+  String json = "{\"buzzerPin\":" + String(ALARM_BUZZER_PIN);
+  json += ",\"ledPin\":" + String(ALARM_LED_PIN);
+  json += ",\"buttonPin\":" + String(ALARM_BUTTON_PIN);
+  json += ",\"led\":\"" + String(alarmPatternName(state.ledPattern)) + "\"";
+  json += ",\"buzzer\":\"" + String(alarmPatternName(state.buzzerPattern)) + "\"";
+  json += ",\"silenced\":" + String(state.silenced ? "true" : "false");
+  json += ",\"silenceRemaining\":" + String(state.silenced ? (state.silencedUntilMs - millis()) / 1000 : 0UL);
+  json += ",\"silences\":" + String(state.silences);
+  json += ",\"latencyMs\":" + String(state.latencyMs);
+  json += ",\"sensors\":[";
+  bool first = true;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (!sensorInUse(i)) {
+      continue;
+    }
+    json += first ? "" : ",";
+    first = false;
+    json += "{\"sensor\":" + String(i);
+    json += ",\"low\":\"" + String(alarmPatternName(alarmRules[i].lowPattern)) + "\"";
+    json += ",\"high\":\"" + String(alarmPatternName(alarmRules[i].highPattern)) + "\"";
+    json += ",\"pattern\":\"" + String(alarmPatternName(state.pattern[i])) + "\"";
+    json += ",\"silenced\":" + String(alarmSilenced(i) ? "true" : "false") + "}";
+  }
+  json += "]}";
+  return json;
+}
+
+/**
+ * Formats a heartbeat configuration and the outcome of the last heartbeat.
+ */
+String heartbeatJson(const HeartbeatConfig& config) {
+  const HeartbeatState& state = heartbeatState;
+  String json = "{\"interval\":" + String(config.intervalSec);
+  json += ",\"url\":" + jsonString(config.url[0] != '\0' ? config.url : INFO_WEBHOOK_URL.c_str());
+  json += ",\"seq\":" + String(state.seq);
+  json += ",\"lastStatus\":" + String(state.lastStatus);
+  json += ",\"failures\":" + String(state.failures);
+  json += ",\"totalFailures\":" + String(state.totalFailures);
+  json += ",\"windowAge\":" + String((millis() - state.windowStartMs) / 1000) + "}";
+  return json;
+}
+
+/**
+ * Formats a report date (YYYYMMDD) as YYYY-MM-DD.
+ */
+String reportDateString(uint32_t date) {
+  char text[12];
+  snprintf(text, sizeof(text), "%04u-%02u-%02u", (unsigned)(date / 10000), (unsigned)(date / 100 % 100), (unsigned)(date % 100));
+  return String(text);
+}
+
+/**
+ * Formats a temperature of a report, or "null" for an invalid one.
+ */
+String reportTemperature(int16_t centiC) {
+  return centiC == TEMP_INVALID ? String("null") : formatTemperature(centiC, false);
+}
+
+/**
+ * Formats the stored daily reports and the day being accumulated for "/reports".
+ */
+String reportListJson() {
+  String json = "{\"push\":" + String(reportPush ? "true" : "false");
+  json += ",\"today\":" + (reportAccumulator.date != 0 ? "\"" + reportDateString(reportAccumulator.date) + "\"" : String("null"));
+  json += ",\"reports\":[";
+  bool first = true;
+  for (int i = 0; i < REPORT_DAYS; i++) {
+    if (reportDates[i] == 0) {
+      continue;
+    }
+    json += first ? "" : ",";
+    first = false;
+    String date = reportDateString(reportDates[i]);
+    json += "{\"date\":\"" + date + "\",\"json\":\"/reports/" + date + ".json\",\"csv\":\"/reports/" + date + ".csv\"}";
+  }
+  json += "]}";
+  return json;
+}
+
+/**
+ * Formats a daily report as JSON: the summary and hourly rollup of each sensor sampled during
+ * the day, then the alerts. Temperatures are in Celsius and times in Unix time.
+ */
+String dailyReportJson(const DailyReport& report) {
+  String json = "{\"date\":\"" + reportDateString(report.date) + "\"";
+  json += ",\"from\":" + String(report.firstEpoch);
+  json += ",\"to\":" + String(report.lastEpoch);
+  json += ",\"sensors\":[";
+  bool first = true;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    const ReportSensor& r = report.sensors[i];
+    if (!r.used) {
+      continue;
+    }
+    json += first ? "" : ",";
+    first = false;
+    json += "{\"sensor\":" + String(i);
+    json += ",\"name\":\"" + String(sensorTable[i].name) + "\"";
+    json += ",\"samples\":" + String(r.samples);
+    json += ",\"invalid\":" + String(r.invalid);
+    json += ",\"min\":" + reportTemperature(r.minCentiC);
+    json += ",\"max\":" + reportTemperature(r.maxCentiC);
+    json += ",\"mean\":" + reportTemperature(r.meanCentiC);
+    json += ",\"mkt\":" + reportTemperature(r.mktCentiC);
+    json += ",\"minTemp\":" + reportTemperature(r.lowCentiC);
+    json += ",\"maxTemp\":" + reportTemperature(r.highCentiC);
+    json += ",\"minutesBelow\":" + String(r.minutesBelow);
+    json += ",\"minutesAbove\":" + String(r.minutesAbove);
+    json += ",\"hours\":[";
+    for (int h = 0; h < 24; h++) {
+      json += (h > 0 ? "," : "");
+      json += "[" + reportTemperature(r.hours[h].minCentiC) + "," + reportTemperature(r.hours[h].maxCentiC) + "," + reportTemperature(r.hours[h].meanCentiC) + "]";
+    }
+    json += "]}";
+  }
+  json += "],\"alerts\":[";
+  for (int a = 0; a < report.alertCount; a++) {
+    const ReportAlert& alert = report.alerts[a];
+    json += (a > 0 ? "," : "");
+    json += "{\"id\":" + String(alert.id);
+    json += ",\"sensor\":" + String(alert.sensor);
+    json += ",\"start\":" + String(alert.startEpoch);
+    json += ",\"end\":" + (alert.endEpoch != 0 ? String(alert.endEpoch) : String("null")) + "}";
+  }
+  json += "],\"droppedAlerts\":" + String(report.droppedAlerts) + "}";
+  return json;
+}
+
+/**
+ * Formats a daily report as CSV: one row per sensor for the day and for each hour with a
+ * reading, then one row per alert. Times are in local time.
+ */
+String dailyReportCsv(const DailyReport& report) {
+  String date = reportDateString(report.date);
+  String csv = "date,sensor,name,period,samples,invalid,min,max,mean,mkt,min_temp,max_temp,minutes_below,minutes_above\n";
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    const ReportSensor& r = report.sensors[i];
+    if (!r.used) {
+      continue;
+    }
+    String prefix = date + "," + String(i) + "," + String(sensorTable[i].name) + ",";
+    csv += prefix + "day," + String(r.samples) + "," + String(r.invalid) + ",";
+    csv += formatTemperature(r.minCentiC, false) + "," + formatTemperature(r.maxCentiC, false) + ",";
+    csv += formatTemperature(r.meanCentiC, false) + "," + formatTemperature(r.mktCentiC, false) + ",";
+    csv += formatTemperature(r.lowCentiC, false) + "," + formatTemperature(r.highCentiC, false) + ",";
+    csv += String(r.minutesBelow) + "," + String(r.minutesAbove) + "\n";
+    for (int h = 0; h < 24; h++) {
+      const ReportHour& hour = r.hours[h];
+      if (hour.meanCentiC == TEMP_INVALID) {
+        continue;
+      }
+      csv += prefix + (h < 10 ? "0" : "") + String(h) + ":00,,,";
+      csv += formatTemperature(hour.minCentiC, false) + "," + formatTemperature(hour.maxCentiC, false) + ",";
+      csv += formatTemperature(hour.meanCentiC, false) + ",,,,,\n";
+    }
+  }
+  csv += "\nalert,sensor,name,start,end\n";
+  for (int a = 0; a < report.alertCount; a++) {
+    const ReportAlert& alert = report.alerts[a];
+    csv += String(alert.id) + "," + String(alert.sensor) + "," + String(sensorTable[alert.sensor].name) + ",";
+    csv += formatEpoch(alert.startEpoch, "%Y-%m-%d %H:%M:%S") + ",";
+    csv += (alert.endEpoch != 0 ? formatEpoch(alert.endEpoch, "%Y-%m-%d %H:%M:%S") : String("open")) + "\n";
+  }
+  return csv;
+}
+
+/**
+ * Formats the latest reading of every sensor for the "/read" route.
+ *
+ * @param fresh Whether the readings come from the fresh sample the caller waited for.
+ * @return {"fresh": <bool>, "ageMs": <time since the readings were taken>, "readings": [...]}.
+ */
+String readingsJson(bool fresh) {
+  unsigned long now = millis();
+  unsigned long takenMs = ((long)(freshRead.completedMs - lastTime) > 0) ? freshRead.completedMs : lastTime;
+  String json = "{\"fresh\":" + String(fresh ? "true" : "false");
+  json += ",\"ageMs\":" + String(now - takenMs);
+  json += ",\"readings\":[";
+  bool first = true;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind == SENSOR_NONE) {
+      continue;
+    }
+    if (!first) {
+      json += ",";
+    }
+    first = false;
+    json += "{\"sensor\":" + String(i);
+    json += ",\"name\":\"" + String(sensorTable[i].name) + "\"";
+    json += ",\"temperatureC\":\"" + formatTemperature(latestCentiC[i], false) + "\"";
+    json += ",\"temperatureF\":\"" + formatTemperature(latestCentiC[i], true) + "\"}";
+  }
+  json += "]}";
+  return json;
+}
+
+/**
+ * Produces the next part of a "/read?fresh=1" response.
+ *
+ * Until the fresh sample the response waits for completes, RESPONSE_TRY_AGAIN is returned so that
+ * the web server polls again later without blocking its task. After FRESH_TIMEOUT_MS the latest
+ * readings are sent with "fresh": false.
+ *
+ * @param rs The response state.
+ * @param buffer The chunk buffer to fill.
+ * @param maxLen The size of the chunk buffer.
+ * @return The number of bytes written, 0 when the response is complete, or RESPONSE_TRY_AGAIN.
+ */
+size_t fillFreshReadResponse(FreshReadStream& rs, uint8_t* buffer, size_t maxLen) {
+  if (!rs.ready) {
+    bool done = freshReadDone(rs.generation);
+    if (!done && millis() - rs.startMs < FRESH_TIMEOUT_MS) {
+      return RESPONSE_TRY_AGAIN;
+    }
+    rs.body = readingsJson(done);
+    rs.pos = 0;
+    rs.ready = true;
+  }
+  size_t n = min(maxLen, rs.body.length() - rs.pos);
+  memcpy(buffer, rs.body.c_str() + rs.pos, n);
+  rs.pos += n;
+  return n;
+}
+
 /**
  * Captive Request Handler for an Async Web Server.
  *
@@ -189,16 +875,159 @@ public:
   }
 };
 
+/**
+ * Returns the route class of a request for the rate limiter: the pages, the requests that change
+ * the configuration (the update and calibration routes, the alert API, and the configurable routes
+ * when called with parameters), and the data routes.
+ */
+RateClass rateClassOf(AsyncWebServerRequest* request) {
+  const String& url = request->url();
+  if (url == "/") {
+    return RATE_STATIC;
+  }
+  if (url.startsWith("/update") || url.startsWith("/calibrate") || url.startsWith("/api/")) {
+    return RATE_SETTINGS;
+  }
+  bool configurable = url == "/synthetic" || url == "/burst" || url == "/control" || url == "/alarm" || url == "/heartbeat" || url == "/reports";
+  return (configurable && request->params() > 0) ? RATE_SETTINGS : RATE_DATA;
+}
+
+/**
+ * Refuses the requests of clients over their rate limit (see ratelimit.h) with "429 Too Many
+ * Requests" and a Retry-After header. It is registered before every route, so a token is taken
+ * for each request and a refused request is answered before any response is built. Requests made
+ * through the captive portal are not limited.
+ */
+class RateLimitHandler : public AsyncWebHandler {
+public:
+  RateLimitHandler() {}
+  virtual ~RateLimitHandler() {}
+
+  bool canHandle(AsyncWebServerRequest* request) {
+    if (waiting_to_connect) {
+      return false;
+    }
+    return takeRateToken(rateLimiter, (uint32_t)request->client()->remoteIP(), rateClassOf(request), millis()) != 0;
+  }
+
+  void handleRequest(AsyncWebServerRequest* request) {
+    uint32_t waitMs = rateRetryAfterMs(rateLimiter, (uint32_t)request->client()->remoteIP(), rateClassOf(request), millis());
+    AsyncWebServerResponse* response = request->beginResponse(429, "text/plain", "Too many requests");
+    response->addHeader("Retry-After", String(max((waitMs + 999) / 1000, (uint32_t)1)));
+    request->send(response);
+  }
+};
+
+/**
+ * Handles "POST /api/alerts/<id>/ack", which acknowledges an open alert so its repeats are no
+ * longer sent until it closes, or until the end of the snooze given in seconds by the optional
+ * "snooze" parameter. An alert closed by a reading back in range cannot be acknowledged. The
+ * acknowledgment is applied by the main loop, which ignores it if the alert closed meanwhile.
+ */
+class AlertAckHandler : public AsyncWebHandler {
+public:
+  AlertAckHandler() {}
+  virtual ~AlertAckHandler() {}
+
+  bool canHandle(AsyncWebServerRequest* request) {
+    return request->method() == HTTP_POST && request->url().startsWith("/api/alerts/") && request->url().endsWith("/ack");
+  }
+
+  void handleRequest(AsyncWebServerRequest* request) {
+    const String& url = request->url();
+    uint32_t id = url.substring(strlen("/api/alerts/"), url.length() - strlen("/ack")).toInt();
+    int sensor = -1;
+    for (int i = 0; i < MAX_SENSORS; i++) {
+      if (id != 0 && alertStates[i].active && alertStates[i].id == id) {
+        sensor = i;
+      }
+    }
+    if (sensor < 0 && id != 0 && id < nextAlertId) {
+      request->send(409, "text/plain", "Alert is closed");
+      return;
+    }
+    if (sensor < 0) {
+      request->send(404, "text/plain", "Alert not found");
+      return;
+    }
+    long snooze = 0;
+    if (request->hasParam("snooze", true)) {
+      snooze = request->getParam("snooze", true)->value().toInt();
+    }
+    else if (request->hasParam("snooze")) {
+      snooze = request->getParam("snooze")->value().toInt();
+    }
+    if (snooze < 0 || snooze > 7 * 86400L) {
+      request->send(400, "text/plain", "Invalid snooze parameter");
+      return;
+    }
+    if (snooze > 0 && getEpochTime() == 0) {
+      request->send(503, "text/plain", "Clock not synchronized");
+      return;
+    }
+    AlertAckRequest& ack = alertAckRequests[sensor];
+    ack.id = id;
+    ack.snoozeSec = snooze;
+    ack.requested = ack.requested + 1;
+    request->send(202, "application/json", "{\"id\":" + String(id) + ",\"sensor\":" + String(sensor) + ",\"snooze\":" + String(snooze) + "}");
+  }
+};
+
+/**
+ * Handles "/reports", which lists the stored daily reports ("push" turns the webhook push of the
+ * reports on or off), and "/reports/<YYYY-MM-DD>.json" or ".csv", which returns a stored report
+ * as it was written at the end of that day.
+ */
+class ReportHandler : public AsyncWebHandler {
+public:
+  ReportHandler() {}
+  virtual ~ReportHandler() {}
+
+  bool canHandle(AsyncWebServerRequest* request) {
+    return request->method() == HTTP_GET && (request->url() == "/reports" || request->url().startsWith("/reports/"));
+  }
+
+  void handleRequest(AsyncWebServerRequest* request) {
+    const String& url = request->url();
+    if (url == "/reports") {
+      if (request->hasParam("push")) {
+        reportPush = request->getParam("push")->value().toInt() != 0;
+        saveReportPush();
+      }
+      request->send(200, "application/json", reportListJson());
+      return;
+    }
+    String name = url.substring(strlen("/reports/"));
+    bool csv = name.length() == 14 && name.endsWith(".csv");
+    bool json = name.length() == 15 && name.endsWith(".json");
+    if (!csv && !json) {
+      request->send(404, "text/plain", "Report not found");
+      return;
+    }
+    uint32_t date = name.substring(0, 4).toInt() * 10000 + name.substring(5, 7).toInt() * 100 + name.substring(8, 10).toInt();
+    int slot = findReportSlot(reportDates, date);
+    std::unique_ptr<DailyReport> report(new DailyReport);
+    if (slot < 0 || !loadDailyReport(slot, *report) || report->date != date) {
+      request->send(404, "text/plain", "Report not found");
+      return;
+    }
+    if (csv) {
+      request->send(200, "text/csv", dailyReportCsv(*report));
+    }
+    else {
+      request->send(200, "application/json", dailyReportJson(*report));
+    }
+  }
+};
+
 /**
  * Retrieves the current local time as a formatted string.
  *
- * This function configures the time for the ESP32 using the NTP server specified
- * by 'ntpServer' global variable, along with the GMT offset and daylight saving
- * time offset. It then retrieves the current local time and formats it into a
- * human-readable string format.
+ * The clock is synchronized by SNTP, started once by setupWiFi() with configTime(). This
+ * function only reads and formats the clock, without waiting: it is called for every sample.
  *
- * If the function fails to obtain the local time (for example, due to a failure
- * in connecting to the NTP server), it returns a placeholder string "--".
+ * If the clock has not been synchronized yet (for example, because the NTP server cannot be
+ * reached), it returns a placeholder string "--".
  *
  * @return A string representing the current local time formatted as
  *         "Weekday, Month Day Year Hour:Minute". If the time cannot be retrieved,
@@ -207,9 +1036,7 @@ public:
 String getLocalTime() {
   struct tm timeinfo;
 
-  configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
-
-  if (!getLocalTime(&timeinfo)) {
+  if (!getLocalTime(&timeinfo, 0)) {
     return "--";
   }
 
@@ -218,6 +1045,61 @@ String getLocalTime() {
   return String(timeString);
 }
 
+/**
+ * Returns the current time in seconds since the Unix epoch.
+ *
+ * The clock is synchronized by SNTP, started by setupWiFi().
+ *
+ * @return The current time, or 0 if the clock has not been synchronized yet.
+ */
+time_t getEpochTime() {
+  time_t now = time(nullptr);
+  if (now < MIN_VALID_EPOCH) {
+    return 0;
+  }
+  return now;
+}
+
+/**
+ * Formats a stored epoch time in local time.
+ *
+ * @param epoch The time in seconds since the Unix epoch, or 0 if unknown.
+ * @param format The strftime format to use.
+ * @return The formatted local time, or "--" if the time is unknown.
+ */
+String formatEpoch(time_t epoch, const char* format) {
+  if (epoch == 0) {
+    return "--";
+  }
+  struct tm timeinfo;
+  localtime_r(&epoch, &timeinfo);
+  char timeString[40];
+  strftime(timeString, sizeof(timeString), format, &timeinfo);
+  return String(timeString);
+}
+
+/**
+ * Formats a text as a quoted JSON string, escaping quotes, backslashes and control characters.
+ */
+String jsonString(const char* text) {
+  String json = "\"";
+  for (const char* c = text; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      json += '\\';
+      json += *c;
+    }
+    else if ((unsigned char)*c < 0x20) {
+      char escape[8];
+      snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)*c);
+      json += escape;
+    }
+    else {
+      json += *c;
+    }
+  }
+  return json + "\"";
+}
+
 /**
  * Sets up and configures the web server routes and handlers.
  *
@@ -229,8 +1111,40 @@ String getLocalTime() {
  * - The root ("/") route serves the main HTML page. It serves 'data_html' if the device is connected, or 'index_html' if it's in the setup phase.
  * - The "/data" route provides temperature data in JSON format.
  * - The "/info" route provides device and configuration info in JSON format.
+ * - The "/data" route accepts an optional "sensor" parameter to select the sensor (default 0).
+ * - "/data", "/read" and "/sensors" carry freshness headers: the conversion start time of the readings
+ *   served and their age since the conversion started and since they were published.
+ * - "/data" and "/read" also carry the time of the next sample, and a Cache-Control max-age until then.
+ * - The "/sensors" route lists the physical and virtual sensors with their latest reading.
+ * - The "/buses" route lists the 1-Wire buses with their health and timing statistics.
+ * - The "/drivers" route lists the sensor drivers with their capabilities and timing statistics.
+ * - The "/updateVirtualSensor" route defines, redefines or (with an empty expression) removes a virtual sensor.
+ * - The "/updateSensorGroup" route defines, redefines or (with no members) removes a group of redundant probes.
+ * - The "/updateSensorInterval" route sets the sampling interval of a sensor.
+ * - The "/synthetic" route shows and changes the synthetic waveform and load rate, with the ingest statistics.
+ * - The "/burst" route starts, stops or shows a burst capture of a few sensors at a short interval.
+ * - The "/burstData" route streams the burst capture as CSV, following it while it runs.
+ * - The "/alerts" route lists the open alerts with their start and last notification times and acknowledgment.
+ * - "POST /api/alerts/<id>/ack" acknowledges an alert, optionally for a snooze duration (see AlertAckHandler).
+ * - "/chain" shows the head of the reading hash chain and "/chain/export?from=<seq>" exports its blocks.
+ * - "/reports" lists the daily compliance reports, served by "/reports/<date>.json|csv" (see ReportHandler).
+ * - The "/snapshots" route lists the retained flight recorder snapshots of raised alerts.
+ * - The "/snapshot" route downloads a snapshot as CSV.
+ * - The "/control" route shows and changes the thermostat control configuration, with the relay state.
+ * - The "/alarm" route shows the local alarm, silences it, or maps a sensor's thresholds to alarm patterns.
+ * - The "/calibration" route lists the stored probe calibrations.
+ * - The "/updateCalibration" route sets a probe's offset and gain or calibration table, or removes it.
+ * - The "/calibrateTwoPoint" route records two reference measurements and derives a linear calibration.
+ * - The "/metrics" route provides the latest readings and counters in Prometheus text format.
+ * - The "/read" route returns the latest reading of every sensor; with "fresh=1" it waits, without blocking,
+ *   for a new sample shared by all concurrent callers.
+ * - The "/query" route streams time-bucketed aggregates of the stored readings in JSON format.
+ * - The "/stats" route provides the thermal model parameters and event counters for each sensor in JSON format.
  * - The "/updateSettings" route allows updating temperature thresholds and notification delay via query parameters.
  * - The "/get" route is used during the WiFi configuration phase to receive WiFi settings from the user.
+ *
+ * Once connected, every request first takes a token from its client's bucket for its route class;
+ * requests over the limit are refused with 429 by RateLimitHandler, registered in setup().
  */
 void setupServer() {
   server.on("/", HTTP_GET, [](AsyncWebServerRequest* request) {
@@ -244,15 +1158,37 @@ void setupServer() {
 
   if (!waiting_to_connect) {
     server.on("/data", HTTP_GET, [](AsyncWebServerRequest* request) {
-      String json = "[";
-      for (int i = 0; i < MAX_ROWS; i++) {
-        json += "{\"temperatureC\":\"" + temperatureArray[i].temperatureC + "\",\"temperatureF\":\"" + temperatureArray[i].temperatureF + "\",\"currentTime\":\"" + temperatureArray[i].currentTime + "\"}";
-        if (i < MAX_ROWS - 1) {
-          json += ",";
+      int sensor = request->hasParam("sensor") ? request->getParam("sensor")->value().toInt() : 0;
+      if (!sensorInUse(sensor)) {
+        request->send(400, "text/plain", "Invalid sensor parameter");
+        return;
+      }
+      int count = sensorSeries[sensor].count;
+      if (request->hasParam("format") && request->getParam("format")->value() == "csv") {
+        String csv = "epoch,sensor,celsius\n";
+        for (int i = 0; i < count; i++) {
+          const SeriesSample& sample = sensorSample(sensor, i);
+          csv += String(sample.epoch) + "," + String(sensor) + "," + formatTemperature(sample.centiC, false) + "\n";
+        }
+        AsyncWebServerResponse* response = request->beginResponse(200, "text/csv", csv);
+        addSeriesFreshnessHeaders(response, sensor);
+        addScheduleHeaders(response, msUntilNextPublish(sensor));
+        request->send(response);
+        return;
+      }
+      String json = "[";
+      for (int i = 0; i < count; i++) {
+        const SeriesSample& sample = sensorSample(sensor, i);
+        json += "{\"temperatureC\":\"" + formatTemperature(sample.centiC, false) + "\",\"temperatureF\":\"" + formatTemperature(sample.centiC, true) + "\",\"currentTime\":\"" + formatEpoch(sample.epoch, "%A, %B %d %Y %H:%M") + "\",\"epoch\":" + String(sample.epoch) + ",\"publishDelayMs\":" + String(sample.publishDelayMs) + "}";
+        if (i < count - 1) {
+          json += ",";
         }
       }
       json += "]";
-      request->send(200, "application/json", json);
+      AsyncWebServerResponse* response = request->beginResponse(200, "application/json", json);
+      addSeriesFreshnessHeaders(response, sensor);
+      addScheduleHeaders(response, msUntilNextPublish(sensor));
+      request->send(response);
       });
 
     server.on("/info", HTTP_GET, [](AsyncWebServerRequest* request) {
@@ -263,6 +1199,894 @@ void setupServer() {
       request->send(200, "application/json", json);
       });
 
+    server.on("/query", HTTP_GET, [](AsyncWebServerRequest* request) {
+      if (!request->hasParam("agg") || !request->hasParam("bucket")) {
+        request->send(400, "text/plain", "Missing agg or bucket parameter");
+        return;
+      }
+      int sensor = request->hasParam("sensor") ? request->getParam("sensor")->value().toInt() : 0;
+      QueryAgg agg = parseQueryAgg(request->getParam("agg")->value().c_str());
+      long bucketSec = parseQueryBucket(request->getParam("bucket")->value().c_str());
+      time_t from = request->hasParam("from") ? request->getParam("from")->value().toInt() : 0;
+      time_t to = request->hasParam("to") ? request->getParam("to")->value().toInt() : 0;
+      if (!sensorInUse(sensor) || agg == QUERY_AGG_INVALID || bucketSec == 0) {
+        request->send(400, "text/plain", "Invalid sensor, agg or bucket parameter");
+        return;
+      }
+
+      std::shared_ptr<QueryStream> stream(new QueryStream());
+      beginQuery(stream->query, agg, bucketSec, from, to);
+      stream->sensor = sensor;
+      stream->oldest = (sensorSeries[sensor].count < MAX_ROWS) ? 0 : sensorSeries[sensor].index;
+      stream->rows = sensorSeries[sensor].count;
+      stream->firstBucket = true;
+      request->send(request->beginChunkedResponse("application/json", [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return fillQueryResponse(*stream, buffer, maxLen);
+        }));
+      });
+
+    server.on("/read", HTTP_GET, [](AsyncWebServerRequest* request) {
+      if (!request->hasParam("fresh") || request->getParam("fresh")->value() != "1") {
+        AsyncWebServerResponse* response = request->beginResponse(200, "application/json", readingsJson(false));
+        addLatestFreshnessHeaders(response);
+        addScheduleHeaders(response, msUntilNextReading());
+        request->send(response);
+        return;
+      }
+      std::shared_ptr<FreshReadStream> stream(new FreshReadStream());
+      stream->generation = requestFreshRead(millis());
+      stream->startMs = millis();
+      stream->pos = 0;
+      stream->ready = false;
+      request->send(request->beginChunkedResponse("application/json", [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return fillFreshReadResponse(*stream, buffer, maxLen);
+        }));
+      });
+
+    server.on("/sensors", HTTP_GET, [](AsyncWebServerRequest* request) {
+      String json = "[";
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        const SensorInfo& info = sensorTable[i];
+        if (info.kind == SENSOR_NONE) {
+          continue;
+        }
+        if (json.length() > 1) {
+          json += ",";
+        }
+        json += "{\"sensor\":" + String(i);
+        json += ",\"name\":\"" + String(info.name) + "\"";
+        json += ",\"kind\":\"" + String(sensorKindName(info.kind)) + "\"";
+        if (info.kind == SENSOR_PHYSICAL) {
+          json += ",\"driver\":\"" + String(sensorDrivers[info.driver].name) + "\"";
+          json += ",\"channel\":" + String(info.channel);
+          if (info.driver == DRIVER_DS18B20 && info.channel < ds18b20ChannelCount) {
+            json += ",\"bus\":" + String(ds18b20Channels[info.channel].bus);
+          }
+          json += ",\"rom\":\"" + romToString(info.rom) + "\"";
+          json += ",\"present\":" + String(info.present ? "true" : "false");
+          json += ",\"calibration\":\"" + String(calibrationName(info.calibration)) + "\"";
+          json += ",\"rawTemperatureC\":\"" + formatTemperature(latestRawCentiC[i], false) + "\"";
+          json += ",\"group\":" + String(sensorGroupOf(i));
+        }
+        else if (info.kind == SENSOR_VIRTUAL) {
+          json += ",\"expr\":\"" + String(info.expr) + "\"";
+        }
+        else if (info.kind == SENSOR_GROUP) {
+          json += ",\"mode\":\"" + String(groupModeName(info.group.mode)) + "\"";
+          json += ",\"tolerance\":" + String(info.group.tolerance / 100.0);
+          String members = "";
+          String failed = "";
+          for (int j = 0; j < MAX_SENSORS; j++) {
+            if (info.group.memberMask & (1 << j)) {
+              members += (members.length() > 0 ? "," : "") + String(j);
+            }
+            if (info.group.failedMask & (1 << j)) {
+              failed += (failed.length() > 0 ? "," : "") + String(j);
+            }
+          }
+          json += ",\"members\":[" + members + "]";
+          json += ",\"failed\":[" + failed + "]";
+          json += ",\"disagreeing\":" + String(info.group.disagreeing ? "true" : "false");
+          json += ",\"spread\":" + String(info.group.spread / 100.0);
+        }
+        json += ",\"temperatureC\":\"" + formatTemperature(latestCentiC[i], false) + "\"";
+        json += ",\"interval\":" + String(sensorIntervalMs(i, timerDelay) / 1000);
+        json += ",\"minTemp\":" + jsonNumber(sensorMinTemp(i), 2);
+        json += ",\"maxTemp\":" + jsonNumber(sensorMaxTemp(i), 2);
+        json += "}";
+      }
+      json += "]";
+      AsyncWebServerResponse* response = request->beginResponse(200, "application/json", json);
+      addLatestFreshnessHeaders(response);
+      request->send(response);
+      });
+
+    server.on("/buses", HTTP_GET, [](AsyncWebServerRequest* request) {
+      String json = "[";
+      for (int b = 0; b < ONE_WIRE_BUS_COUNT; b++) {
+        const BusStats& stats = busStats[b];
+        if (b > 0) {
+          json += ",";
+        }
+        json += "{\"bus\":" + String(b);
+        json += ",\"pin\":" + String(ONE_WIRE_PINS[b]);
+        json += ",\"devices\":" + String(stats.devices);
+        json += ",\"parasite\":" + String(stats.parasite ? "true" : "false");
+        json += ",\"healthy\":" + String((stats.devices > 0 && stats.lastErrors == 0) ? "true" : "false");
+        json += ",\"conversions\":" + String(stats.conversions);
+        json += ",\"readErrors\":" + String(stats.readErrors);
+        json += ",\"lastErrors\":" + String(stats.lastErrors);
+        json += ",\"lastConversionMs\":" + String(stats.lastConversionMs);
+        json += ",\"maxConversionMs\":" + String(stats.maxConversionMs);
+        json += ",\"lastReadMs\":" + String(stats.lastReadMs);
+        json += "}";
+      }
+      json += "]";
+      request->send(200, "application/json", json);
+      });
+
+    server.on("/drivers", HTTP_GET, [](AsyncWebServerRequest* request) {
+      String json = "[";
+      for (int d = 0; d < DRIVER_COUNT; d++) {
+        const SensorDriver& driver = sensorDrivers[d];
+        const DriverStats& stats = driverStats[d];
+        if (d > 0) {
+          json += ",";
+        }
+        json += "{\"driver\":\"" + String(driver.name) + "\"";
+        json += ",\"uniqueId\":" + String((driver.caps & DRIVER_CAP_UNIQUE_ID) ? "true" : "false");
+        json += ",\"pollReady\":" + String((driver.caps & DRIVER_CAP_POLL_READY) ? "true" : "false");
+        json += ",\"simulated\":" + String((driver.caps & DRIVER_CAP_SIMULATED) ? "true" : "false");
+        json += ",\"hotplug\":" + String((driver.caps & DRIVER_CAP_HOTPLUG) ? "true" : "false");
+        json += ",\"channels\":" + String(stats.channels);
+        json += ",\"conversions\":" + String(stats.conversions);
+        json += ",\"readErrors\":" + String(stats.readErrors);
+        json += ",\"lastConversionMs\":" + String(stats.lastConversionMs);
+        json += ",\"lastReadMs\":" + String(stats.lastReadMs);
+        json += "}";
+      }
+      json += "]";
+      request->send(200, "application/json", json);
+      });
+
+    server.on("/updateVirtualSensor", HTTP_GET, [](AsyncWebServerRequest* request) {
+      if (!request->hasParam("name")) {
+        request->send(400, "text/plain", "Missing name parameter");
+        return;
+      }
+      String name = request->getParam("name")->value();
+      String expr = request->hasParam("expr") ? request->getParam("expr")->value() : "";
+      SensorChange change;
+      memset(&change, 0, sizeof(change));
+      int slot;
+      const char* error;
+      if (expr.length() == 0) {
+        change.kind = CHANGE_REMOVE_VIRTUAL;
+        error = checkRemoveVirtualSensor(name, slot);
+      }
+      else {
+        ExprProgram program;
+        change.kind = CHANGE_DEFINE_VIRTUAL;
+        change.minTemp = request->hasParam("minTemperature") ? request->getParam("minTemperature")->value().toFloat() : NAN;
+        change.maxTemp = request->hasParam("maxTemperature") ? request->getParam("maxTemperature")->value().toFloat() : NAN;
+        error = checkVirtualSensor(name, expr, slot, program);
+      }
+      if (error != nullptr) {
+        request->send(400, "text/plain", error);
+        return;
+      }
+      strncpy(change.name, name.c_str(), SENSOR_NAME_LEN - 1);
+      strncpy(change.expr, expr.c_str(), SENSOR_EXPR_LEN - 1);
+      if (!queueSensorChange(change)) {
+        request->send(503, "text/plain", "Too many pending changes, try again");
+        return;
+      }
+      request->send(202, "text/plain", "Virtual sensor update accepted");
+      });
+
+    server.on("/updateSensorGroup", HTTP_GET, [](AsyncWebServerRequest* request) {
+      if (!request->hasParam("name")) {
+        request->send(400, "text/plain", "Missing name parameter");
+        return;
+      }
+      String name = request->getParam("name")->value();
+      String members = request->hasParam("members") ? request->getParam("members")->value() : "";
+      SensorChange change;
+      memset(&change, 0, sizeof(change));
+      int slot;
+      const char* error;
+      if (members.length() == 0) {
+        change.kind = CHANGE_REMOVE_GROUP;
+        error = checkRemoveSensorGroup(name, slot);
+      }
+      else {
+        change.kind = CHANGE_DEFINE_GROUP;
+        change.memberMask = parseSensorList(members);
+        change.mode = GROUP_MEDIAN;
+        if (request->hasParam("mode") && request->getParam("mode")->value() == "vote") {
+          change.mode = GROUP_VOTE;
+        }
+        change.tolerance = request->hasParam("tolerance") ? request->getParam("tolerance")->value().toFloat() : 0.5;
+        change.minTemp = request->hasParam("minTemperature") ? request->getParam("minTemperature")->value().toFloat() : NAN;
+        change.maxTemp = request->hasParam("maxTemperature") ? request->getParam("maxTemperature")->value().toFloat() : NAN;
+        error = checkSensorGroup(name, change.memberMask, change.tolerance, slot);
+      }
+      if (error != nullptr) {
+        request->send(400, "text/plain", error);
+        return;
+      }
+      strncpy(change.name, name.c_str(), SENSOR_NAME_LEN - 1);
+      if (!queueSensorChange(change)) {
+        request->send(503, "text/plain", "Too many pending changes, try again");
+        return;
+      }
+      request->send(202, "text/plain", "Sensor group update accepted");
+      });
+
+    server.on("/updateSensorInterval", HTTP_GET, [](AsyncWebServerRequest* request) {
+      if (!request->hasParam("sensor") || !request->hasParam("interval")) {
+        request->send(400, "text/plain", "Missing sensor or interval parameter");
+        return;
+      }
+      int sensor = request->getParam("sensor")->value().toInt();
+      long interval = request->getParam("interval")->value().toInt();
+      if (!sensorInUse(sensor) || interval < 0 || interval > 86400) {
+        request->send(400, "text/plain", "Invalid sensor or interval parameter");
+        return;
+      }
+      SensorChange change;
+      memset(&change, 0, sizeof(change));
+      change.kind = CHANGE_INTERVAL;
+      strncpy(change.name, sensorTable[sensor].name, SENSOR_NAME_LEN - 1);
+      change.sensor = sensor;
+      change.intervalMs = interval * 1000UL;
+      if (!queueSensorChange(change)) {
+        request->send(503, "text/plain", "Too many pending changes, try again");
+        return;
+      }
+      request->send(202, "text/plain", "Sampling interval update accepted");
+      });
+
+    server.on("/synthetic", HTTP_GET, [](AsyncWebServerRequest* request) {
+      // The waveform is read by the main loop while it samples, so a change is queued for it;
+      // the response shows the configuration it will apply.
+      SensorChange change;
+      memset(&change, 0, sizeof(change));
+      change.kind = CHANGE_SYNTHETIC;
+      strncpy(change.name, "synthetic", SENSOR_NAME_LEN - 1);
+      change.synthetic = syntheticConfig;
+      SyntheticConfig& config = change.synthetic;
+      if (request->hasParam("waveform")) {
+        SyntheticWaveform waveform = findSyntheticWaveform(request->getParam("waveform")->value().c_str());
+        if (waveform == SYNTHETIC_WAVEFORM_COUNT) {
+          request->send(400, "text/plain", "Invalid waveform parameter");
+          return;
+        }
+        config.waveform = waveform;
+      }
+      if (request->hasParam("base")) {
+        config.baseCentiC = (int16_t)constrain(lroundf(request->getParam("base")->value().toFloat() * 100), -5500L, 12500L);
+      }
+      if (request->hasParam("amplitude")) {
+        config.amplitudeCentiC = (int16_t)constrain(lroundf(request->getParam("amplitude")->value().toFloat() * 100), 0L, 10000L);
+      }
+      if (request->hasParam("period")) {
+        config.periodMs = constrain(request->getParam("period")->value().toInt(), 1L, 86400L) * 1000UL;
+      }
+      if (request->hasParam("rate")) {
+        long rate = request->getParam("rate")->value().toInt();
+        if (rate < 0 || rate > (long)SYNTHETIC_MAX_RATE_HZ) {
+          request->send(400, "text/plain", "Invalid rate parameter");
+          return;
+        }
+        config.rateHz = rate;
+        change.setRate = true;
+      }
+      bool changed = request->hasParam("waveform") || request->hasParam("base") || request->hasParam("amplitude") || request->hasParam("period") || change.setRate;
+      if (changed && !queueSensorChange(change)) {
+        request->send(503, "text/plain", "Too many pending changes, try again");
+        return;
+      }
+      String json = "{\"channels\":" + String(driverStats[DRIVER_SYNTHETIC].channels);
+      json += ",\"waveform\":\"" + String(syntheticWaveformName(config.waveform)) + "\"";
+      json += ",\"base\":" + String(config.baseCentiC / 100.0);
+      json += ",\"amplitude\":" + String(config.amplitudeCentiC / 100.0);
+      json += ",\"period\":" + String(config.periodMs / 1000);
+      json += ",\"rate\":" + String(config.rateHz);
+      json += ",\"samples\":" + String(loadStats.samples);
+      json += ",\"dropped\":" + String(loadStats.dropped);
+      json += ",\"ingestRate\":" + String(syntheticIngestRate(), 1);
+      json += ",\"stages\":[";
+      for (int st = 0; st < STAGE_COUNT; st++) {
+        const StageStats& stats = stageStats[st];
+        if (st > 0) {
+          json += ",";
+        }
+        json += "{\"stage\":\"" + String(pipelineStageName((PipelineStage)st)) + "\"";
+        json += ",\"count\":" + String(stats.count);
+        json += ",\"avgUs\":" + String(stats.count > 0 ? (unsigned long)(stats.totalUs / stats.count) : 0UL);
+        json += ",\"maxUs\":" + String(stats.maxUs);
+        json += "}";
+      }
+      json += "]}";
+      request->send(200, "application/json", json);
+      });
+
+    server.on("/burst", HTTP_GET, [](AsyncWebServerRequest* request) {
+      // The burst is sampled by the main loop, so a start or stop is checked and queued for it.
+      if (!request->hasParam("stop") && !request->hasParam("sensors")) {
+        request->send(200, "application/json", burstJson());
+        return;
+      }
+      SensorChange change;
+      memset(&change, 0, sizeof(change));
+      strncpy(change.name, "burst", SENSOR_NAME_LEN - 1);
+      if (request->hasParam("stop")) {
+        change.kind = CHANGE_STOP_BURST;
+      }
+      else {
+        uint16_t mask = parseSensorList(request->getParam("sensors")->value());
+        int count = 0;
+        for (int i = 0; i < MAX_SENSORS; i++) {
+          if (!(mask & (1 << i))) {
+            continue;
+          }
+          if (!sensorInUse(i) || count == BURST_MAX_SENSORS) {
+            request->send(400, "text/plain", "Invalid sensors parameter");
+            return;
+          }
+          count++;
+        }
+        unsigned long interval = request->hasParam("interval") ? request->getParam("interval")->value().toInt() : 1;
+        unsigned long duration = request->hasParam("duration") ? request->getParam("duration")->value().toInt() : 600;
+        const char* error = checkBurst(count, interval * 1000UL, duration * 1000UL);
+        if (error != nullptr) {
+          request->send(400, "text/plain", error);
+          return;
+        }
+        change.kind = CHANGE_START_BURST;
+        change.memberMask = mask;
+        change.intervalMs = interval * 1000UL;
+        change.durationMs = duration * 1000UL;
+      }
+      if (!queueSensorChange(change)) {
+        request->send(503, "text/plain", "Too many pending changes, try again");
+        return;
+      }
+      request->send(202, "text/plain", change.kind == CHANGE_STOP_BURST ? "Burst stop accepted" : "Burst start accepted");
+      });
+
+    server.on("/burstData", HTTP_GET, [](AsyncWebServerRequest* request) {
+      if (burst.id == 0) {
+        request->send(404, "text/plain", "No burst captured");
+        return;
+      }
+      std::shared_ptr<BurstStream> stream(new BurstStream());
+      stream->id = burst.id;
+      request->send(request->beginChunkedResponse("text/csv", [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return fillBurstResponse(*stream, buffer, maxLen, TEMP_INVALID, RESPONSE_TRY_AGAIN);
+        }));
+      });
+
+    server.on("/alerts", HTTP_GET, [](AsyncWebServerRequest* request) {
+      String json = "[";
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        const AlertState& state = alertStates[i];
+        if (!state.active || syntheticSensor(i)) {
+          continue;
+        }
+        if (json.length() > 1) {
+          json += ",";
+        }
+        json += "{\"id\":" + String(state.id);
+        json += ",\"sensor\":" + String(i);
+        json += ",\"name\":\"" + String(sensorTable[i].name) + "\"";
+        json += ",\"start\":" + String(state.startEpoch);
+        json += ",\"lastNotification\":" + String(state.lastNotifyEpoch);
+        json += ",\"acknowledged\":" + String(state.ackUntilEpoch != 0 ? "true" : "false");
+        json += ",\"snoozeUntil\":" + String(state.ackUntilEpoch == ALERT_ACK_UNTIL_RECOVERY ? 0 : state.ackUntilEpoch) + "}";
+      }
+      json += "]";
+      request->send(200, "application/json", json);
+      });
+
+    server.addHandler(new AlertAckHandler());
+    server.addHandler(new ReportHandler());
+
+    // Registered before "/chain", which would also match "/chain/export".
+    server.on("/chain/export", HTTP_GET, [](AsyncWebServerRequest* request) {
+      uint32_t from = request->hasParam("from") ? request->getParam("from")->value().toInt() : 0;
+      std::shared_ptr<ChainExport> stream(new ChainExport());
+      startChainExport(chainState, *stream, from);
+      request->send(request->beginChunkedResponse("text/plain", [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return fillChainExport(chainState, *stream, buffer, maxLen);
+        }));
+      });
+
+    server.on("/chain", HTTP_GET, [](AsyncWebServerRequest* request) {
+      // The head of a previous boot is not in the ring; it only changes at the next seal.
+      ChainBlock block;
+      uint32_t seq = chainState.sealed;
+      char hash[2 * CHAIN_HASH_SIZE + 1];
+      chainHashHex(copyChainBlock(chainState, seq, block) ? block.hash : chainState.head.hash, hash);
+      String json = "{\"seq\":" + String(seq);
+      json += ",\"hash\":\"" + String(hash) + "\"";
+      json += ",\"oldest\":" + String(seq >= chainState.firstSeq ? oldestChainBlock(chainState) : 0);
+      json += ",\"blockRecords\":" + String(CHAIN_BLOCK_RECORDS);
+      json += ",\"pending\":" + String(chainState.pendingCount);
+      json += ",\"hashUs\":" + String(chainState.lastHashUs);
+      json += ",\"maxHashUs\":" + String(chainState.maxHashUs) + "}";
+      request->send(200, "application/json", json);
+      });
+
+    server.on("/snapshots", HTTP_GET, [](AsyncWebServerRequest* request) {
+      String json = "[";
+      for (int i = 0; i < RECORDER_SNAPSHOTS; i++) {
+        const Snapshot& snapshot = snapshots[i];
+        if (snapshot.id == 0) {
+          continue;
+        }
+        if (json.length() > 1) {
+          json += ",";
+        }
+        json += "{\"id\":" + String(snapshot.id);
+        json += ",\"sensor\":" + String(snapshot.sensor);
+        json += ",\"trigger\":" + String(snapshot.triggerEpoch);
+        json += ",\"temperatureC\":\"" + formatTemperature(snapshot.triggerCentiC, false) + "\"";
+        json += ",\"rows\":" + String(snapshot.rows);
+        json += ",\"preRows\":" + String(snapshot.preRows);
+        json += ",\"complete\":" + String(snapshot.complete ? "true" : "false") + "}";
+      }
+      json += "]";
+      request->send(200, "application/json", json);
+      });
+
+    server.on("/snapshot", HTTP_GET, [](AsyncWebServerRequest* request) {
+      const Snapshot* snapshot = request->hasParam("id") ? findSnapshot(request->getParam("id")->value().toInt()) : nullptr;
+      if (snapshot == nullptr) {
+        request->send(404, "text/plain", "Snapshot not found");
+        return;
+      }
+      String csv = "epoch,sensor,celsius\n";
+      for (int i = 0; i < snapshot->rows; i++) {
+        csv += String(snapshot->epochs[i]) + "," + String(snapshot->sensor) + "," + formatTemperature(snapshot->centiC[i], false) + "\n";
+      }
+      request->send(200, "text/csv", csv);
+      });
+
+    server.on("/control", HTTP_GET, [](AsyncWebServerRequest* request) {
+      if (request->params() > 0) {
+        ControlConfig config = controlConfig;
+        if (request->hasParam("mode")) {
+          config.mode = findControlMode(request->getParam("mode")->value().c_str());
+        }
+        if (request->hasParam("sensor")) {
+          long sensor = request->getParam("sensor")->value().toInt();
+          if (!sensorInUse(sensor)) {
+            request->send(400, "text/plain", "Invalid sensor parameter");
+            return;
+          }
+          config.sensor = sensor;
+        }
+        if (request->hasParam("action")) {
+          config.cooling = request->getParam("action")->value() != "heat";
+        }
+        if (request->hasParam("setpoint")) {
+          config.setpointCentiC = (int16_t)constrain(lroundf(request->getParam("setpoint")->value().toFloat() * 100), -5500L, 12500L);
+        }
+        if (request->hasParam("hysteresis")) {
+          config.hysteresisCentiC = (int16_t)constrain(lroundf(request->getParam("hysteresis")->value().toFloat() * 100), -1L, 2000L);
+        }
+        if (request->hasParam("kp")) {
+          config.kp = request->getParam("kp")->value().toInt();
+        }
+        if (request->hasParam("ki")) {
+          config.ki = request->getParam("ki")->value().toInt();
+        }
+        if (request->hasParam("kd")) {
+          config.kd = request->getParam("kd")->value().toInt();
+        }
+        if (request->hasParam("period")) {
+          config.periodMs = request->getParam("period")->value().toInt();
+        }
+        if (request->hasParam("window")) {
+          config.windowMs = request->getParam("window")->value().toInt() * 1000UL;
+        }
+        if (request->hasParam("minOn")) {
+          config.minOnMs = request->getParam("minOn")->value().toInt() * 1000UL;
+        }
+        if (request->hasParam("minOff")) {
+          config.minOffMs = request->getParam("minOff")->value().toInt() * 1000UL;
+        }
+        if (request->hasParam("stale")) {
+          config.staleMs = request->getParam("stale")->value().toInt() * 1000UL;
+        }
+        if (request->hasParam("failsafe")) {
+          config.failsafeDuty = (uint16_t)constrain(lroundf(request->getParam("failsafe")->value().toFloat() * 10), 0L, 1001L);
+        }
+        const char* error = checkControlConfig(config, MAX_SENSORS);
+        if (error != nullptr) {
+          request->send(400, "text/plain", error);
+          return;
+        }
+        setControlConfig(config);
+      }
+      request->send(200, "application/json", controlJson());
+      });
+
+    server.on("/alarm", HTTP_GET, [](AsyncWebServerRequest* request) {
+      if (request->hasParam("silence")) {
+        requestAlarmSilence();
+      }
+      if (request->hasParam("sensor")) {
+        long sensor = request->getParam("sensor")->value().toInt();
+        if (!sensorInUse(sensor)) {
+          request->send(400, "text/plain", "Invalid sensor parameter");
+          return;
+        }
+        // The rules are read by the main loop as it updates the alarm, so a change is queued for it.
+        SensorChange change;
+        memset(&change, 0, sizeof(change));
+        change.kind = CHANGE_ALARM_RULE;
+        strncpy(change.name, sensorTable[sensor].name, SENSOR_NAME_LEN - 1);
+        change.sensor = sensor;
+        AlarmRule& rule = change.alarmRule;
+        rule = alarmRules[sensor];
+        if (request->hasParam("low")) {
+          rule.lowPattern = findAlarmPattern(request->getParam("low")->value().c_str());
+        }
+        if (request->hasParam("high")) {
+          rule.highPattern = findAlarmPattern(request->getParam("high")->value().c_str());
+        }
+        if (rule.lowPattern == ALARM_PATTERN_COUNT || rule.highPattern == ALARM_PATTERN_COUNT) {
+          request->send(400, "text/plain", "Invalid pattern");
+          return;
+        }
+        if (!queueSensorChange(change)) {
+          request->send(503, "text/plain", "Too many pending changes, try again");
+          return;
+        }
+        request->send(202, "text/plain", "Alarm rule update accepted");
+        return;
+      }
+      request->send(200, "application/json", alarmJson());
+      });
+
+    server.on("/heartbeat", HTTP_GET, [](AsyncWebServerRequest* request) {
+      // The URL is read by the main loop when it posts a heartbeat, so a change is queued for it;
+      // the response shows the configuration it will apply.
+      if (request->hasParam("interval") || request->hasParam("url")) {
+        SensorChange change;
+        memset(&change, 0, sizeof(change));
+        change.kind = CHANGE_HEARTBEAT;
+        strncpy(change.name, "heartbeat", SENSOR_NAME_LEN - 1);
+        change.heartbeat = heartbeatConfig;
+        HeartbeatConfig& config = change.heartbeat;
+        if (request->hasParam("interval")) {
+          config.intervalSec = request->getParam("interval")->value().toInt();
+        }
+        if (request->hasParam("url")) {
+          const String& url = request->getParam("url")->value();
+          if (url.length() >= sizeof(config.url)) {
+            request->send(400, "text/plain", "URL too long");
+            return;
+          }
+          strcpy(config.url, url.c_str());
+        }
+        const char* error = checkHeartbeatConfig(config);
+        if (error != nullptr) {
+          request->send(400, "text/plain", error);
+          return;
+        }
+        if (!queueSensorChange(change)) {
+          request->send(503, "text/plain", "Too many pending changes, try again");
+          return;
+        }
+        request->send(202, "application/json", heartbeatJson(config));
+        return;
+      }
+      request->send(200, "application/json", heartbeatJson(heartbeatConfig));
+      });
+
+    server.on("/calibration", HTTP_GET, [](AsyncWebServerRequest* request) {
+      String json = "[";
+      for (int i = 0; i < CALIB_MAX_ENTRIES; i++) {
+        const Calibration& c = calibrations[i];
+        if (c.mode == CALIB_NONE) {
+          continue;
+        }
+        if (json.length() > 1) {
+          json += ",";
+        }
+        json += "{\"rom\":\"" + romToString(c.rom) + "\"";
+        json += ",\"mode\":\"" + String(calibrationName(i)) + "\"";
+        if (c.mode == CALIB_LINEAR) {
+          json += ",\"gain\":" + String((float)c.gain / CALIB_GAIN_ONE, 5);
+          json += ",\"offset\":" + String(c.offset / 100.0);
+        }
+        else {
+          json += ",\"points\":[";
+          for (int j = 0; j < c.points; j++) {
+            json += (j > 0 ? ",[" : "[") + String(c.raw[j] / 100.0) + "," + String(c.ref[j] / 100.0) + "]";
+          }
+          json += "]";
+        }
+        json += "}";
+      }
+      json += "]";
+      request->send(200, "application/json", json);
+      });
+
+    server.on("/updateCalibration", HTTP_GET, [](AsyncWebServerRequest* request) {
+      int sensor = request->hasParam("sensor") ? request->getParam("sensor")->value().toInt() : -1;
+      if (!sensorInUse(sensor) || sensorTable[sensor].kind != SENSOR_PHYSICAL) {
+        request->send(400, "text/plain", "Invalid sensor parameter");
+        return;
+      }
+      SensorChange change;
+      memset(&change, 0, sizeof(change));
+      strncpy(change.name, sensorTable[sensor].name, SENSOR_NAME_LEN - 1);
+      Calibration& entry = change.calibration;
+      memcpy(entry.rom, sensorTable[sensor].rom, 8);
+      if (request->hasParam("clear")) {
+        change.kind = CHANGE_REMOVE_CALIBRATION;
+        if (!queueSensorChange(change)) {
+          request->send(503, "text/plain", "Too many pending changes, try again");
+          return;
+        }
+        request->send(202, "text/plain", "Calibration removal accepted");
+        return;
+      }
+
+      change.kind = CHANGE_SET_CALIBRATION;
+      if (request->hasParam("points")) {
+        String points = request->getParam("points")->value();
+        int start = 0;
+        entry.mode = CALIB_TABLE;
+        while (start < (int)points.length()) {
+          int end = points.indexOf(',', start);
+          if (end < 0) {
+            end = points.length();
+          }
+          int colon = points.indexOf(':', start);
+          if (colon < 0 || colon > end || entry.points >= CALIB_MAX_POINTS) {
+            request->send(400, "text/plain", "Invalid points parameter");
+            return;
+          }
+          entry.raw[entry.points] = lroundf(points.substring(start, colon).toFloat() * 100.0);
+          entry.ref[entry.points] = lroundf(points.substring(colon + 1, end).toFloat() * 100.0);
+          entry.points++;
+          start = end + 1;
+        }
+      }
+      else {
+        float gain = request->hasParam("gain") ? request->getParam("gain")->value().toFloat() : 1.0;
+        float offset = request->hasParam("offset") ? request->getParam("offset")->value().toFloat() : 0.0;
+        entry.mode = CALIB_LINEAR;
+        entry.gain = lroundf(gain * CALIB_GAIN_ONE);
+        entry.offset = lroundf(offset * 100.0);
+      }
+
+      const char* error = checkCalibration(entry);
+      if (error != nullptr) {
+        request->send(400, "text/plain", error);
+        return;
+      }
+      if (!queueSensorChange(change)) {
+        request->send(503, "text/plain", "Too many pending changes, try again");
+        return;
+      }
+      request->send(202, "text/plain", "Calibration update accepted");
+      });
+
+    server.on("/calibrateTwoPoint", HTTP_GET, [](AsyncWebServerRequest* request) {
+      int sensor = request->hasParam("sensor") ? request->getParam("sensor")->value().toInt() : -1;
+      if (!sensorInUse(sensor) || sensorTable[sensor].kind != SENSOR_PHYSICAL || !request->hasParam("reference")) {
+        request->send(400, "text/plain", "Invalid sensor or missing reference parameter");
+        return;
+      }
+      int16_t raw = latestRawCentiC[sensor];
+      int16_t ref = lroundf(request->getParam("reference")->value().toFloat() * 100.0);
+      if (raw == TEMP_INVALID) {
+        request->send(409, "text/plain", "Sensor has no reading");
+        return;
+      }
+      if (twoPointRaw[sensor] == TEMP_INVALID || request->hasParam("restart")) {
+        twoPointRaw[sensor] = raw;
+        twoPointRef[sensor] = ref;
+        request->send(200, "text/plain", "First point recorded at raw " + formatTemperature(raw, false) + " C; apply the second reference and call again");
+        return;
+      }
+
+      SensorChange change;
+      memset(&change, 0, sizeof(change));
+      change.kind = CHANGE_SET_CALIBRATION;
+      strncpy(change.name, sensorTable[sensor].name, SENSOR_NAME_LEN - 1);
+      memcpy(change.calibration.rom, sensorTable[sensor].rom, 8);
+      const char* error = twoPointCalibration(change.calibration, twoPointRaw[sensor], twoPointRef[sensor], raw, ref);
+      if (error == nullptr) {
+        error = checkCalibration(change.calibration);
+      }
+      twoPointRaw[sensor] = TEMP_INVALID;
+      if (error != nullptr) {
+        request->send(400, "text/plain", error);
+        return;
+      }
+      if (!queueSensorChange(change)) {
+        request->send(503, "text/plain", "Too many pending changes, try again");
+        return;
+      }
+      request->send(202, "text/plain", "Calibration update accepted");
+      });
+
+    server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest* request) {
+      String text = "";
+      text += "# TYPE tempserver_temperature_celsius gauge\n";
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        if (sensorTable[i].kind == SENSOR_NONE || latestCentiC[i] == TEMP_INVALID) {
+          continue;
+        }
+        text += "tempserver_temperature_celsius{sensor=\"" + String(i) + "\",name=\"" + String(sensorTable[i].name) + "\",kind=\"" + String(sensorKindName(sensorTable[i].kind)) + "\"} " + formatTemperature(latestCentiC[i], false) + "\n";
+      }
+      text += "# TYPE tempserver_alert_active gauge\n";
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        if (sensorTable[i].kind == SENSOR_NONE) {
+          continue;
+        }
+        text += "tempserver_alert_active{sensor=\"" + String(i) + "\"} " + String(alertStates[i].active ? 1 : 0) + "\n";
+      }
+      text += "# TYPE tempserver_alert_acknowledged gauge\n";
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        if (sensorTable[i].kind != SENSOR_NONE) {
+          text += "tempserver_alert_acknowledged{sensor=\"" + String(i) + "\"} " + String(alertStates[i].ackUntilEpoch != 0 ? 1 : 0) + "\n";
+        }
+      }
+      text += "# TYPE tempserver_alert_suppressed_total counter\n";
+      text += "tempserver_alert_suppressed_total " + String(suppressedAlertRepeats) + "\n";
+      text += "# TYPE tempserver_chain_blocks_total counter\n";
+      text += "tempserver_chain_blocks_total " + String(chainState.seals) + "\n";
+      text += "# TYPE tempserver_chain_seal_max_microseconds gauge\n";
+      text += "tempserver_chain_seal_max_microseconds " + String(chainState.maxHashUs) + "\n";
+      text += "# TYPE tempserver_heartbeats_total counter\n";
+      text += "tempserver_heartbeats_total " + String(heartbeatState.seq) + "\n";
+      text += "# TYPE tempserver_heartbeat_failures_total counter\n";
+      text += "tempserver_heartbeat_failures_total " + String(heartbeatState.totalFailures) + "\n";
+      text += "# TYPE tempserver_group_spread_celsius gauge\n";
+      text += "# TYPE tempserver_group_failed_members gauge\n";
+      text += "# TYPE tempserver_group_disagreement gauge\n";
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        if (sensorTable[i].kind != SENSOR_GROUP) {
+          continue;
+        }
+        const SensorGroup& group = sensorTable[i].group;
+        int failed = 0;
+        for (int j = 0; j < MAX_SENSORS; j++) {
+          failed += (group.failedMask >> j) & 1;
+        }
+        String label = "{sensor=\"" + String(i) + "\"} ";
+        text += "tempserver_group_spread_celsius" + label + String(group.spread / 100.0) + "\n";
+        text += "tempserver_group_failed_members" + label + String(failed) + "\n";
+        text += "tempserver_group_disagreement" + label + String(group.disagreeing ? 1 : 0) + "\n";
+      }
+      text += "# TYPE tempserver_bus_devices gauge\n";
+      text += "# TYPE tempserver_bus_read_errors_total counter\n";
+      text += "# TYPE tempserver_bus_conversion_milliseconds gauge\n";
+      for (int b = 0; b < ONE_WIRE_BUS_COUNT; b++) {
+        String label = "{bus=\"" + String(b) + "\",pin=\"" + String(ONE_WIRE_PINS[b]) + "\"} ";
+        text += "tempserver_bus_devices" + label + String(busStats[b].devices) + "\n";
+        text += "tempserver_bus_read_errors_total" + label + String(busStats[b].readErrors) + "\n";
+        text += "tempserver_bus_conversion_milliseconds" + label + String(busStats[b].lastConversionMs) + "\n";
+      }
+      text += "# TYPE tempserver_sample_duration_milliseconds gauge\n";
+      text += "tempserver_sample_duration_milliseconds " + String(lastSampleMs) + "\n";
+      text += latencyHistogramText("tempserver_sample_publish_latency_milliseconds", freshness.publishLatency);
+      text += latencyHistogramText("tempserver_publish_delivery_latency_milliseconds", freshness.deliveryLatency);
+      text += "# TYPE tempserver_sample_age_milliseconds gauge\n";
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        if (sensorTable[i].kind != SENSOR_NONE && freshness.stamps[i].generation != 0) {
+          text += "tempserver_sample_age_milliseconds{sensor=\"" + String(i) + "\"} " + String(millis() - freshness.stamps[i].startMs) + "\n";
+        }
+      }
+      text += "# TYPE tempserver_stage_latency_microseconds gauge\n";
+      for (int st = 0; st < STAGE_COUNT; st++) {
+        const StageStats& stats = stageStats[st];
+        String stage = String(pipelineStageName((PipelineStage)st));
+        text += "tempserver_stage_latency_microseconds{stage=\"" + stage + "\",quantity=\"avg\"} " + String(stats.count > 0 ? (unsigned long)(stats.totalUs / stats.count) : 0UL) + "\n";
+        text += "tempserver_stage_latency_microseconds{stage=\"" + stage + "\",quantity=\"max\"} " + String(stats.maxUs) + "\n";
+      }
+      text += "# TYPE tempserver_synthetic_samples_total counter\n";
+      text += "tempserver_synthetic_samples_total " + String(loadStats.samples) + "\n";
+      text += "# TYPE tempserver_synthetic_dropped_total counter\n";
+      text += "tempserver_synthetic_dropped_total " + String(loadStats.dropped) + "\n";
+      text += "# TYPE tempserver_synthetic_ingest_rate gauge\n";
+      text += "tempserver_synthetic_ingest_rate " + String(syntheticIngestRate(), 1) + "\n";
+      text += "# TYPE tempserver_fresh_requests_total counter\n";
+      text += "tempserver_fresh_requests_total " + String(freshRead.requests) + "\n";
+      text += "# TYPE tempserver_fresh_conversions_total counter\n";
+      text += "tempserver_fresh_conversions_total " + String(freshRead.conversions) + "\n";
+      text += "# TYPE tempserver_burst_active gauge\n";
+      text += "tempserver_burst_active " + String(burst.active ? 1 : 0) + "\n";
+      text += "# TYPE tempserver_burst_rows gauge\n";
+      text += "tempserver_burst_rows " + String(burst.rows) + "\n";
+      text += "# TYPE tempserver_control_relay gauge\n";
+      text += "tempserver_control_relay " + String(controlState.relayOn ? 1 : 0) + "\n";
+      text += "# TYPE tempserver_control_faulted gauge\n";
+      text += "tempserver_control_faulted " + String(controlState.faulted ? 1 : 0) + "\n";
+      text += "# TYPE tempserver_control_duty_ratio gauge\n";
+      text += "tempserver_control_duty_ratio " + String(controlState.duty / 1000.0, 3) + "\n";
+      text += "# TYPE tempserver_control_relay_on_ratio gauge\n";
+      text += "tempserver_control_relay_on_ratio " + String(controlState.totalMs > 0 ? (double)controlState.onMs / controlState.totalMs : 0.0, 3) + "\n";
+      text += "# TYPE tempserver_control_relay_switches_total counter\n";
+      text += "tempserver_control_relay_switches_total " + String(controlState.switches) + "\n";
+      text += "# TYPE tempserver_control_faults_total counter\n";
+      text += "tempserver_control_faults_total " + String(controlState.faults) + "\n";
+      text += "# TYPE tempserver_control_jitter_microseconds gauge\n";
+      text += "tempserver_control_jitter_microseconds{quantity=\"last\"} " + String(controlState.lastJitterUs) + "\n";
+      text += "tempserver_control_jitter_microseconds{quantity=\"avg\"} " + String(controlState.jitterSamples > 0 ? (unsigned long)(controlState.totalJitterUs / controlState.jitterSamples) : 0UL) + "\n";
+      text += "tempserver_control_jitter_microseconds{quantity=\"max\"} " + String(controlState.maxJitterUs) + "\n";
+      text += "# TYPE tempserver_alarm_active gauge\n";
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        if (sensorTable[i].kind != SENSOR_NONE) {
+          text += "tempserver_alarm_active{sensor=\"" + String(i) + "\"} " + String(alarmState.pattern[i] != ALARM_NONE ? 1 : 0) + "\n";
+        }
+      }
+      text += "# TYPE tempserver_alarm_silenced gauge\n";
+      text += "tempserver_alarm_silenced " + String(alarmState.silenced ? 1 : 0) + "\n";
+      text += "# TYPE tempserver_alarm_silences_total counter\n";
+      text += "tempserver_alarm_silences_total " + String(alarmState.silences) + "\n";
+      text += "# TYPE tempserver_alarm_latency_milliseconds gauge\n";
+      text += "tempserver_alarm_latency_milliseconds " + String(alarmState.latencyMs) + "\n";
+      text += "# TYPE tempserver_history_rows gauge\n";
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        if (sensorTable[i].kind != SENSOR_NONE) {
+          text += "tempserver_history_rows{sensor=\"" + String(i) + "\"} " + String(sensorSeries[i].count) + "\n";
+        }
+      }
+      text += "# TYPE tempserver_rate_limited_total counter\n";
+      for (int c = 0; c < RATE_CLASS_COUNT; c++) {
+        text += "tempserver_rate_limited_total{class=\"" + String(rateClassName((RateClass)c)) + "\"} " + String(rateLimiter.limited[c]) + "\n";
+      }
+      text += "# TYPE tempserver_rate_limit_allowed_total counter\n";
+      text += "tempserver_rate_limit_allowed_total " + String(rateLimiter.allowed) + "\n";
+      text += "# TYPE tempserver_rate_limit_clients gauge\n";
+      text += "tempserver_rate_limit_clients " + String(rateClientCount(rateLimiter)) + "\n";
+      text += "# TYPE tempserver_rate_limit_evictions_total counter\n";
+      text += "tempserver_rate_limit_evictions_total " + String(rateLimiter.evictions) + "\n";
+      text += "# TYPE tempserver_sensor_changes_failed_total counter\n";
+      text += "tempserver_sensor_changes_failed_total " + String(sensorChangesFailed) + "\n";
+      text += "# TYPE tempserver_uptime_seconds counter\n";
+      text += "tempserver_uptime_seconds " + String(millis() / 1000) + "\n";
+      request->send(200, "text/plain; version=0.0.4", text);
+      });
+
+    server.on("/stats", HTTP_GET, [](AsyncWebServerRequest* request) {
+      String json = "[";
+      for (int i = 0; i < MAX_SENSORS; i++) {
+        if (sensorTable[i].kind != SENSOR_PHYSICAL) {
+          continue;
+        }
+        const ThermalModel& model = thermalModels[i];
+        if (json.length() > 1) {
+          json += ",";
+        }
+        json += "{\"sensor\":" + String(i);
+        json += ",\"state\":\"" + String(thermalModelStateName(model.state)) + "\"";
+        json += ",\"samples\":" + String(model.samples);
+        json += ",\"tau\":" + jsonNumber(thermalModelTau(model), 1);
+        json += ",\"setpoint\":" + jsonNumber(thermalModelSetpoint(model), 2);
+        json += ",\"residual\":" + jsonNumber(model.residual, 3);
+        json += ",\"sigma\":" + jsonNumber(sqrtf(model.residualVar), 3);
+        json += ",\"slowTau\":" + jsonNumber(model.slowTau, 1);
+        json += ",\"baselineTau\":" + jsonNumber(model.baselineTau, 1);
+        json += ",\"insulationDegraded\":" + String(model.degraded ? "true" : "false");
+        json += ",\"doorEvents\":" + String(model.doorEvents);
+        json += ",\"failureEvents\":" + String(model.failureEvents);
+        json += "}";
+      }
+      json += "]";
+      request->send(200, "application/json", json);
+      });
+
     server.on("/updateSettings", HTTP_GET, [](AsyncWebServerRequest* request) {
       MIN_TEMP = request->getParam("minTemperature")->value().toFloat();
       MAX_TEMP = request->getParam("maxTemperature")->value().toFloat();
@@ -381,15 +2205,23 @@ void setupWiFi() {
   password = "";
   passcode = "";
 
-  sensors.begin();
+  configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
   currentTime = getLocalTime();
-  temperatureC = readDSTemperatureC();
-  temperatureF = readDSTemperatureF();
-
-  temperatureArray[Temp_Array_Index].temperatureC = temperatureC;
-  temperatureArray[Temp_Array_Index].temperatureF = temperatureF;
-  temperatureArray[Temp_Array_Index].currentTime = currentTime;
-  Temp_Array_Index++;
+  loadAlertStates();
+  time_t epoch = getEpochTime();
+  readSensors();
+
+  loadChainHead();
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind != SENSOR_NONE) {
+      publishSensorSample(i, epoch);
+    }
+  }
+  startSchedule(millis(), timerDelay);
+  startSyntheticLoad(syntheticConfig.rateHz);
+  loadHeartbeatConfig();
+  startHeartbeat(heartbeatState, TEMP_INVALID, millis());
+  loadReportIndex();
 
   setupServer();
 }
@@ -402,8 +2234,11 @@ void setupWiFi() {
  * the predefined minimum and maximum thresholds (MIN_TEMP and MAX_TEMP) or the set values in the
  * web servers settings page.
  *
- * The temperature data, along with the current time, is sent in a JSON payload.
+ * The temperature data, along with the sensor and the current time, is sent in a JSON payload,
+ * with the id and start time of the alert, the URL to acknowledge it with a POST, the head of the
+ * reading hash chain as an anchor, and a link to its flight recorder snapshot.
  *
+ * @param sensor The index of the sensor the reading belongs to.
  * @param tempC The current temperature in Celsius, as a String.
  * @param tempF The current temperature in Fahrenheit, as a String.
  * @param time The current time, typically when the temperature reading was taken, as a String.
@@ -411,19 +2246,28 @@ void setupWiFi() {
  * * Notes:
  * - The webhook URL ('TEMP_WEBHOOK_URL') should be predefined and correctly set to receive the JSON data.
  */
-void tempWebHook(String tempC, String tempF, String time) {
+void tempWebHook(int sensor, String tempC, String tempF, String time) {
   float temperatureCFloat = tempC.toFloat();
-  if (temperatureCFloat > MAX_TEMP || temperatureCFloat < MIN_TEMP) {
+  if (temperatureCFloat > sensorMaxTemp(sensor) || temperatureCFloat < sensorMinTemp(sensor)) {
     String url = TEMP_WEBHOOK_URL;
     HTTPClient http;
     http.begin(url);
     http.addHeader("Content-Type", "application/json");
     String data = "{";
+    data += "\"sensor\": " + String(sensor) + ",";
+    data += "\"name\": \"" + String(sensorTable[sensor].name) + "\",";
     data += "\"temperatureC\": \"" + tempC + "\",";
     data += "\"temperatureF\": \"" + tempF + "\",";
     data += "\"time\": \"" + time + "\",";
-    data += "\"minTemp\": \"" + String(MIN_TEMP) + "\",";
-    data += "\"maxTemp\": \"" + String(MAX_TEMP) + "\"";
+    data += "\"minTemp\": \"" + String(sensorMinTemp(sensor)) + "\",";
+    data += "\"maxTemp\": \"" + String(sensorMaxTemp(sensor)) + "\",";
+    data += "\"alert\": " + String(alertStates[sensor].id) + ",";
+    data += "\"since\": " + String(alertStates[sensor].startEpoch) + ",";
+    data += "\"ack\": \"http://" + WiFi.localIP().toString() + "/api/alerts/" + String(alertStates[sensor].id) + "/ack\"";
+    data += chainAnchorFields();
+    if (alertSnapshots[sensor] != 0) {
+      data += ",\"snapshot\": \"http://" + WiFi.localIP().toString() + "/snapshot?id=" + String(alertSnapshots[sensor]) + "\"";
+    }
     data += "}";int httpResponseCode = http.POST(data);
     if (httpResponseCode > 0) {
       String response = http.getString();
@@ -432,6 +2276,102 @@ void tempWebHook(String tempC, String tempF, String time) {
   }
 }
 
+/**
+ * Sends a device event to the temperature webhook URL.
+ *
+ * Events report conditions detected on the device that are not plain threshold violations,
+ * such as a door opening or an equipment failure classified by the thermal model. The payload
+ * always carries the event type, the sensor index and the time, followed by event specific fields.
+ *
+ * @param event The event type (e.g. "door_open", "equipment_failure").
+ * @param sensor The index of the sensor the event refers to.
+ * @param fields Additional JSON members, each prefixed with a comma, or an empty string.
+ */
+void eventWebHook(String event, int sensor, String fields) {
+  String url = TEMP_WEBHOOK_URL;
+  HTTPClient http;
+  http.begin(url);
+  http.addHeader("Content-Type", "application/json");
+  String data = "{";
+  data += "\"event\": \"" + event + "\",";
+  data += "\"sensor\": " + String(sensor) + ",";
+  data += "\"time\": \"" + currentTime + "\"";
+  data += fields;
+  data += "}";
+  int httpResponseCode = http.POST(data);
+  if (httpResponseCode > 0) {
+    String response = http.getString();
+  }
+  http.end();
+}
+
+/**
+ * Reports a thermal model event through the event webhook.
+ *
+ * The payload includes the fitted time constant and setpoint, the last residual and,
+ * for insulation events, the slow and baseline time constants.
+ *
+ * @param sensor The index of the sensor whose model raised the event.
+ * @param event The model event to report.
+ */
+void reportModelEvent(int sensor, ModelEvent event) {
+  const ThermalModel& model = thermalModels[sensor];
+  String fields = "";
+  fields += ",\"temperatureC\": \"" + formatTemperature(latestCentiC[sensor], false) + "\"";
+  fields += ",\"tau\": " + jsonNumber(thermalModelTau(model), 1);
+  fields += ",\"setpoint\": " + jsonNumber(thermalModelSetpoint(model), 2);
+  fields += ",\"residual\": " + jsonNumber(model.residual, 3);
+  if (event == MODEL_EVENT_INSULATION_DEGRADED || event == MODEL_EVENT_INSULATION_RESTORED) {
+    fields += ",\"slowTau\": " + jsonNumber(model.slowTau, 1);
+    fields += ",\"baselineTau\": " + jsonNumber(model.baselineTau, 1);
+  }
+  eventWebHook(thermalModelEventName(event), sensor, fields);
+}
+
+/**
+ * Reports the events raised by a sensor group during the last reading.
+ *
+ * Member failures and restorations are reported per member; disagreements are maintenance
+ * events carrying the largest deviation of a healthy member from the group value.
+ *
+ * @param sensor The index of the group.
+ */
+void reportGroupEvents(int sensor) {
+  const GroupUpdate& events = groupEvents[sensor];
+  const SensorGroup& group = sensorTable[sensor].group;
+  String value = ",\"temperatureC\": \"" + formatTemperature(latestCentiC[sensor], false) + "\"";
+
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    uint16_t bit = 1 << i;
+    if ((events.failed & bit) || (events.restored & bit)) {
+      String fields = value;
+      fields += ",\"member\": " + String(i);
+      fields += ",\"memberTemperatureC\": \"" + formatTemperature(latestCentiC[i], false) + "\"";
+      eventWebHook((events.failed & bit) ? "group_member_failed" : "group_member_restored", sensor, fields);
+    }
+  }
+  if (events.disagreementStarted || events.disagreementEnded) {
+    String fields = value;
+    fields += ",\"spread\": " + String(group.spread / 100.0);
+    fields += ",\"tolerance\": " + String(group.tolerance / 100.0);
+    eventWebHook(events.disagreementStarted ? "probe_disagreement" : "probe_agreement", sensor, fields);
+  }
+}
+
+/**
+ * Reports a sensor that was connected, disconnected or reconnected, as found by a presence scan.
+ *
+ * @param sensor The index of the sensor.
+ * @param presence The kind of change.
+ */
+void reportPresenceEvent(int sensor, SensorPresence presence) {
+  static const char* const events[] = { "sensor_added", "sensor_removed", "sensor_restored" };
+  String fields = ",\"name\": \"" + String(sensorTable[sensor].name) + "\"";
+  fields += ",\"rom\": \"" + romToString(sensorTable[sensor].rom) + "\"";
+  fields += ",\"driver\": \"" + String(sensorDrivers[sensorTable[sensor].driver].name) + "\"";
+  eventWebHook(events[presence], sensor, fields);
+}
+
 /**
  * Sends device connection information to a specified webhook URL.
  *
@@ -479,21 +2419,831 @@ void infoWebHook() {
 }
 
 /**
- * Initial setup function for the ESP32 device.
- *
- * This function is called once when the ESP32 starts. It performs the initial setup of the device,
- * including starting the serial communication, setting up the WiFi in Access Point (AP) mode,
- * initializing the DNS server, and setting up the web server with the necessary handlers.
+ * Publishes the latest reading of a sensor: stores it in the sensor's series, stamped with the time
+ * from the start of its conversion, records its freshness and appends it to the hash chain (except
+ * for synthetic channels).
  *
- * The ESP32 is configured to create its own WiFi network ("Connect AP"), allowing for initial configuration
+ * @param sensor The sensor.
+ * @param epoch The start of the sample in seconds since the Unix epoch, or 0 if unknown.
+ */
+void publishSensorSample(int sensor, time_t epoch) {
+  unsigned long publishMs = millis();
+  storeSensorSample(sensor, epoch, publishMs - latestStartMs[sensor]);
+  publishSample(freshness, sensor, latestStartMs[sensor], (uint32_t)epoch, publishMs);
+  chainSensorSample(sensor, epoch);
+}
+
+/**
+ * Appends the reading just stored for a sensor to the hash chain. When the block is full it is
+ * sealed and timed, and its hash is persisted in NVS as the new head when a save is due (see
+ * chainHeadSaveDue()), so the chain continues after a reboot. Synthetic channels are not chained:
+ * they are bench readings, and under the synthetic load they would seal a block and write flash
+ * every few milliseconds.
+ *
+ * @param sensor The sensor.
+ * @param epoch The time of the reading.
+ */
+void chainSensorSample(int sensor, time_t epoch) {
+  if (syntheticSensor(sensor)) {
+    return;
+  }
+  if (!appendChainRecord(chainState, (uint32_t)epoch, sensor, latestCentiC[sensor])) {
+    return;
+  }
+  unsigned long start = micros();
+  sealChainBlock(chainState);
+  chainState.lastHashUs = micros() - start;
+  chainState.maxHashUs = max(chainState.maxHashUs, chainState.lastHashUs);
+
+  if (!chainHeadSaveDue(chainState, millis())) {
+    return;
+  }
+  Preferences prefs;
+  if (prefs.begin(CHAIN_NVS_NAMESPACE, false)) {
+    if (prefs.putBytes(CHAIN_NVS_KEY, &chainState.head, sizeof(chainState.head)) == sizeof(chainState.head)) {
+      chainHeadSaved(chainState, millis());
+    }
+    prefs.end();
+  }
+}
+
+/**
+ * Loads the head of the hash chain from NVS and starts the chain after it, or starts a new chain
+ * if none was stored.
+ */
+void loadChainHead() {
+  ChainHead head;
+  memset(&head, 0, sizeof(head));
+  Preferences prefs;
+  if (prefs.begin(CHAIN_NVS_NAMESPACE, true)) {
+    if (prefs.getBytesLength(CHAIN_NVS_KEY) == sizeof(head)) {
+      prefs.getBytes(CHAIN_NVS_KEY, &head, sizeof(head));
+    }
+    prefs.end();
+  }
+  startChain(chainState, head);
+}
+
+/**
+ * Checks for the end of the local day: the first call with a different date closes the day's
+ * report, stores it in NVS (in place of the oldest one), posts it if the push is on and starts
+ * the next day. Closing only divides the sums accumulated during the day.
+ *
+ * @param epoch The current Unix time, or 0 if the clock is not synchronized.
+ * @return The local hour, or -1 if the time is unknown.
+ */
+int checkReportDay(time_t epoch) {
+  if (epoch == 0) {
+    return -1;
+  }
+  struct tm timeinfo;
+  localtime_r(&epoch, &timeinfo);
+  uint32_t date = (timeinfo.tm_year + 1900) * 10000 + (timeinfo.tm_mon + 1) * 100 + timeinfo.tm_mday;
+  if (reportAccumulator.date == 0) {
+    startReportDay(reportAccumulator, date, TEMP_INVALID);
+  }
+  else if (date != reportAccumulator.date) {
+    std::unique_ptr<DailyReport> report(new DailyReport);
+    closeReportDay(reportAccumulator, *report, epoch, TEMP_INVALID);
+    startReportDay(reportAccumulator, date, TEMP_INVALID);
+    saveDailyReport(*report);
+    if (reportPush) {
+      pushDailyReport(*report);
+    }
+  }
+  return timeinfo.tm_hour;
+}
+
+/**
+ * Posts a daily report to the temperature webhook as a "daily_report" event.
+ */
+void pushDailyReport(const DailyReport& report) {
+  HTTPClient http;
+  http.begin(TEMP_WEBHOOK_URL);
+  http.addHeader("Content-Type", "application/json");
+  String data = "{";
+  data += "\"event\": \"daily_report\",";
+  data += "\"time\": \"" + currentTime + "\",";
+  data += "\"report\": " + dailyReportJson(report);
+  data += "}";
+  int httpResponseCode = http.POST(data);
+  if (httpResponseCode > 0) {
+    String response = http.getString();
+  }
+  http.end();
+}
+
+/**
+ * Reads the daily report stored in an NVS slot.
+ *
+ * @return Whether the slot holds a report.
+ */
+bool loadDailyReport(int slot, DailyReport& report) {
+  Preferences prefs;
+  bool found = false;
+  if (prefs.begin(REPORT_NVS_NAMESPACE, true)) {
+    String key = "day" + String(slot);
+    if (prefs.getBytesLength(key.c_str()) == sizeof(report)) {
+      found = prefs.getBytes(key.c_str(), &report, sizeof(report)) == sizeof(report);
+    }
+    prefs.end();
+  }
+  return found;
+}
+
+/**
+ * Stores a daily report in NVS, in the slot of the oldest stored report.
+ */
+void saveDailyReport(const DailyReport& report) {
+  int slot = reportSlotFor(reportDates, report.date);
+  Preferences prefs;
+  if (prefs.begin(REPORT_NVS_NAMESPACE, false)) {
+    String key = "day" + String(slot);
+    if (prefs.putBytes(key.c_str(), &report, sizeof(report)) == sizeof(report)) {
+      reportDates[slot] = report.date;
+    }
+    prefs.end();
+  }
+}
+
+/**
+ * Loads the dates of the stored daily reports and the push setting from NVS.
+ */
+void loadReportIndex() {
+  std::unique_ptr<DailyReport> report(new DailyReport);
+  for (int i = 0; i < REPORT_DAYS; i++) {
+    reportDates[i] = loadDailyReport(i, *report) ? report->date : 0;
+  }
+  Preferences prefs;
+  if (prefs.begin(REPORT_NVS_NAMESPACE, true)) {
+    reportPush = prefs.getBool(REPORT_NVS_PUSH_KEY, false);
+    prefs.end();
+  }
+}
+
+/**
+ * Saves the push setting of the daily reports to NVS.
+ */
+void saveReportPush() {
+  Preferences prefs;
+  if (prefs.begin(REPORT_NVS_NAMESPACE, false)) {
+    prefs.putBool(REPORT_NVS_PUSH_KEY, reportPush);
+    prefs.end();
+  }
+}
+
+/**
+ * Posts a heartbeat summarizing the device and the sensors since the last delivered heartbeat.
+ *
+ * The payload identifies the device by its MAC address and carries a sequence number and the
+ * uptime, so a receiver can tell missed heartbeats from reboots, and the interval, so it knows
+ * when the next one is overdue. Each sensor in use reports its samples, invalid readings and
+ * minimum, maximum and last temperature over the window. The counters are totals since boot.
+ * The head of the reading hash chain is included as an anchor.
+ */
+void sendHeartbeat() {
+  const HeartbeatState& state = heartbeatState;
+  int openAlerts = 0;
+  unsigned long busErrors = 0;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    openAlerts += alertStates[i].active ? 1 : 0;
+  }
+  for (int b = 0; b < ONE_WIRE_BUS_COUNT; b++) {
+    busErrors += busStats[b].readErrors;
+  }
+
+  String data = "{";
+  data += "\"event\": \"heartbeat\",";
+  data += "\"device\": \"" + WiFi.macAddress() + "\",";
+  data += "\"ip\": \"" + WiFi.localIP().toString() + "\",";
+  data += "\"seq\": " + String(state.seq + 1) + ",";
+  data += "\"uptime\": " + String(millis() / 1000) + ",";
+  data += "\"time\": \"" + currentTime + "\",";
+  data += "\"epoch\": " + String((uint32_t)getEpochTime()) + ",";
+  data += "\"interval\": " + String(heartbeatConfig.intervalSec) + ",";
+  data += "\"window\": " + String((millis() - state.windowStartMs) / 1000) + ",";
+  data += "\"failedPosts\": " + String(state.failures) + ",";
+  data += "\"heap\": " + String(ESP.getFreeHeap()) + ",";
+  data += "\"minHeap\": " + String(ESP.getMinFreeHeap()) + ",";
+  data += "\"rssi\": " + String(WiFi.RSSI()) + ",";
+  data += "\"openAlerts\": " + String(openAlerts) + ",";
+  data += "\"busErrors\": " + String(busErrors) + ",";
+  data += "\"suppressedAlerts\": " + String(suppressedAlertRepeats) + ",";
+  data += "\"controlFaults\": " + String(controlState.faults);
+  data += chainAnchorFields() + ",";
+  data += "\"sensors\": [";
+  bool first = true;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (!sensorInUse(i)) {
+      continue;
+    }
+    const HeartbeatSensor& sensor = state.sensors[i];
+    data += first ? "" : ",";
+    first = false;
+    data += "{\"sensor\": " + String(i);
+    data += ",\"samples\": " + String(sensor.samples);
+    data += ",\"invalid\": " + String(sensor.invalid);
+    data += ",\"min\": " + (sensor.minCentiC == TEMP_INVALID ? String("null") : formatTemperature(sensor.minCentiC, false));
+    data += ",\"max\": " + (sensor.maxCentiC == TEMP_INVALID ? String("null") : formatTemperature(sensor.maxCentiC, false));
+    data += ",\"last\": " + (sensor.lastCentiC == TEMP_INVALID ? String("null") : formatTemperature(sensor.lastCentiC, false)) + "}";
+  }
+  data += "]}";
+
+  HTTPClient http;
+  http.begin(heartbeatConfig.url[0] != '\0' ? String(heartbeatConfig.url) : INFO_WEBHOOK_URL);
+  http.addHeader("Content-Type", "application/json");
+  int httpResponseCode = http.POST(data);
+  http.end();
+  heartbeatSent(heartbeatState, httpResponseCode, TEMP_INVALID, millis());
+}
+
+/**
+ * Loads the heartbeat configuration from NVS, keeping the default if none was stored or it is invalid.
+ */
+void loadHeartbeatConfig() {
+  Preferences prefs;
+  HeartbeatConfig config;
+  if (prefs.begin(HEARTBEAT_NVS_NAMESPACE, true)) {
+    if (prefs.getBytesLength(HEARTBEAT_NVS_KEY) == sizeof(config)) {
+      prefs.getBytes(HEARTBEAT_NVS_KEY, &config, sizeof(config));
+      if (checkHeartbeatConfig(config) == nullptr) {
+        heartbeatConfig = config;
+      }
+    }
+    prefs.end();
+  }
+}
+
+/**
+ * Saves the heartbeat configuration to NVS.
+ */
+void saveHeartbeatConfig() {
+  Preferences prefs;
+  if (prefs.begin(HEARTBEAT_NVS_NAMESPACE, false)) {
+    prefs.putBytes(HEARTBEAT_NVS_KEY, &heartbeatConfig, sizeof(heartbeatConfig));
+    prefs.end();
+  }
+}
+
+/**
+ * Saves the state of every sensor's alert in NVS. Only active alerts carry data, and the table is
+ * written only when an alert changed: when it is raised, and at most once per repeat period.
+ */
+void saveAlertStates() {
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    alertRecords[i] = alertRecord(alertStates[i]);
+  }
+  Preferences prefs;
+  if (prefs.begin(ALERT_NVS_NAMESPACE, false)) {
+    prefs.putBytes(ALERT_NVS_RECORDS_KEY, alertRecords, sizeof(alertRecords));
+    prefs.putUInt(ALERT_NVS_NEXT_ID_KEY, nextAlertId);
+    prefs.end();
+  }
+}
+
+/**
+ * Restores the alert states saved in NVS, at boot.
+ */
+void loadAlertStates() {
+  Preferences prefs;
+  memset(alertRecords, 0, sizeof(alertRecords));
+  if (prefs.begin(ALERT_NVS_NAMESPACE, true)) {
+    if (prefs.getBytesLength(ALERT_NVS_RECORDS_KEY) == sizeof(alertRecords)) {
+      prefs.getBytes(ALERT_NVS_RECORDS_KEY, alertRecords, sizeof(alertRecords));
+    }
+    nextAlertId = prefs.getUInt(ALERT_NVS_NEXT_ID_KEY, 1);
+    prefs.end();
+  }
+  unsigned long now = millis();
+  uint32_t epoch = getEpochTime();
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    restoreAlert(alertStates[i], alertRecords[i], now, epoch);
+  }
+}
+
+/**
+ * Queues a sensor configuration change for the main loop; called by the web server task.
+ *
+ * @return false if the queue is full.
+ */
+bool queueSensorChange(const SensorChange& change) {
+  uint32_t queued = sensorChangesQueued;
+  if (queued - sensorChangesApplied >= (uint32_t)SENSOR_CHANGE_QUEUE) {
+    return false;
+  }
+  sensorChanges[queued % SENSOR_CHANGE_QUEUE] = change;
+  sensorChangesQueued = queued + 1;
+  return true;
+}
+
+/**
+ * Applies the sensor configuration changes queued by the web server, between two samples. Each
+ * change was checked when it was queued; one that is no longer valid (e.g. its slot was taken
+ * meanwhile) is dropped and counted.
+ */
+void applySensorChanges() {
+  while (sensorChangesApplied != sensorChangesQueued) {
+    const SensorChange& change = sensorChanges[sensorChangesApplied % SENSOR_CHANGE_QUEUE];
+    const char* error = nullptr;
+    switch (change.kind) {
+      case CHANGE_DEFINE_VIRTUAL:
+        error = defineVirtualSensor(change.name, change.expr, change.minTemp, change.maxTemp);
+        break;
+      case CHANGE_REMOVE_VIRTUAL:
+        error = removeVirtualSensor(change.name);
+        break;
+      case CHANGE_DEFINE_GROUP:
+        error = defineSensorGroup(change.name, change.memberMask, change.mode, change.tolerance, change.minTemp, change.maxTemp);
+        break;
+      case CHANGE_REMOVE_GROUP:
+        error = removeSensorGroup(change.name);
+        break;
+      case CHANGE_SET_CALIBRATION:
+        error = setCalibration(change.calibration);
+        refreshSensorCalibrations();
+        break;
+      case CHANGE_REMOVE_CALIBRATION:
+        removeCalibration(change.calibration.rom);
+        refreshSensorCalibrations();
+        break;
+      case CHANGE_INTERVAL:
+        if (!sensorInUse(change.sensor)) {
+          error = "sensor removed";
+          break;
+        }
+        sensorTable[change.sensor].intervalMs = change.intervalMs;
+        scheduleSensor(change.sensor, millis(), timerDelay);
+        break;
+      case CHANGE_SYNTHETIC:
+        syntheticConfig.waveform = change.synthetic.waveform;
+        syntheticConfig.baseCentiC = change.synthetic.baseCentiC;
+        syntheticConfig.amplitudeCentiC = change.synthetic.amplitudeCentiC;
+        syntheticConfig.periodMs = change.synthetic.periodMs;
+        if (change.setRate) {
+          startSyntheticLoad(change.synthetic.rateHz);
+        }
+        break;
+      case CHANGE_START_BURST: {
+        int sensors[BURST_MAX_SENSORS];
+        int count = 0;
+        for (int i = 0; i < MAX_SENSORS && count < BURST_MAX_SENSORS; i++) {
+          if (change.memberMask & (1 << i)) {
+            sensors[count++] = i;
+          }
+        }
+        for (int i = 0; i < count && error == nullptr; i++) {
+          if (!sensorInUse(sensors[i])) {
+            error = "sensor removed";
+          }
+        }
+        if (error == nullptr) {
+          error = startBurst(sensors, count, change.intervalMs, change.durationMs, millis(), getEpochTime());
+        }
+        break;
+      }
+      case CHANGE_STOP_BURST:
+        stopBurst();
+        break;
+      case CHANGE_HEARTBEAT:
+        heartbeatConfig = change.heartbeat;
+        saveHeartbeatConfig();
+        break;
+      case CHANGE_ALARM_RULE:
+        if (!sensorInUse(change.sensor)) {
+          error = "sensor removed";
+          break;
+        }
+        alarmRules[change.sensor] = change.alarmRule;
+        saveAlarmRules();
+        break;
+    }
+    if (error != nullptr) {
+      sensorChangesFailed++;
+      Serial.println("Sensor change of " + String(change.name) + " dropped: " + String(error));
+    }
+    sensorChangesApplied = sensorChangesApplied + 1;
+  }
+}
+
+/**
+ * Applies the alert acknowledgments requested through the web server, saves them and reports
+ * them with an "alert_acknowledged" event. A request for an alert that closed since it was
+ * queued, or was replaced by a new alert of the sensor, is ignored.
+ */
+void applyAlertAcknowledgments() {
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    AlertAckRequest& ack = alertAckRequests[i];
+    uint32_t requested = ack.requested;
+    if (requested == ack.applied) {
+      continue;
+    }
+    ack.applied = requested;
+    AlertState& state = alertStates[i];
+    if (!state.active || state.id != ack.id) {
+      continue;
+    }
+    acknowledgeAlert(state, getEpochTime(), ack.snoozeSec);
+    saveAlertStates();
+    String until = state.ackUntilEpoch == ALERT_ACK_UNTIL_RECOVERY ? "\"recovery\"" : String(state.ackUntilEpoch);
+    eventWebHook("alert_acknowledged", i, ",\"alert\": " + String(state.id) + ",\"until\": " + until);
+  }
+}
+
+/**
+ * Checks a sensor's latest reading against its alert thresholds.
+ *
+ * The first reading outside the thresholds raises an alert with a new id and sends a notification
+ * immediately. After that, the notification is repeated every 'teamsNotificationDelay' while the
+ * sensor stays out of range, unless the alert was acknowledged. The first reading back in range
+ * closes the alert, and its cleared record is saved.
+ * The decision is made by updateAlert() in alert.h, which the replay tool runs on recorded traces.
+ * A raised alert also freezes the flight recorder's readings of the sensor into a snapshot.
+ * Alerts of synthetic channels get no id, snapshot or report entry, so a load test neither uses
+ * up alert ids nor overwrites the snapshots of real alerts.
+ * The alert state is saved in NVS whenever it changed, before the webhook is sent, so a reboot
+ * neither raises the alert again nor loses its repeat schedule.
+ *
+ * @param sensor The index of the sensor to check.
+ * @param notify Whether the alert state is saved and the webhook sent; false for the synthetic load.
+ */
+void checkTemperatureAlert(int sensor, bool notify) {
+  String tempC = formatTemperature(latestCentiC[sensor], false);
+  String tempF = formatTemperature(latestCentiC[sensor], true);
+  AlertRule rule = { sensorMinTemp(sensor), sensorMaxTemp(sensor), teamsNotificationDelay };
+  AlertAction action = updateAlert(alertStates[sensor], rule, tempC.toFloat(), millis(), getEpochTime());
+  if (action == ALERT_RAISED && !syntheticSensor(sensor)) {
+    alertStates[sensor].id = nextAlertId++;
+    alertSnapshots[sensor] = triggerSnapshot(sensor, getEpochTime(), latestCentiC[sensor]);
+    recordReportAlert(reportAccumulator, alertStates[sensor].id, sensor, alertStates[sensor].startEpoch);
+  }
+  if (action == ALERT_SUPPRESSED) {
+    suppressedAlertRepeats++;
+  }
+  if (!notify) {
+    return;
+  }
+  if (alertChanged(alertStates[sensor], alertRecords[sensor])) {
+    saveAlertStates();
+  }
+  if (action == ALERT_RAISED || action == ALERT_REPEATED) {
+    tempWebHook(sensor, tempC, tempF, currentTime);
+  }
+}
+
+/**
+ * Updates the local alarm of the sampled sensors from their latest readings. It is called right
+ * after every read, before any webhook is sent, so the buzzer does not wait for the network.
+ * Members of a sensor group alarm through their group, as for the alerts, and the alarm of a
+ * sensor slot no longer in use is cleared.
+ *
+ * @param sampled Bit N set for each sensor N that was read.
+ */
+void updateLocalAlarms(uint16_t sampled) {
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind == SENSOR_NONE || sensorGroupOf(i) >= 0) {
+      clearAlarm(i);
+    }
+    else if (sampled & (1 << i)) {
+      updateAlarm(i, latestCentiC[i], lroundf(sensorMinTemp(i) * 100), lroundf(sensorMaxTemp(i) * 100), TEMP_INVALID, millis());
+    }
+  }
+}
+
+/**
+ * Runs one sample of the given sensors through the pipeline: reads them, updates their local
+ * alarms, heartbeat summaries and daily report, checks their alert thresholds, reports group
+ * events, updates their thermal models and publishes their readings. The caller takes the time
+ * of the sample (epoch and currentTime) before the call, so a stored reading is stamped with the
+ * start of its conversion, and the synthetic load takes it once per batch.
+ * The latency of each stage is recorded in stageStats.
+ *
+ * Without 'notify', the pipeline runs without its network and flash side effects: alert states
+ * are not saved, and no alert, group or model event webhook is sent. Built with a
+ * RECORDER_INTERVAL_MS of 0, the flight recorder records the notified samples.
+ *
+ * @param due Bit N set for each sensor N to sample.
+ * @param epoch The time of the sample, from getEpochTime().
+ * @param notify Whether webhooks are sent and alert states saved; false for the synthetic load.
+ */
+void processSamples(uint16_t due, time_t epoch, bool notify) {
+  unsigned long stageStart = micros();
+  uint16_t sampled = readSensors(due);
+  recordStage(STAGE_READ, stageStart);
+
+  stageStart = micros();
+  updateLocalAlarms(sampled);
+  int hour = checkReportDay(epoch);
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind != SENSOR_NONE && (sampled & (1 << i))) {
+      recordHeartbeatSample(heartbeatState, i, latestCentiC[i], TEMP_INVALID);
+    }
+    if (sensorTable[i].kind != SENSOR_NONE && (due & (1 << i)) && hour >= 0 && !syntheticSensor(i)) {
+      recordReportSample(reportAccumulator, i, latestCentiC[i], lroundf(sensorMinTemp(i) * 100), lroundf(sensorMaxTemp(i) * 100), epoch, hour, TEMP_INVALID);
+    }
+    if (notify && sensorTable[i].kind == SENSOR_GROUP && (sampled & (1 << i))) {
+      reportGroupEvents(i);
+    }
+    if (sensorTable[i].kind != SENSOR_NONE && (due & (1 << i)) && sensorGroupOf(i) < 0) {
+      checkTemperatureAlert(i, notify);
+    }
+  }
+  recordStage(STAGE_ALERT, stageStart);
+
+  stageStart = micros();
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind != SENSOR_PHYSICAL || !(due & (1 << i)) || latestCentiC[i] == TEMP_INVALID) {
+      continue;
+    }
+    float dtSec = (millis() - lastStoredMs[i]) / 1000.0;
+    ModelEvent event = updateThermalModel(thermalModels[i], latestCentiC[i] / 100.0, dtSec);
+    if (notify && event != MODEL_EVENT_NONE) {
+      reportModelEvent(i, event);
+    }
+  }
+  recordStage(STAGE_MODEL, stageStart);
+
+  stageStart = micros();
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind != SENSOR_NONE && (due & (1 << i))) {
+      publishSensorSample(i, epoch);
+    }
+  }
+  if (RECORDER_INTERVAL_MS == 0 && notify) {
+    recordRecorderRow(epoch, latestCentiC);
+  }
+  recordStage(STAGE_STORE, stageStart);
+}
+
+/**
+ * Reads the physical sensors of RECORDER_SENSOR_MASK and records all sensors in the flight
+ * recorder. The other sensors, sensor groups and virtual sensors are recorded with their last
+ * value, computed at their own interval, so their state is not advanced by the recorder. The local
+ * alarm of the sensors read is updated, so it reacts within RECORDER_INTERVAL_MS whatever the
+ * sampling interval. It runs from boot, also while WiFi is not set up, so the alarm does not
+ * depend on the network. Each run blocks the loop for a conversion; see recorder.h for its cost.
+ */
+void runRecorderSample() {
+  uint16_t mask = 0;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind == SENSOR_PHYSICAL && (RECORDER_SENSOR_MASK & (1 << i))) {
+      mask |= 1 << i;
+    }
+  }
+  if (mask != 0) {
+    updateLocalAlarms(readSensors(mask));
+  }
+  recordRecorderRow(getEpochTime(), latestCentiC);
+}
+
+/**
+ * Reads the sensors of the running burst and records them in the burst buffer.
+ * The readings are not stored in the histories or alerted on, but update the local alarm. As for
+ * the recorder, sensor groups are not advanced, so a burst does not count towards their voting.
+ */
+void runBurstSample() {
+  uint16_t mask = 0;
+  for (int i = 0; i < burst.sensorCount; i++) {
+    mask |= 1 << burst.sensors[i];
+  }
+  updateLocalAlarms(readSensors(mask, false));
+  recordBurstRow(millis(), latestCentiC);
+}
+
+/**
+ * Takes the fresh sample requested through "/read?fresh=1" and releases the waiting requests.
+ *
+ * All sensors are read; the readings are not stored or alerted on, so the history and the thermal
+ * models keep their regular sampling interval. As for the recorder, the groups are not advanced:
+ * their value is computed from the fresh readings, but their voting streaks and events are left to
+ * their regular samples. The local alarm is updated as for a regular sample.
+ */
+void runFreshRead() {
+  uint32_t generation = freshRead.requested;
+  updateLocalAlarms(readSensors(0xFFFF, false));
+  freshRead.conversions++;
+  freshRead.completedMs = millis();
+  freshRead.completed = generation;
+}
+
+/**
+ * Runs the samples of the synthetic load that are due through the pipeline, for at most
+ * LOAD_BUDGET_MS; samples left over are run on the next call or dropped once too far behind.
+ * The time is taken once for the batch, and the samples run without webhooks or alert state
+ * saves (see processSamples()), so the load measures the pipeline and not the network or flash.
+ *
+ * @param mask The synthetic sensors.
+ */
+void runSyntheticLoad(uint16_t mask) {
+  unsigned long start = millis();
+  unsigned long pending = syntheticLoadPending(micros());
+  currentTime = getLocalTime();
+  time_t epoch = getEpochTime();
+  while (pending > 0 && millis() - start < LOAD_BUDGET_MS) {
+    processSamples(mask, epoch, false);
+    syntheticLoadDone();
+    pending--;
+  }
+}
+
+/**
+ * Reads the controlled sensor when no other sample read it for CONTROL_SAMPLE_INTERVAL_MS. The
+ * reading is not stored or alerted on, and a controlled group is not advanced (see runFreshRead()).
+ * The local alarm is updated as for a regular sample. It runs from boot, also while WiFi is not set up.
+ *
+ * @param sensor The controlled sensor, from readControlConfig().
+ */
+void runControlSample(int sensor) {
+  updateLocalAlarms(readSensors(1 << sensor, false));
+}
+
+/**
+ * Loads the control configuration from NVS, keeping the defaults if none was stored or it is invalid.
+ */
+void loadControlConfig() {
+  Preferences prefs;
+  ControlConfig config = CONTROL_DEFAULTS;
+  if (prefs.begin(CONTROL_NVS_NAMESPACE, true)) {
+    if (prefs.getBytesLength(CONTROL_NVS_KEY) == sizeof(config)) {
+      prefs.getBytes(CONTROL_NVS_KEY, &config, sizeof(config));
+    }
+    prefs.end();
+  }
+  controlConfig = checkControlConfig(config, MAX_SENSORS) == nullptr ? config : CONTROL_DEFAULTS;
+}
+
+/**
+ * Changes the control configuration from the web server. The control task picks the change up
+ * at its next period and resets its controller terms, and the main loop saves it to NVS (see
+ * saveControlConfig()).
+ *
+ * @param config The new configuration, checked by checkControlConfig().
+ */
+void setControlConfig(const ControlConfig& config) {
+  controlConfigSeq = controlConfigSeq + 1;
+  controlConfig = config;
+  controlConfigSeq = controlConfigSeq + 1;
+}
+
+/**
+ * Returns a consistent copy of the control configuration, waiting while the web server writes a
+ * change.
+ *
+ * @param seq Receives the value of controlConfigSeq of the copy.
+ */
+ControlConfig readControlConfig(uint32_t& seq) {
+  for (;;) {
+    seq = controlConfigSeq;
+    if ((seq & 1) == 0) {
+      ControlConfig config = controlConfig;
+      if (controlConfigSeq == seq) {
+        return config;
+      }
+    }
+    delay(1);
+  }
+}
+
+/**
+ * Saves the control configuration to NVS if it changed since it was last saved. Called by the
+ * main loop, so the web server task does not write the flash.
+ */
+void saveControlConfig() {
+  if (controlConfigSeq == controlConfigSavedSeq) {
+    return;
+  }
+  uint32_t seq;
+  ControlConfig config = readControlConfig(seq);
+  Preferences prefs;
+  if (prefs.begin(CONTROL_NVS_NAMESPACE, false)) {
+    prefs.putBytes(CONTROL_NVS_KEY, &config, sizeof(config));
+    prefs.end();
+  }
+  controlConfigSavedSeq = seq;
+}
+
+/**
+ * Control task: runs the controller every control period and drives the relay.
+ *
+ * The task runs at a higher priority than the main loop and is woken at fixed times by
+ * vTaskDelayUntil(), so the control period does not depend on sampling, webhooks or the web
+ * server. It only reads the latest reading of the controlled sensor and its time, which the main
+ * loop keeps up to date; a reading the loop failed to refresh becomes stale and puts the
+ * controller in its failsafe.
+ *
+ * @param parameter Unused.
+ */
+void controlTask(void* parameter) {
+  uint32_t seq = controlConfigSeq;
+  ControlConfig config = controlConfig;
+  startControl(controlState, millis());
+  TickType_t wake = xTaskGetTickCount();
+  unsigned long lastUs = micros();
+  for (;;) {
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(config.periodMs));
+    unsigned long nowUs = micros();
+    recordControlPeriod(controlState, nowUs - lastUs, config.periodMs);
+    lastUs = nowUs;
+
+    uint32_t current = controlConfigSeq;
+    if (current != seq && (current & 1) == 0) {
+      ControlConfig update = controlConfig;
+      if (controlConfigSeq == current) {
+        config = update;
+        seq = current;
+        resetController(controlState, millis());
+      }
+    }
+
+    unsigned long readMs = latestReadMs[config.sensor];
+    int16_t reading = latestCentiC[config.sensor];
+    unsigned long now = millis();
+    bool on = updateControl(controlState, config, reading, now - readMs, now, TEMP_INVALID);
+    digitalWrite(CONTROL_RELAY_PIN, on == (CONTROL_RELAY_ACTIVE_HIGH != 0) ? HIGH : LOW);
+  }
+}
+
+/**
+ * Loads the alarm rules from NVS, or sets the default rules if none were stored or a stored rule
+ * has an unknown pattern.
+ */
+void loadAlarmRules() {
+  Preferences prefs;
+  defaultAlarmRules();
+  if (prefs.begin(ALARM_NVS_NAMESPACE, true)) {
+    if (prefs.getBytesLength(ALARM_NVS_KEY) == sizeof(alarmRules)) {
+      prefs.getBytes(ALARM_NVS_KEY, alarmRules, sizeof(alarmRules));
+    }
+    prefs.end();
+  }
+  for (int s = 0; s < ALARM_MAX_SENSORS; s++) {
+    if (alarmRules[s].lowPattern >= ALARM_PATTERN_COUNT || alarmRules[s].highPattern >= ALARM_PATTERN_COUNT) {
+      defaultAlarmRules();
+      break;
+    }
+  }
+}
+
+/**
+ * Saves the alarm rules to NVS.
+ */
+void saveAlarmRules() {
+  Preferences prefs;
+  if (prefs.begin(ALARM_NVS_NAMESPACE, false)) {
+    prefs.putBytes(ALARM_NVS_KEY, alarmRules, sizeof(alarmRules));
+    prefs.end();
+  }
+}
+
+/**
+ * Alarm task: plays the alarm patterns on the buzzer and LED and reads the silence button every
+ * ALARM_TICK_MS. It runs from boot, independently of the WiFi connection and of the main loop,
+ * which may be blocked sending a webhook.
+ *
+ * @param parameter Unused.
+ */
+void alarmTask(void* parameter) {
+  TickType_t wake = xTaskGetTickCount();
+  for (;;) {
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(ALARM_TICK_MS));
+    runAlarmOutputs(millis());
+  }
+}
+
+/**
+ * Initial setup function for the ESP32 device.
+ *
+ * This function is called once when the ESP32 starts. It performs the initial setup of the device,
+ * including starting the serial communication, setting up the WiFi in Access Point (AP) mode,
+ * initializing the DNS server, and setting up the web server with the necessary handlers.
+ *
+ * The ESP32 is configured to create its own WiFi network ("Connect AP"), allowing for initial configuration
  * through a captive portal. This is particularly useful for setting up the device in new environments
  * where WiFi credentials need to be configured.
  */
 void setup() {
   Serial.begin(115200);
+  pinMode(CONTROL_RELAY_PIN, OUTPUT);
+  digitalWrite(CONTROL_RELAY_PIN, CONTROL_RELAY_ACTIVE_HIGH ? LOW : HIGH);
+  setupAlarmOutputs();
+  loadAlarmRules();
+  xTaskCreatePinnedToCore(alarmTask, "alarm", 2048, nullptr, 4, nullptr, 1);
+
+  // The sensors and the thermostat control run from boot, before and whether or not WiFi is set
+  // up, so a persisted control configuration resumes after a power loss. The control task
+  // preempts the main loop (priority 1) on the same core.
+  loadCalibrations();
+  setupSensors();
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    twoPointRaw[i] = TEMP_INVALID;
+  }
+  loadControlConfig();
+  xTaskCreatePinnedToCore(controlTask, "control", 4096, nullptr, 5, nullptr, 1);
+
   WiFi.disconnect(true);
   WiFi.mode(WIFI_AP);
   WiFi.softAP("Connect AP");
+  // Registered first, so the rate limit is checked before every route.
+  server.addHandler(new RateLimitHandler());
   setupServer();
   dnsServer.start(53, "*", WiFi.softAPIP());
   server.addHandler(new CaptiveRequestHandler()).setFilter(ON_AP_FILTER);
@@ -505,10 +3255,24 @@ void setup() {
  *
  * This function continuously runs after the initial setup. It performs several key tasks:
  * 1. Processes DNS requests when in AP mode for captive portal functionality.
- * 2. Once the WiFi credentials are received, it attempts to connect to the WiFi network.
- * 3. Regularly checks and reads the temperature from the sensors.
- * 4. Sends temperature data to a webhook if the temperature is outside the predefined thresholds.
- * 5. Manages the storage of temperature data in a circular array.
+ * 2. Once the WiFi credentials are received, it attempts to connect to the WiFi network, and
+ *    applies the alert acknowledgments and sensor configuration changes received by the web server
+ *    and saves control configuration changes.
+ * 3. Takes a fresh sample of all sensors when one was requested through "/read?fresh=1", and
+ *    samples the burst sensors into the burst buffer while a burst capture runs, records all
+ *    sensors in the flight recorder every RECORDER_INTERVAL_MS (10 seconds by default), which
+ *    updates the local alarm, and reads the controlled sensor of the thermostat control (run by
+ *    its own task) when no other sample read it for 10 seconds. The recorder and control reads also run before WiFi is set up.
+ * 4. Reads the sensors that are due, each at its own sampling interval, sampling sensors due
+ *    together in shared conversions (including the inputs of groups and virtual sensors).
+ * 5. Sends temperature data to a webhook if a sensor's temperature is outside its thresholds,
+ *    alerting on sensor groups in place of their member probes, and reports group events.
+ * 6. Updates the thermal model of each physical sensor and reports any model events.
+ * 7. Stores each sampled sensor's reading with its time in the sensor's own circular series.
+ *    Steps 4 to 7 are done by processSamples().
+ * 8. While a synthetic load rate is set, runs the synthetic sensors through the same steps at that rate.
+ * 9. Between samples, scans the 1-Wire buses step by step for probes that were plugged in or removed.
+ * 10. Posts a heartbeat every heartbeat interval, and closes the daily report at local midnight.
  *
  * The function ensures continuous monitoring of the temperature and the device's connectivity status,
  * triggering actions like sending alerts or storing temperature data based on the defined conditions.
@@ -521,29 +3285,52 @@ void loop() {
     }
   }
 
-  if (((millis() - lastTime) > timerDelay) && !waiting_to_connect) {
+  if (!waiting_to_connect) {
+    applyAlertAcknowledgments();
+    applySensorChanges();
+    saveControlConfig();
+  }
 
-    temperatureC = readDSTemperatureC();
-    temperatureF = readDSTemperatureF();
-    currentTime = getLocalTime();
+  if (!waiting_to_connect && freshReadPending()) {
+    runFreshRead();
+  }
 
-    float temperatureCFloat = temperatureC.toFloat();
-    if ((temperatureCFloat < MIN_TEMP || temperatureCFloat > MAX_TEMP) && !sendNotif) {
+  if (!waiting_to_connect && burstDue(millis())) {
+    runBurstSample();
+  }
+  if (recorderDue(millis())) {
+    runRecorderSample();
+  }
+  uint32_t controlSeq;
+  ControlConfig control = readControlConfig(controlSeq);
+  if (control.mode != CONTROL_OFF && millis() - latestReadMs[control.sensor] >= CONTROL_SAMPLE_INTERVAL_MS) {
+    runControlSample(control.sensor);
+  }
 
-      tempWebHook(temperatureC, temperatureF, currentTime);
-      lastNotifyTime = millis();
-      sendNotif = true;
-    }
+  uint16_t load = (waiting_to_connect || syntheticConfig.rateHz == 0) ? 0 : syntheticSensors();
+  uint16_t due = waiting_to_connect ? 0 : dueSensors(millis(), timerDelay) & ~load;
+  if (due != 0) {
+    currentTime = getLocalTime();
+    processSamples(due, getEpochTime(), true);
+    lastTime = millis();
+  }
+  if (load != 0) {
+    runSyntheticLoad(load);
+  }
 
-    if ((millis() - lastNotifyTime) > teamsNotificationDelay && sendNotif) {
-      tempWebHook(temperatureC, temperatureF, currentTime);
-      lastNotifyTime = millis();
+  if (!waiting_to_connect) {
+    SensorPresence presence;
+    int sensor = scanSensorPresence(millis(), presence);
+    if (sensor >= 0) {
+      reportPresenceEvent(sensor, presence);
     }
+  }
 
-    temperatureArray[Temp_Array_Index].temperatureC = temperatureC;
-    temperatureArray[Temp_Array_Index].temperatureF = temperatureF;
-    temperatureArray[Temp_Array_Index].currentTime = currentTime;
-    Temp_Array_Index = (Temp_Array_Index + 1) % MAX_ROWS;
-    lastTime = millis();
+  if (!waiting_to_connect && heartbeatDue(heartbeatState, heartbeatConfig, millis())) {
+    sendHeartbeat();
+  }
+  if (!waiting_to_connect && millis() - lastReportCheckMs >= REPORT_CHECK_MS) {
+    lastReportCheckMs = millis();
+    checkReportDay(getEpochTime());
   }
 }
@@ -0,0 +1,824 @@
+/*
+  Header: drivers.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the sensor drivers and the sampler that runs them. A driver exposes
+  a number of temperature channels through a small batch-read contract:
+
+  - begin(): detects the hardware and returns the number of channels.
+  - startConversion(): starts a conversion on the requested channels and returns the worst-case
+    time in milliseconds until the results can be read.
+  - isReady(): optionally reports an early completion (nullptr if the driver cannot tell).
+  - readBatch(): reads the results of the requested channels in hundredths of a degree Celsius.
+  - channelId(): returns a stable 8-byte id of a channel, used as the calibration key.
+  - scanStep(): optionally advances a presence scan by one short step and reports a channel
+    that appeared or disappeared (nullptr if the hardware cannot be hot-plugged).
+
+  The sampler starts a conversion on every driver with a requested channel first, then reads each
+  driver as soon as it is ready, so the conversion waits of all drivers overlap and a sample takes
+  as long as the slowest driver rather than the sum of all of them. Channels are requested with a
+  bit mask; drivers and buses without a requested channel are left idle.
+
+  Each driver has a fixed range of maxChannels entries in a sample, so channels added by a
+  presence scan do not move the channels of the other drivers.
+
+  Drivers:
+  - ds18b20: DS18B20 probes on one or more 1-Wire buses (ONE_WIRE_PINS), converted in parallel,
+    with incremental bus searches to detect probes that are plugged in or removed.
+  - sht3x: Sensirion SHT3x sensors on the I2C bus (SHT3X_ADDRESSES), single-shot mode.
+  - synthetic: Generated waveforms (SYNTHETIC_CHANNELS, syntheticConfig), for bench testing without
+    hardware and, at a load rate of up to thousands of samples per second, for stress testing.
+
+  Usage:
+  - Call beginDrivers() once, then sampleDrivers() with the channels due for every sample.
+  - Call scanDrivers() while no sample is due to run the presence scans step by step.
+  - Map a driver channel to its entry in the sample with driverChannelIndex().
+  - To add a probe type, write its functions and add it to sensorDrivers and DriverId.
+
+  Notes:
+  - Include OneWire, DallasTemperature and Wire before this header.
+*/
+
+#ifndef DRIVERS_H
+#define DRIVERS_H
+
+// Maximum number of channels over all drivers.
+const int DRIVER_MAX_CHANNELS = 16;
+
+// Capability flags of a sensor driver.
+const uint8_t DRIVER_CAP_UNIQUE_ID = 0x01;    // Channel ids are factory ROM codes that follow the sensor
+const uint8_t DRIVER_CAP_POLL_READY = 0x02;   // Completion of a conversion can be polled
+const uint8_t DRIVER_CAP_SIMULATED = 0x04;    // Readings are generated, not measured
+const uint8_t DRIVER_CAP_HOTPLUG = 0x08;      // Channels can appear and disappear at run time
+
+// Outcome of one step of a presence scan.
+enum ScanResult {
+  SCAN_CONTINUE,    // Step done, the scan continues
+  SCAN_CHANGE,      // A channel appeared or disappeared
+  SCAN_DONE         // The scan pass is complete
+};
+
+// A channel that appeared or disappeared.
+struct DriverChange {
+  int channel;
+  bool present;     // The channel is present now
+  bool added;       // The channel is new to the driver (otherwise it was known before)
+};
+
+// Operations of a sensor driver.
+struct SensorDriver {
+  const char* name;
+  uint8_t caps;                                           // DRIVER_CAP_* flags
+  uint8_t maxChannels;                                    // Entries reserved for the driver in a sample
+  int (*begin)(int maxChannels);                          // Detects the hardware, returns the number of channels
+  unsigned long (*startConversion)(uint32_t mask);        // Returns the worst-case time until ready, in ms
+  bool (*isReady)();                                      // True if the results can be read early (may be nullptr)
+  void (*readBatch)(int16_t* out, int count, int16_t invalid, uint32_t mask);  // Reads the masked channels in hundredths of a degree
+  void (*channelId)(int channel, uint8_t* id);            // Stable 8-byte id of a channel
+  ScanResult (*scanStep)(DriverChange& change);           // Advances the presence scan (may be nullptr)
+};
+
+// Statistics of a driver, maintained by the sampler.
+struct DriverStats {
+  uint8_t channels;               // Number of channels found by begin()
+  int base;                       // Index of the driver's first channel in a sample
+  unsigned long conversions;      // Number of conversions started
+  unsigned long reads;            // Total number of channel reads
+  unsigned long readErrors;       // Total number of channel reads that returned no valid temperature
+  uint16_t lastConversionMs;      // Time from the start of the last conversion until the driver was read
+  uint16_t lastReadMs;            // Time taken by the last readBatch()
+};
+
+/*
+  DS18B20 driver.
+*/
+
+// Define the GPIO pin number for the first OneWire data bus (used for DS18B20 temperature sensors).
+#define ONE_WIRE_BUS 4
+
+// GPIO pins of all 1-Wire buses, each with its own 4.7k pull-up. Splitting a long star topology
+// into several short buses makes it more reliable; add the pins of further buses here, or
+// define ONE_WIRE_PIN_LIST as a build flag (e.g. -DONE_WIRE_PIN_LIST=4,16,17).
+#ifndef ONE_WIRE_PIN_LIST
+#define ONE_WIRE_PIN_LIST ONE_WIRE_BUS
+#endif
+const uint8_t ONE_WIRE_PINS[] = { ONE_WIRE_PIN_LIST };
+
+// Number of 1-Wire buses.
+const int ONE_WIRE_BUS_COUNT = sizeof(ONE_WIRE_PINS) / sizeof(ONE_WIRE_PINS[0]);
+
+// OneWire instances of the buses, started on their pins by the driver.
+OneWire oneWireBuses[ONE_WIRE_BUS_COUNT];
+
+// DallasTemperature instances interfacing with the DS18B20 sensors of each bus.
+DallasTemperature busSensors[ONE_WIRE_BUS_COUNT];
+
+// Health and timing statistics of a 1-Wire bus.
+struct BusStats {
+  uint8_t devices;                // Number of probes found when the bus was enumerated
+  bool parasite;                  // A probe on the bus is parasite powered
+  unsigned long conversions;      // Number of conversions started on the bus
+  unsigned long readErrors;       // Total number of probe reads that returned no valid temperature
+  uint8_t lastErrors;             // Probe reads that failed in the last sample
+  uint16_t lastConversionMs;      // Duration of the last conversion, until the bus reported completion
+  uint16_t maxConversionMs;       // Longest conversion so far
+  uint16_t lastReadMs;            // Time taken to read the scratchpads of all probes in the last sample
+};
+
+// Statistics of each 1-Wire bus.
+BusStats busStats[ONE_WIRE_BUS_COUNT];
+
+// Maximum number of DS18B20 probes over all buses.
+const int DS18B20_MAX_CHANNELS = 8;
+
+// Consecutive presence scans that must miss a probe before it is reported as removed.
+const uint8_t DS18B20_MISSED_SCANS = 2;
+
+// A DS18B20 channel: one probe on one bus.
+struct Ds18b20Channel {
+  uint8_t bus;
+  DeviceAddress rom;
+  bool present;                   // The probe was found by the last presence scan
+  uint8_t missedScans;            // Consecutive scans that did not find the probe
+};
+
+// Probes known to the driver: those found at boot in bus order, then those plugged in later.
+// A probe keeps its channel when it is removed, so it returns to it when plugged in again.
+Ds18b20Channel ds18b20Channels[DS18B20_MAX_CHANNELS];
+int ds18b20ChannelCount = 0;
+int ds18b20Capacity = 0;
+
+// State of the presence scan: the bus being searched, the probes found on it so far, and the
+// position of the comparison with the known probes once the search of the bus is complete.
+int ds18b20ScanBus = 0;
+bool ds18b20ScanComparing = false;
+int ds18b20ScanKnown = 0;
+int ds18b20ScanNew = 0;
+DeviceAddress ds18b20ScanFound[DS18B20_MAX_CHANNELS];
+int ds18b20ScanFoundCount = 0;
+
+// Start of the running conversion, and buses that reported its completion.
+unsigned long ds18b20ConversionStart = 0;
+bool ds18b20BusComplete[ONE_WIRE_BUS_COUNT];
+
+/**
+ * Enumerates the probes on all 1-Wire buses and sets the buses to asynchronous conversions.
+ */
+int ds18b20Begin(int maxChannels) {
+  ds18b20ChannelCount = 0;
+  ds18b20Capacity = maxChannels;
+  for (int b = 0; b < ONE_WIRE_BUS_COUNT; b++) {
+    oneWireBuses[b].begin(ONE_WIRE_PINS[b]);
+    busSensors[b].setOneWire(&oneWireBuses[b]);
+    busSensors[b].begin();
+    busSensors[b].setWaitForConversion(false);
+    memset(&busStats[b], 0, sizeof(BusStats));
+    busStats[b].devices = busSensors[b].getDeviceCount();
+    busStats[b].parasite = busSensors[b].isParasitePowerMode();
+    for (int i = 0; i < busStats[b].devices && ds18b20ChannelCount < maxChannels; i++) {
+      Ds18b20Channel& channel = ds18b20Channels[ds18b20ChannelCount++];
+      channel.bus = b;
+      channel.present = true;
+      channel.missedScans = 0;
+      busSensors[b].getAddress(channel.rom, i);
+    }
+  }
+  return ds18b20ChannelCount;
+}
+
+/**
+ * Returns true if the mask requests a probe on the given bus.
+ */
+bool ds18b20BusRequested(int b, uint32_t mask) {
+  for (int i = 0; i < ds18b20ChannelCount; i++) {
+    if ((mask & (1UL << i)) && ds18b20Channels[i].bus == b) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Starts a broadcast conversion on every bus with a requested probe. The other probes of those
+ * buses are converted too, but only the requested ones are read.
+ *
+ * @return The conversion time of the configured resolution.
+ */
+unsigned long ds18b20StartConversion(uint32_t mask) {
+  unsigned long waitMs = 0;
+  ds18b20ConversionStart = millis();
+  for (int b = 0; b < ONE_WIRE_BUS_COUNT; b++) {
+    ds18b20BusComplete[b] = !ds18b20BusRequested(b, mask);
+    if (ds18b20BusComplete[b]) {
+      continue;
+    }
+    busSensors[b].requestTemperatures();
+    busStats[b].conversions++;
+    waitMs = max(waitMs, (unsigned long)busSensors[b].millisToWaitForConversion());
+  }
+  return waitMs;
+}
+
+/**
+ * Marks a bus whose conversion has ended and records its conversion time.
+ */
+void ds18b20CompleteBus(int b) {
+  ds18b20BusComplete[b] = true;
+  busStats[b].lastConversionMs = millis() - ds18b20ConversionStart;
+  busStats[b].maxConversionMs = max(busStats[b].maxConversionMs, busStats[b].lastConversionMs);
+}
+
+/**
+ * Polls the buses for the end of the conversion.
+ *
+ * Parasite powered buses cannot be polled while the strong pull-up is held, so they are only
+ * complete once the full conversion time has passed.
+ */
+bool ds18b20IsReady() {
+  bool ready = true;
+  for (int b = 0; b < ONE_WIRE_BUS_COUNT; b++) {
+    if (ds18b20BusComplete[b]) {
+      continue;
+    }
+    if (!busStats[b].parasite && busSensors[b].isConversionComplete()) {
+      ds18b20CompleteBus(b);
+    }
+    else {
+      ready = false;
+    }
+  }
+  return ready;
+}
+
+/**
+ * Reads each requested probe's raw result (in 1/128 C) by its ROM address, bus by bus, and converts it to
+ * hundredths of a degree. Probes returning DEVICE_DISCONNECTED_RAW are counted as read errors of their bus.
+ */
+void ds18b20ReadBatch(int16_t* out, int count, int16_t invalid, uint32_t mask) {
+  for (int b = 0; b < ONE_WIRE_BUS_COUNT; b++) {
+    if (!ds18b20BusRequested(b, mask)) {
+      continue;
+    }
+    if (!ds18b20BusComplete[b]) {
+      ds18b20CompleteBus(b);
+    }
+    unsigned long readStart = millis();
+    uint8_t errors = 0;
+    for (int i = 0; i < ds18b20ChannelCount && i < count; i++) {
+      if (ds18b20Channels[i].bus != b || !(mask & (1UL << i))) {
+        continue;
+      }
+      int32_t raw = busSensors[b].getTemp(ds18b20Channels[i].rom);
+      if (raw == DEVICE_DISCONNECTED_RAW) {
+        out[i] = invalid;
+        errors++;
+        continue;
+      }
+      out[i] = (int16_t)((raw * 100 + (raw < 0 ? -64 : 64)) / 128);
+    }
+    busStats[b].lastErrors = errors;
+    busStats[b].readErrors += errors;
+    busStats[b].lastReadMs = millis() - readStart;
+  }
+}
+
+/**
+ * Returns the ROM address of a probe.
+ */
+void ds18b20ChannelId(int channel, uint8_t* id) {
+  memcpy(id, ds18b20Channels[channel].rom, 8);
+}
+
+/**
+ * Returns the channel of a known probe, or -1.
+ */
+int ds18b20FindChannel(const uint8_t* rom) {
+  for (int i = 0; i < ds18b20ChannelCount; i++) {
+    if (memcmp(ds18b20Channels[i].rom, rom, 8) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Enumerates a bus again after a probe was plugged in, so its conversion time and power mode
+ * cover the new probe. DallasTemperature derives them at begin(): a bus without probes at boot,
+ * or with 9-bit probes only, would wait 94 ms and read a 12-bit probe before its conversion ends.
+ */
+void ds18b20RefreshBus(int b) {
+  busSensors[b].begin();
+  oneWireBuses[b].reset_search();
+  busStats[b].parasite = busSensors[b].isParasitePowerMode();
+}
+
+/**
+ * Returns true if the running scan found a probe on the current bus.
+ */
+bool ds18b20ScanContains(const uint8_t* rom) {
+  for (int i = 0; i < ds18b20ScanFoundCount; i++) {
+    if (memcmp(ds18b20ScanFound[i], rom, 8) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Advances the presence scan by one step.
+ *
+ * A step is either one search of the bus for the next ROM address (one reset and 64 bit triplets,
+ * about 15 ms) or the comparison of one probe with the probes found. Each bus is searched in turn;
+ * once its search is complete, known probes it did not find for DS18B20_MISSED_SCANS scans are reported
+ * removed, known probes found again are reported present, and unknown probes are added as new channels.
+ * A probe moved to another bus keeps its channel. The bus of a probe found again or added is
+ * enumerated again (see ds18b20RefreshBus()), which takes one more step.
+ */
+ScanResult ds18b20ScanStep(DriverChange& change) {
+  int b = ds18b20ScanBus;
+  if (!ds18b20ScanComparing) {
+    DeviceAddress rom;
+    if (oneWireBuses[b].search(rom)) {
+      if (OneWire::crc8(rom, 7) == rom[7] && busSensors[b].validFamily(rom) && ds18b20ScanFoundCount < DS18B20_MAX_CHANNELS) {
+        memcpy(ds18b20ScanFound[ds18b20ScanFoundCount++], rom, 8);
+      }
+      return SCAN_CONTINUE;
+    }
+    oneWireBuses[b].reset_search();
+    ds18b20ScanComparing = true;
+    ds18b20ScanKnown = 0;
+    ds18b20ScanNew = 0;
+  }
+
+  while (ds18b20ScanKnown < ds18b20ChannelCount) {
+    int i = ds18b20ScanKnown++;
+    Ds18b20Channel& channel = ds18b20Channels[i];
+    if (channel.bus != b) {
+      continue;
+    }
+    if (ds18b20ScanContains(channel.rom)) {
+      channel.missedScans = 0;
+    }
+    else if (channel.present && ++channel.missedScans >= DS18B20_MISSED_SCANS) {
+      channel.present = false;
+      change = { i, false, false };
+      return SCAN_CHANGE;
+    }
+  }
+
+  while (ds18b20ScanNew < ds18b20ScanFoundCount) {
+    const uint8_t* rom = ds18b20ScanFound[ds18b20ScanNew++];
+    int i = ds18b20FindChannel(rom);
+    if (i >= 0) {
+      Ds18b20Channel& channel = ds18b20Channels[i];
+      channel.bus = b;
+      channel.missedScans = 0;
+      if (!channel.present) {
+        channel.present = true;
+        ds18b20RefreshBus(b);
+        change = { i, true, false };
+        return SCAN_CHANGE;
+      }
+      continue;
+    }
+    if (ds18b20ChannelCount >= ds18b20Capacity) {
+      continue;
+    }
+    i = ds18b20ChannelCount++;
+    ds18b20Channels[i].bus = b;
+    memcpy(ds18b20Channels[i].rom, rom, 8);
+    ds18b20Channels[i].present = true;
+    ds18b20Channels[i].missedScans = 0;
+    ds18b20RefreshBus(b);
+    change = { i, true, true };
+    return SCAN_CHANGE;
+  }
+
+  uint8_t devices = 0;
+  for (int i = 0; i < ds18b20ChannelCount; i++) {
+    if (ds18b20Channels[i].bus == b && ds18b20Channels[i].present) {
+      devices++;
+    }
+  }
+  busStats[b].devices = devices;
+  ds18b20ScanComparing = false;
+  ds18b20ScanFoundCount = 0;
+  ds18b20ScanBus = (b + 1) % ONE_WIRE_BUS_COUNT;
+  return (ds18b20ScanBus == 0) ? SCAN_DONE : SCAN_CONTINUE;
+}
+
+/*
+  SHT3x driver.
+*/
+
+// I2C addresses probed for SHT3x sensors (ADDR pin low and high).
+const uint8_t SHT3X_ADDRESSES[] = { 0x44, 0x45 };
+
+// Number of probed addresses.
+const int SHT3X_ADDRESS_COUNT = sizeof(SHT3X_ADDRESSES) / sizeof(SHT3X_ADDRESSES[0]);
+
+// Single-shot measurement, high repeatability, no clock stretching, and its maximum duration.
+const uint16_t SHT3X_MEASURE_CMD = 0x2400;
+const unsigned long SHT3X_MEASURE_MS = 16;
+
+// Family code of the ids given to SHT3x channels (outside the 1-Wire family codes in use).
+const uint8_t SHT3X_ID_FAMILY = 0xE3;
+
+// Addresses of the sensors found on the bus.
+uint8_t sht3xFound[SHT3X_ADDRESS_COUNT];
+int sht3xCount = 0;
+
+/**
+ * Computes the CRC-8 of an SHT3x data word (polynomial 0x31, initial value 0xFF).
+ */
+uint8_t sht3xCrc(const uint8_t* data, int length) {
+  uint8_t crc = 0xFF;
+  for (int i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/**
+ * Starts the I2C bus and looks for a sensor at each SHT3x address.
+ */
+int sht3xBegin(int maxChannels) {
+  Wire.begin();
+  sht3xCount = 0;
+  for (int i = 0; i < SHT3X_ADDRESS_COUNT && sht3xCount < maxChannels; i++) {
+    Wire.beginTransmission(SHT3X_ADDRESSES[i]);
+    if (Wire.endTransmission() == 0) {
+      sht3xFound[sht3xCount++] = SHT3X_ADDRESSES[i];
+    }
+  }
+  return sht3xCount;
+}
+
+/**
+ * Sends the single-shot measurement command to every requested sensor.
+ */
+unsigned long sht3xStartConversion(uint32_t mask) {
+  for (int i = 0; i < sht3xCount; i++) {
+    if (!(mask & (1UL << i))) {
+      continue;
+    }
+    Wire.beginTransmission(sht3xFound[i]);
+    Wire.write((uint8_t)(SHT3X_MEASURE_CMD >> 8));
+    Wire.write((uint8_t)(SHT3X_MEASURE_CMD & 0xFF));
+    Wire.endTransmission();
+  }
+  return SHT3X_MEASURE_MS;
+}
+
+/**
+ * Reads the temperature word of every requested sensor and converts it with T = -45 + 175 * raw / 65535.
+ * Sensors that do not answer or fail the CRC check are reported as invalid.
+ */
+void sht3xReadBatch(int16_t* out, int count, int16_t invalid, uint32_t mask) {
+  for (int i = 0; i < sht3xCount && i < count; i++) {
+    if (!(mask & (1UL << i))) {
+      continue;
+    }
+    uint8_t data[6];
+    int n = 0;
+    if (Wire.requestFrom(sht3xFound[i], (uint8_t)6) == 6) {
+      while (n < 6 && Wire.available()) {
+        data[n++] = Wire.read();
+      }
+    }
+    if (n < 6 || sht3xCrc(data, 2) != data[2]) {
+      out[i] = invalid;
+      continue;
+    }
+    int32_t raw = ((int32_t)data[0] << 8) | data[1];
+    out[i] = (int16_t)(-4500 + (raw * 17500 + 32767) / 65535);
+  }
+}
+
+/**
+ * Returns an id made of the SHT3x family code and the I2C address of the sensor.
+ */
+void sht3xChannelId(int channel, uint8_t* id) {
+  memset(id, 0, 8);
+  id[0] = SHT3X_ID_FAMILY;
+  id[1] = sht3xFound[channel];
+}
+
+/*
+  Synthetic driver.
+*/
+
+// Number of synthetic channels; 0 disables the driver. May be set as a build flag
+// (e.g. -DSYNTHETIC_CHANNELS=2).
+#ifndef SYNTHETIC_CHANNELS
+#define SYNTHETIC_CHANNELS 0
+#endif
+
+// Initial waveform and load rate of the synthetic channels (see SyntheticWaveform); may be set
+// as build flags and changed at run time.
+#ifndef SYNTHETIC_WAVEFORM
+#define SYNTHETIC_WAVEFORM SYNTHETIC_SINE
+#endif
+#ifndef SYNTHETIC_RATE_HZ
+#define SYNTHETIC_RATE_HZ 0
+#endif
+
+// Entries reserved for synthetic channels in a sample.
+const int SYNTHETIC_MAX_CHANNELS = 4;
+
+// Emulated conversion time when sampled at the sensor's interval.
+const unsigned long SYNTHETIC_CONVERSION_MS = 10;
+
+// Highest load rate in samples per second.
+const unsigned long SYNTHETIC_MAX_RATE_HZ = 10000;
+
+// Family code of the ids given to synthetic channels.
+const uint8_t SYNTHETIC_ID_FAMILY = 0xEF;
+
+// Waveform generated by the synthetic channels.
+enum SyntheticWaveform {
+  SYNTHETIC_SINE,   // Sine around the base temperature
+  SYNTHETIC_STEPS,  // Square wave between base - amplitude and base + amplitude
+  SYNTHETIC_NOISE,  // Uniform noise of +/- amplitude around the base temperature
+  SYNTHETIC_RAMP,   // Sawtooth from base - amplitude to base + amplitude
+  SYNTHETIC_WAVEFORM_COUNT
+};
+
+// Configuration of the synthetic channels. Channel N is offset by N / 2 C and, for periodic
+// waveforms, by N / 8 of a period.
+struct SyntheticConfig {
+  SyntheticWaveform waveform;
+  int16_t baseCentiC;
+  int16_t amplitudeCentiC;
+  unsigned long periodMs;
+  int16_t noiseCentiC;      // Noise of +/- this added to every waveform
+  unsigned long rateHz;     // Load rate in samples per second; 0 samples at the sensor's interval
+};
+
+SyntheticConfig syntheticConfig = { SYNTHETIC_WAVEFORM, 400, 100, 600000UL, 5, SYNTHETIC_RATE_HZ };
+
+// State of the pseudo-random noise generator.
+uint32_t syntheticSeed = 1;
+
+/**
+ * Returns the name of a waveform.
+ */
+const char* syntheticWaveformName(SyntheticWaveform waveform) {
+  switch (waveform) {
+    case SYNTHETIC_SINE:
+      return "sine";
+    case SYNTHETIC_STEPS:
+      return "steps";
+    case SYNTHETIC_NOISE:
+      return "noise";
+    case SYNTHETIC_RAMP:
+      return "ramp";
+    default:
+      return "unknown";
+  }
+}
+
+/**
+ * Returns the waveform with a name, or SYNTHETIC_WAVEFORM_COUNT if there is none.
+ */
+SyntheticWaveform findSyntheticWaveform(const char* name) {
+  for (int w = 0; w < SYNTHETIC_WAVEFORM_COUNT; w++) {
+    if (strcmp(name, syntheticWaveformName((SyntheticWaveform)w)) == 0) {
+      return (SyntheticWaveform)w;
+    }
+  }
+  return SYNTHETIC_WAVEFORM_COUNT;
+}
+
+/**
+ * Returns the next value of the noise generator, uniform in [-range, range].
+ */
+int syntheticNoise(int range) {
+  syntheticSeed = syntheticSeed * 1103515245UL + 12345UL;
+  return range > 0 ? (int)((syntheticSeed >> 16) % (2 * range + 1)) - range : 0;
+}
+
+/**
+ * Enables the configured number of synthetic channels.
+ */
+int syntheticBegin(int maxChannels) {
+  return min(SYNTHETIC_CHANNELS, maxChannels);
+}
+
+/**
+ * Nothing to start; returns the emulated conversion time, or 0 under load so that readings are
+ * generated as fast as the pipeline takes them.
+ */
+unsigned long syntheticStartConversion(uint32_t mask) {
+  return syntheticConfig.rateHz > 0 ? 0 : SYNTHETIC_CONVERSION_MS;
+}
+
+/**
+ * Generates a reading per channel from the configured waveform at the current time.
+ */
+void syntheticReadBatch(int16_t* out, int count, int16_t invalid, uint32_t mask) {
+  const SyntheticConfig& config = syntheticConfig;
+  unsigned long period = max(config.periodMs, 1UL);
+  for (int i = 0; i < SYNTHETIC_CHANNELS && i < count; i++) {
+    if (!(mask & (1UL << i))) {
+      continue;
+    }
+    float phase = ((millis() + period / 8 * i) % period) / (float)period;
+    int32_t value = config.baseCentiC + 50 * i;
+    switch (config.waveform) {
+      case SYNTHETIC_SINE:
+        value += (int32_t)(config.amplitudeCentiC * sinf(2.0f * PI * phase));
+        break;
+      case SYNTHETIC_STEPS:
+        value += (phase < 0.5f) ? config.amplitudeCentiC : -config.amplitudeCentiC;
+        break;
+      case SYNTHETIC_NOISE:
+        value += syntheticNoise(config.amplitudeCentiC);
+        break;
+      case SYNTHETIC_RAMP:
+        value += (int32_t)(config.amplitudeCentiC * (2.0f * phase - 1.0f));
+        break;
+      default:
+        break;
+    }
+    value += syntheticNoise(config.noiseCentiC);
+    out[i] = (int16_t)constrain(value, INT16_MIN + 1, INT16_MAX);
+  }
+}
+
+/**
+ * Returns an id made of the synthetic family code and the channel number.
+ */
+void syntheticChannelId(int channel, uint8_t* id) {
+  memset(id, 0, 8);
+  id[0] = SYNTHETIC_ID_FAMILY;
+  id[1] = channel;
+}
+
+/*
+  Driver table and sampler.
+*/
+
+// Index of each driver in sensorDrivers. Channels are numbered in this order.
+enum DriverId {
+  DRIVER_DS18B20,
+  DRIVER_SHT3X,
+  DRIVER_SYNTHETIC,
+  DRIVER_COUNT
+};
+
+// All sensor drivers.
+const SensorDriver sensorDrivers[DRIVER_COUNT] = {
+  { "ds18b20", DRIVER_CAP_UNIQUE_ID | DRIVER_CAP_POLL_READY | DRIVER_CAP_HOTPLUG, DS18B20_MAX_CHANNELS, ds18b20Begin, ds18b20StartConversion, ds18b20IsReady, ds18b20ReadBatch, ds18b20ChannelId, ds18b20ScanStep },
+  { "sht3x", 0, SHT3X_ADDRESS_COUNT, sht3xBegin, sht3xStartConversion, nullptr, sht3xReadBatch, sht3xChannelId, nullptr },
+  { "synthetic", DRIVER_CAP_SIMULATED, SYNTHETIC_MAX_CHANNELS, syntheticBegin, syntheticStartConversion, nullptr, syntheticReadBatch, syntheticChannelId, nullptr }
+};
+
+// Statistics of each driver.
+DriverStats driverStats[DRIVER_COUNT];
+
+// Driver whose presence scan is running.
+int scanDriver = 0;
+
+/**
+ * Initializes all drivers and assigns each its range of entries in a sample.
+ *
+ * @return The total number of channels found.
+ */
+int beginDrivers() {
+  int base = 0;
+  int total = 0;
+  for (int d = 0; d < DRIVER_COUNT; d++) {
+    memset(&driverStats[d], 0, sizeof(DriverStats));
+    int capacity = min((int)sensorDrivers[d].maxChannels, DRIVER_MAX_CHANNELS - base);
+    driverStats[d].base = base;
+    driverStats[d].channels = sensorDrivers[d].begin(capacity);
+    base += capacity;
+    total += driverStats[d].channels;
+  }
+  return total;
+}
+
+/**
+ * Advances the presence scan of the hot-pluggable drivers by one step, one driver after the other.
+ *
+ * @param driver Receives the driver of a change.
+ * @param change Receives the change when SCAN_CHANGE is returned.
+ * @return SCAN_DONE once the scans of all drivers completed a pass.
+ */
+ScanResult scanDrivers(int& driver, DriverChange& change) {
+  for (int n = 0; n < DRIVER_COUNT; n++) {
+    int d = scanDriver;
+    if (sensorDrivers[d].scanStep == nullptr) {
+      scanDriver = (scanDriver + 1) % DRIVER_COUNT;
+      if (scanDriver == 0) {
+        return SCAN_DONE;
+      }
+      continue;
+    }
+    ScanResult result = sensorDrivers[d].scanStep(change);
+    if (result == SCAN_CHANGE) {
+      driver = d;
+      if (change.added) {
+        driverStats[d].channels = max((int)driverStats[d].channels, change.channel + 1);
+      }
+      return SCAN_CHANGE;
+    }
+    if (result == SCAN_DONE) {
+      scanDriver = (scanDriver + 1) % DRIVER_COUNT;
+      return (scanDriver == 0) ? SCAN_DONE : SCAN_CONTINUE;
+    }
+    return SCAN_CONTINUE;
+  }
+  return SCAN_DONE;
+}
+
+/**
+ * Returns the index of a driver channel in a sample.
+ *
+ * @return The index, or -1 if the driver has no such channel.
+ */
+int driverChannelIndex(int driver, int channel) {
+  if (driver < 0 || driver >= DRIVER_COUNT || channel < 0 || channel >= driverStats[driver].channels) {
+    return -1;
+  }
+  return driverStats[driver].base + channel;
+}
+
+/**
+ * Returns the channels of a driver requested by a sample mask, as a mask of driver channels.
+ */
+uint32_t driverChannelMask(int driver, uint32_t mask) {
+  int channels = driverStats[driver].channels;
+  uint32_t all = (channels >= 32) ? 0xFFFFFFFFUL : ((1UL << channels) - 1);
+  return (mask >> driverStats[driver].base) & all;
+}
+
+/**
+ * Takes one sample of the requested channels.
+ *
+ * Conversions are started on all drivers with a requested channel first; each driver is then read
+ * as soon as it reports completion or its worst-case conversion time has passed, while the others
+ * are still converting.
+ *
+ * @param out Receives the reading of each requested channel in hundredths of a degree Celsius;
+ *            the other entries are left unchanged.
+ * @param count The number of entries in 'out' (DRIVER_MAX_CHANNELS).
+ * @param invalid The value stored for a channel without a valid reading.
+ * @param mask Bit N set to sample channel N of the sample.
+ */
+void sampleDrivers(int16_t* out, int count, int16_t invalid, uint32_t mask) {
+  unsigned long start = millis();
+  unsigned long waitMs[DRIVER_COUNT];
+  bool pending[DRIVER_COUNT];
+  for (int d = 0; d < DRIVER_COUNT; d++) {
+    pending[d] = driverChannelMask(d, mask) != 0;
+    if (pending[d]) {
+      waitMs[d] = sensorDrivers[d].startConversion(driverChannelMask(d, mask));
+      driverStats[d].conversions++;
+    }
+  }
+
+  bool waiting = true;
+  while (waiting) {
+    waiting = false;
+    for (int d = 0; d < DRIVER_COUNT; d++) {
+      if (!pending[d]) {
+        continue;
+      }
+      unsigned long elapsed = millis() - start;
+      if (elapsed < waitMs[d] && (sensorDrivers[d].isReady == nullptr || !sensorDrivers[d].isReady())) {
+        waiting = true;
+        continue;
+      }
+      pending[d] = false;
+      driverStats[d].lastConversionMs = elapsed;
+      int base = driverStats[d].base;
+      int n = min((int)driverStats[d].channels, count - base);
+      uint32_t channelMask = driverChannelMask(d, mask);
+      unsigned long readStart = millis();
+      sensorDrivers[d].readBatch(out + base, n, invalid, channelMask);
+      driverStats[d].lastReadMs = millis() - readStart;
+      for (int i = 0; i < n; i++) {
+        if (!(channelMask & (1UL << i))) {
+          continue;
+        }
+        driverStats[d].reads++;
+        if (out[base + i] == invalid) {
+          driverStats[d].readErrors++;
+        }
+      }
+    }
+    if (waiting) {
+      delay(1);
+    }
+  }
+}
+
+#endif
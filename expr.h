@@ -0,0 +1,441 @@
+/*
+  Header: expr.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the expression compiler and evaluator behind virtual sensors.
+  A virtual sensor is defined by a small expression over other sensors, for example
+  "s2 - s1" (evaporator delta-T) or "max(s0, s1, s2)" (warmest probe in a freezer).
+
+  Expressions are compiled once, when the virtual sensor is configured, into a compact
+  stack bytecode. Evaluation runs once per sample in fixed point (hundredths of a degree),
+  without parsing, floating point or heap allocation.
+
+  Expression syntax:
+  - Sensor references: s<N> or sensor<N>, where N is the sensor index.
+  - Decimal constants with up to two decimal places (e.g. 1.5, -0.25).
+  - Operators: + - * / and unary minus, with the usual precedence, and parentheses.
+  - Functions: min(...), max(...), avg(...) with 1 to 8 arguments, and abs(x).
+
+  Invalid inputs:
+  - Arithmetic on an invalid reading yields an invalid result, as does division by zero.
+  - min, max and avg ignore invalid arguments and are only invalid if all arguments are.
+
+  Usage:
+  - compileExpr() validates and compiles a definition; the bitmask of referenced sensors is returned
+    in the program so the caller can check the references.
+  - evaluateExpr() runs a compiled program against the latest readings.
+
+  Notes:
+  - The module does not depend on Arduino types so it can also be compiled on a host.
+*/
+
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stdint.h>
+#include <ctype.h>
+#include <string.h>
+
+// Maximum size of a compiled program in bytes.
+const int EXPR_MAX_CODE = 48;
+
+// Maximum evaluation stack depth of a program.
+const int EXPR_MAX_STACK = 8;
+
+// Maximum number of arguments of min, max and avg.
+const int EXPR_MAX_ARGS = 8;
+
+// Highest sensor index that can be referenced.
+const int EXPR_MAX_SENSOR = 15;
+
+// Result of evaluateExpr() when the value cannot be computed.
+const int32_t EXPR_INVALID = INT32_MIN;
+
+// Bytecode operations. SENSOR is followed by a sensor index byte, CONST by a 4-byte
+// little-endian value in hundredths, MIN/MAX/AVG by an argument count byte.
+enum ExprOp {
+  EXPR_OP_SENSOR,
+  EXPR_OP_CONST,
+  EXPR_OP_ADD,
+  EXPR_OP_SUB,
+  EXPR_OP_MUL,
+  EXPR_OP_DIV,
+  EXPR_OP_NEG,
+  EXPR_OP_ABS,
+  EXPR_OP_MIN,
+  EXPR_OP_MAX,
+  EXPR_OP_AVG
+};
+
+// A compiled expression.
+struct ExprProgram {
+  uint8_t code[EXPR_MAX_CODE];
+  uint8_t length;           // Number of bytes of code
+  uint16_t sensorMask;      // Bit N is set if sensor N is referenced
+};
+
+// Compiler state, used only while compiling.
+struct ExprCompiler {
+  const char* p;            // Current position in the source
+  ExprProgram* program;
+  int depth;                // Stack depth after the emitted code
+  const char* error;        // First error, or nullptr
+};
+
+/**
+ * Records a compile error, keeping the first one.
+ */
+void exprFail(ExprCompiler& c, const char* message) {
+  if (c.error == nullptr) {
+    c.error = message;
+  }
+}
+
+/**
+ * Emits one byte of code.
+ */
+void exprEmit(ExprCompiler& c, uint8_t byte) {
+  if (c.program->length >= EXPR_MAX_CODE) {
+    exprFail(c, "expression too long");
+    return;
+  }
+  c.program->code[c.program->length++] = byte;
+}
+
+/**
+ * Accounts for a stack effect of the emitted code.
+ */
+void exprStack(ExprCompiler& c, int delta) {
+  c.depth += delta;
+  if (c.depth > EXPR_MAX_STACK) {
+    exprFail(c, "expression too deep");
+  }
+}
+
+void exprSkipSpaces(ExprCompiler& c) {
+  while (*c.p == ' ') {
+    c.p++;
+  }
+}
+
+bool exprAccept(ExprCompiler& c, char ch) {
+  exprSkipSpaces(c);
+  if (*c.p == ch) {
+    c.p++;
+    return true;
+  }
+  return false;
+}
+
+void exprParseSum(ExprCompiler& c);
+
+/**
+ * Parses a decimal constant into hundredths.
+ */
+void exprParseNumber(ExprCompiler& c) {
+  int32_t whole = 0;
+  int32_t frac = 0;
+  int fracDigits = 0;
+  while (isdigit((unsigned char)*c.p)) {
+    whole = whole * 10 + (*c.p++ - '0');
+    if (whole > 1000000) {
+      exprFail(c, "constant out of range");
+      return;
+    }
+  }
+  if (*c.p == '.') {
+    c.p++;
+    while (isdigit((unsigned char)*c.p)) {
+      if (fracDigits < 2) {
+        frac = frac * 10 + (*c.p - '0');
+        fracDigits++;
+      }
+      c.p++;
+    }
+  }
+  while (fracDigits < 2) {
+    frac *= 10;
+    fracDigits++;
+  }
+  uint32_t value = (uint32_t)(whole * 100 + frac);
+  exprEmit(c, EXPR_OP_CONST);
+  for (int i = 0; i < 4; i++) {
+    exprEmit(c, (value >> (8 * i)) & 0xFF);
+  }
+  exprStack(c, 1);
+}
+
+/**
+ * Parses a sensor reference, function call or parenthesized expression.
+ */
+void exprParsePrimary(ExprCompiler& c) {
+  exprSkipSpaces(c);
+  if (isdigit((unsigned char)*c.p) || *c.p == '.') {
+    exprParseNumber(c);
+    return;
+  }
+  if (exprAccept(c, '(')) {
+    exprParseSum(c);
+    if (!exprAccept(c, ')')) {
+      exprFail(c, "expected )");
+    }
+    return;
+  }
+
+  const char* start = c.p;
+  while (isalpha((unsigned char)*c.p)) {
+    c.p++;
+  }
+  size_t len = c.p - start;
+  if (len == 0) {
+    exprFail(c, "unexpected character");
+    return;
+  }
+
+  if ((len == 1 && start[0] == 's') || (len == 6 && strncmp(start, "sensor", 6) == 0)) {
+    if (!isdigit((unsigned char)*c.p)) {
+      exprFail(c, "expected sensor index");
+      return;
+    }
+    int index = 0;
+    while (isdigit((unsigned char)*c.p)) {
+      index = index * 10 + (*c.p++ - '0');
+      if (index > EXPR_MAX_SENSOR) {
+        exprFail(c, "sensor index out of range");
+        return;
+      }
+    }
+    exprEmit(c, EXPR_OP_SENSOR);
+    exprEmit(c, index);
+    exprStack(c, 1);
+    c.program->sensorMask |= (1 << index);
+    return;
+  }
+
+  uint8_t op;
+  if (len == 3 && strncmp(start, "min", 3) == 0) {
+    op = EXPR_OP_MIN;
+  }
+  else if (len == 3 && strncmp(start, "max", 3) == 0) {
+    op = EXPR_OP_MAX;
+  }
+  else if (len == 3 && strncmp(start, "avg", 3) == 0) {
+    op = EXPR_OP_AVG;
+  }
+  else if (len == 3 && strncmp(start, "abs", 3) == 0) {
+    op = EXPR_OP_ABS;
+  }
+  else {
+    exprFail(c, "unknown name");
+    return;
+  }
+
+  if (!exprAccept(c, '(')) {
+    exprFail(c, "expected (");
+    return;
+  }
+  int args = 0;
+  do {
+    exprParseSum(c);
+    args++;
+  } while (c.error == nullptr && exprAccept(c, ','));
+  if (!exprAccept(c, ')')) {
+    exprFail(c, "expected )");
+    return;
+  }
+
+  if (op == EXPR_OP_ABS) {
+    if (args != 1) {
+      exprFail(c, "abs takes one argument");
+    }
+    exprEmit(c, op);
+    return;
+  }
+  if (args > EXPR_MAX_ARGS) {
+    exprFail(c, "too many arguments");
+    return;
+  }
+  exprEmit(c, op);
+  exprEmit(c, args);
+  exprStack(c, 1 - args);
+}
+
+/**
+ * Parses an optionally negated primary.
+ */
+void exprParseUnary(ExprCompiler& c) {
+  if (exprAccept(c, '-')) {
+    exprParseUnary(c);
+    exprEmit(c, EXPR_OP_NEG);
+    return;
+  }
+  exprParsePrimary(c);
+}
+
+/**
+ * Parses a product or quotient.
+ */
+void exprParseProduct(ExprCompiler& c) {
+  exprParseUnary(c);
+  while (c.error == nullptr) {
+    uint8_t op;
+    if (exprAccept(c, '*')) {
+      op = EXPR_OP_MUL;
+    }
+    else if (exprAccept(c, '/')) {
+      op = EXPR_OP_DIV;
+    }
+    else {
+      return;
+    }
+    exprParseUnary(c);
+    exprEmit(c, op);
+    exprStack(c, -1);
+  }
+}
+
+/**
+ * Parses a sum or difference.
+ */
+void exprParseSum(ExprCompiler& c) {
+  exprParseProduct(c);
+  while (c.error == nullptr) {
+    uint8_t op;
+    if (exprAccept(c, '+')) {
+      op = EXPR_OP_ADD;
+    }
+    else if (exprAccept(c, '-')) {
+      op = EXPR_OP_SUB;
+    }
+    else {
+      return;
+    }
+    exprParseProduct(c);
+    exprEmit(c, op);
+    exprStack(c, -1);
+  }
+}
+
+/**
+ * Compiles an expression into bytecode.
+ *
+ * @param source The expression text.
+ * @param program Receives the compiled program.
+ * @return nullptr on success, or a short description of the first error.
+ */
+const char* compileExpr(const char* source, ExprProgram& program) {
+  memset(&program, 0, sizeof(program));
+  ExprCompiler c = { source, &program, 0, nullptr };
+  exprParseSum(c);
+  exprSkipSpaces(c);
+  if (c.error == nullptr && *c.p != '\0') {
+    exprFail(c, "unexpected trailing characters");
+  }
+  if (c.error != nullptr) {
+    memset(&program, 0, sizeof(program));
+  }
+  return c.error;
+}
+
+/**
+ * Evaluates a compiled expression.
+ *
+ * @param program The compiled program.
+ * @param inputs The latest reading of each sensor in hundredths of a degree.
+ * @param inputCount The number of entries in 'inputs'.
+ * @param invalid The value marking an invalid reading in 'inputs'.
+ * @return The result in hundredths of a degree, or EXPR_INVALID.
+ */
+int32_t evaluateExpr(const ExprProgram& program, const int16_t* inputs, int inputCount, int16_t invalid) {
+  int32_t stack[EXPR_MAX_STACK];
+  int sp = 0;
+  int pc = 0;
+
+  while (pc < program.length) {
+    uint8_t op = program.code[pc++];
+    switch (op) {
+    case EXPR_OP_SENSOR: {
+      uint8_t index = program.code[pc++];
+      int16_t value = (index < inputCount) ? inputs[index] : invalid;
+      stack[sp++] = (value == invalid) ? EXPR_INVALID : value;
+      break;
+    }
+    case EXPR_OP_CONST: {
+      uint32_t value = 0;
+      for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)program.code[pc++] << (8 * i);
+      }
+      stack[sp++] = (int32_t)value;
+      break;
+    }
+    case EXPR_OP_NEG:
+    case EXPR_OP_ABS: {
+      int32_t a = stack[sp - 1];
+      if (a != EXPR_INVALID && (op == EXPR_OP_NEG || a < 0)) {
+        stack[sp - 1] = -a;
+      }
+      break;
+    }
+    case EXPR_OP_MIN:
+    case EXPR_OP_MAX:
+    case EXPR_OP_AVG: {
+      uint8_t args = program.code[pc++];
+      int64_t sum = 0;
+      int32_t best = EXPR_INVALID;
+      int valid = 0;
+      for (int i = sp - args; i < sp; i++) {
+        int32_t v = stack[i];
+        if (v == EXPR_INVALID) {
+          continue;
+        }
+        if (valid == 0 || (op == EXPR_OP_MIN && v < best) || (op == EXPR_OP_MAX && v > best)) {
+          best = v;
+        }
+        sum += v;
+        valid++;
+      }
+      sp -= args;
+      if (valid == 0) {
+        stack[sp++] = EXPR_INVALID;
+      }
+      else {
+        stack[sp++] = (op == EXPR_OP_AVG) ? (int32_t)(sum / valid) : best;
+      }
+      break;
+    }
+    default: {
+      int32_t b = stack[--sp];
+      int32_t a = stack[sp - 1];
+      int64_t r;
+      if (a == EXPR_INVALID || b == EXPR_INVALID) {
+        stack[sp - 1] = EXPR_INVALID;
+        break;
+      }
+      if (op == EXPR_OP_ADD) {
+        r = (int64_t)a + b;
+      }
+      else if (op == EXPR_OP_SUB) {
+        r = (int64_t)a - b;
+      }
+      else if (op == EXPR_OP_MUL) {
+        r = ((int64_t)a * b) / 100;
+      }
+      else if (b != 0) {
+        r = ((int64_t)a * 100) / b;
+      }
+      else {
+        stack[sp - 1] = EXPR_INVALID;
+        break;
+      }
+      stack[sp - 1] = (r > INT32_MAX || r <= INT32_MIN) ? EXPR_INVALID : (int32_t)r;
+      break;
+    }
+    }
+  }
+  return (sp == 1) ? stack[0] : EXPR_INVALID;
+}
+
+#endif
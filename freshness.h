@@ -0,0 +1,126 @@
+/*
+  Header: freshness.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the freshness instrumentation of the stored readings. Each sample is
+  stamped with the time its conversion started and the time it was published (stored in the
+  series served by "/data"), so the age of the data a client receives can be measured from the
+  moment the sensor was read rather than from when the time string was formatted.
+
+  Two latency distributions are kept as histograms:
+  - Sensor to publish: from the start of the conversion to the store of the reading.
+  - Publish to first delivery: from the store of a reading to the first response that served it.
+  Together with the age of each response they give the end-to-end freshness of the dashboard.
+
+  Usage:
+  - Call publishSample() when a sensor's reading is stored, with its conversion start time.
+  - Call recordDelivery() when a response serves a sensor's series.
+
+  Notes:
+  - publishSample() is called by the main loop and recordDelivery() by the web server task; each
+    histogram has a single writer, and a delivery racing a publish is skipped.
+  - The module does not depend on Arduino types, so it can be compiled on a host.
+*/
+
+#ifndef FRESHNESS_H
+#define FRESHNESS_H
+
+#include <stdint.h>
+
+// Number of sensors (MAX_SENSORS).
+const int FRESHNESS_MAX_SENSORS = 8;
+
+// Upper bounds of the histogram buckets, in milliseconds; a last bucket counts larger values.
+const uint32_t FRESHNESS_BUCKET_MS[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000, 300000 };
+const int FRESHNESS_BUCKETS = sizeof(FRESHNESS_BUCKET_MS) / sizeof(FRESHNESS_BUCKET_MS[0]) + 1;
+
+// Distribution of a latency.
+struct LatencyHistogram {
+  uint32_t buckets[FRESHNESS_BUCKETS];  // Latencies per bucket (not cumulative)
+  uint32_t count;
+  uint64_t sumMs;
+  uint32_t maxMs;
+};
+
+// Timing of the last published sample of a sensor. The generation is incremented after the
+// times are written, so a reader on another task can tell a consistent copy.
+struct SampleStamp {
+  uint32_t startMs;             // Start of the conversion, in milliseconds since boot
+  uint32_t startEpoch;          // Start of the conversion in seconds since the Unix epoch (0 if unknown)
+  uint32_t publishMs;           // Time the reading was stored
+  volatile uint32_t generation; // Samples published
+  uint32_t delivered;           // Generation last delivered, written by the web server task
+};
+
+// Freshness state of all sensors.
+struct FreshnessState {
+  SampleStamp stamps[FRESHNESS_MAX_SENSORS];
+  LatencyHistogram publishLatency;   // Written by the main loop
+  LatencyHistogram deliveryLatency;  // Written by the web server task
+};
+
+/**
+ * Adds a latency to a histogram.
+ */
+void recordLatency(LatencyHistogram& histogram, uint32_t ms) {
+  int bucket = 0;
+  while (bucket < FRESHNESS_BUCKETS - 1 && ms > FRESHNESS_BUCKET_MS[bucket]) {
+    bucket++;
+  }
+  histogram.buckets[bucket]++;
+  histogram.count++;
+  histogram.sumMs += ms;
+  if (ms > histogram.maxMs) {
+    histogram.maxMs = ms;
+  }
+}
+
+/**
+ * Records the publication of a sensor's reading.
+ *
+ * @param state The freshness state.
+ * @param sensor The sensor.
+ * @param startMs The start of the reading's conversion, in milliseconds since boot.
+ * @param startEpoch The start of the conversion in seconds since the Unix epoch, or 0 if unknown.
+ * @param nowMs The time the reading was stored.
+ * @return The latency from the start of the conversion to the publication, in milliseconds.
+ */
+uint32_t publishSample(FreshnessState& state, int sensor, uint32_t startMs, uint32_t startEpoch, uint32_t nowMs) {
+  uint32_t latency = nowMs - startMs;
+  if (sensor < 0 || sensor >= FRESHNESS_MAX_SENSORS) {
+    return latency;
+  }
+  SampleStamp& stamp = state.stamps[sensor];
+  stamp.startMs = startMs;
+  stamp.startEpoch = startEpoch;
+  stamp.publishMs = nowMs;
+  stamp.generation = stamp.generation + 1;
+  recordLatency(state.publishLatency, latency);
+  return latency;
+}
+
+/**
+ * Records a response serving a sensor's series; the first response after a publication adds its
+ * latency to the delivery histogram.
+ *
+ * @return Whether the response was the first delivery of the last published sample.
+ */
+bool recordDelivery(FreshnessState& state, int sensor, uint32_t nowMs) {
+  if (sensor < 0 || sensor >= FRESHNESS_MAX_SENSORS) {
+    return false;
+  }
+  SampleStamp& stamp = state.stamps[sensor];
+  uint32_t generation = stamp.generation;
+  uint32_t publishMs = stamp.publishMs;
+  if (generation == 0 || generation == stamp.delivered || generation != stamp.generation) {
+    return false;
+  }
+  stamp.delivered = generation;
+  recordLatency(state.deliveryLatency, nowMs - publishMs);
+  return true;
+}
+
+#endif
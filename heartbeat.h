@@ -0,0 +1,174 @@
+/*
+  Header: heartbeat.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the heartbeat: a status summary posted at a fixed interval, so a
+  receiver notices a device that stopped reporting (dead-man reporting) instead of waiting for an
+  alert that a dead device cannot send.
+
+  Each heartbeat summarizes the window since the last delivered one: per sensor, the number of
+  samples, the invalid readings and the minimum, maximum and last temperature. The window is only
+  restarted when a heartbeat is delivered, so after a failed post the next heartbeat covers the
+  whole period and nothing is lost; a heartbeat costs one request per interval whatever the
+  sampling rate.
+
+  Usage:
+  - Call recordHeartbeatSample() for each sensor read by a sample.
+  - When heartbeatDue() returns true, post the summary and call heartbeatSent().
+
+  Notes:
+  - The receiver side is checked by tools/heartbeat_check.cpp, which flags devices whose
+    heartbeat is overdue.
+  - The module does not depend on Arduino types, so it can be compiled on a host.
+*/
+
+#ifndef HEARTBEAT_H
+#define HEARTBEAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Number of sensors (MAX_SENSORS).
+const int HEARTBEAT_MAX_SENSORS = 8;
+
+// NVS namespace and key of the heartbeat configuration.
+const char* HEARTBEAT_NVS_NAMESPACE = "heartbeat";
+const char* HEARTBEAT_NVS_KEY = "config";
+
+// Default and allowed intervals, in seconds; an interval of 0 disables the heartbeat.
+const uint32_t HEARTBEAT_DEFAULT_INTERVAL_SEC = 300;
+const uint32_t HEARTBEAT_MIN_INTERVAL_SEC = 30;
+const uint32_t HEARTBEAT_MAX_INTERVAL_SEC = 86400;
+
+// Heartbeat configuration, persisted in NVS.
+struct HeartbeatConfig {
+  uint32_t intervalSec;       // Interval between heartbeats, 0 if disabled
+  char url[128];              // URL the heartbeat is posted to; INFO_WEBHOOK_URL if empty
+};
+
+// Summary of one sensor over the current window.
+struct HeartbeatSensor {
+  uint32_t samples;           // Readings taken, valid or not
+  uint32_t invalid;           // Readings that returned no temperature
+  int16_t minCentiC;          // Minimum valid reading, in hundredths of a degree
+  int16_t maxCentiC;
+  int16_t lastCentiC;         // Last reading, valid or not
+};
+
+// State of the heartbeat, owned by the main loop.
+struct HeartbeatState {
+  HeartbeatSensor sensors[HEARTBEAT_MAX_SENSORS];
+  unsigned long windowStartMs;  // Start of the window, when the last heartbeat was delivered
+  unsigned long lastAttemptMs;  // Time of the last post
+  uint32_t seq;                 // Heartbeats delivered since boot
+  uint32_t failures;            // Posts that failed since the last delivered heartbeat
+  uint32_t totalFailures;
+  int lastStatus;               // HTTP status of the last post, or a negative client error
+};
+
+/**
+ * Clears the sensor summaries and starts a new window.
+ *
+ * @param state The heartbeat state.
+ * @param invalid The value of an invalid reading.
+ * @param nowMs The current time in milliseconds.
+ */
+void resetHeartbeatWindow(HeartbeatState& state, int16_t invalid, unsigned long nowMs) {
+  for (int s = 0; s < HEARTBEAT_MAX_SENSORS; s++) {
+    HeartbeatSensor& sensor = state.sensors[s];
+    sensor.samples = 0;
+    sensor.invalid = 0;
+    sensor.minCentiC = invalid;
+    sensor.maxCentiC = invalid;
+    sensor.lastCentiC = invalid;
+  }
+  state.windowStartMs = nowMs;
+}
+
+/**
+ * Starts the heartbeat; the first heartbeat is due one interval later.
+ */
+void startHeartbeat(HeartbeatState& state, int16_t invalid, unsigned long nowMs) {
+  memset(&state, 0, sizeof(state));
+  resetHeartbeatWindow(state, invalid, nowMs);
+  state.lastAttemptMs = nowMs;
+}
+
+/**
+ * Adds a reading to the summary of a sensor.
+ *
+ * @param state The heartbeat state.
+ * @param sensor The sensor.
+ * @param centiC The reading in hundredths of a degree.
+ * @param invalid The value of an invalid reading.
+ */
+void recordHeartbeatSample(HeartbeatState& state, int sensor, int16_t centiC, int16_t invalid) {
+  if (sensor < 0 || sensor >= HEARTBEAT_MAX_SENSORS) {
+    return;
+  }
+  HeartbeatSensor& s = state.sensors[sensor];
+  s.samples++;
+  s.lastCentiC = centiC;
+  if (centiC == invalid) {
+    s.invalid++;
+    return;
+  }
+  if (s.minCentiC == invalid || centiC < s.minCentiC) {
+    s.minCentiC = centiC;
+  }
+  if (s.maxCentiC == invalid || centiC > s.maxCentiC) {
+    s.maxCentiC = centiC;
+  }
+}
+
+/**
+ * Returns whether a heartbeat should be posted: one interval after the last attempt, delivered or not.
+ */
+bool heartbeatDue(const HeartbeatState& state, const HeartbeatConfig& config, unsigned long nowMs) {
+  return config.intervalSec > 0 && nowMs - state.lastAttemptMs >= config.intervalSec * 1000UL;
+}
+
+/**
+ * Records the outcome of a post. A delivered heartbeat starts a new window; after a failure the
+ * window keeps growing, so the next heartbeat also covers the period of the failed one.
+ *
+ * @param state The heartbeat state.
+ * @param status The HTTP status, or a negative client error.
+ * @param invalid The value of an invalid reading.
+ * @param nowMs The current time in milliseconds.
+ * @return Whether the heartbeat was delivered.
+ */
+bool heartbeatSent(HeartbeatState& state, int status, int16_t invalid, unsigned long nowMs) {
+  state.lastAttemptMs = nowMs;
+  state.lastStatus = status;
+  if (status < 200 || status >= 300) {
+    state.failures++;
+    state.totalFailures++;
+    return false;
+  }
+  state.seq++;
+  state.failures = 0;
+  resetHeartbeatWindow(state, invalid, nowMs);
+  return true;
+}
+
+/**
+ * Returns the problem with a heartbeat configuration, or nullptr if it is valid.
+ */
+const char* checkHeartbeatConfig(const HeartbeatConfig& config) {
+  if (config.intervalSec != 0 && (config.intervalSec < HEARTBEAT_MIN_INTERVAL_SEC || config.intervalSec > HEARTBEAT_MAX_INTERVAL_SEC)) {
+    return "Interval must be 0 or between 30 and 86400 seconds";
+  }
+  if (memchr(config.url, '\0', sizeof(config.url)) == nullptr) {
+    return "URL too long";
+  }
+  if (config.url[0] != '\0' && strncmp(config.url, "http://", 7) != 0 && strncmp(config.url, "https://", 8) != 0) {
+    return "URL must start with http:// or https://";
+  }
+  return nullptr;
+}
+
+#endif
@@ -333,6 +333,28 @@ const char data_html[] PROGMEM = R"rawliteral(
             margin-top: 10px;
         }
 
+        .sensor-container {
+            padding: 10px;
+            text-align: center;
+        }
+
+        .alert-list {
+            text-align: center;
+        }
+
+        .alert-item {
+            display: inline-block;
+            margin: 5px;
+            padding: 8px;
+            background-color: #ffe0e0;
+            border-radius: 4px;
+        }
+
+        .alert-item button {
+            margin-left: 5px;
+        }
+
+        #sensorSelect,
         #timerDelay {
             padding: 8px;
             font-size: 14px;
@@ -387,6 +409,14 @@ const char data_html[] PROGMEM = R"rawliteral(
             </div>
         </div>
     </div>
+    <div class="sensor-container">
+        <label for="sensorSelect">Sensor:</label>
+        <select id="sensorSelect" name="sensorSelect" onchange="selectSensor()">
+            <option value="0">probe0</option>
+        </select>
+        <span id="calibrationStatus"></span>
+    </div>
+    <div class="alert-list" id="alertList"></div>
     <table id="temperatureTable">
         <thead>
             <tr>
@@ -428,16 +458,141 @@ const char data_html[] PROGMEM = R"rawliteral(
             }
         }
 
-        function fetchDataOnce() {
-            fetch('/data')
+        // Sensor whose history is shown in the table
+        var selectedSensor = 0;
+
+        // Latest sensor list from /sensors
+        var sensorList = [];
+
+        // Timer of the next fetch of the selected sensor's readings
+        var dataTimer = null;
+
+        function updateCalibrationStatus() {
+            var status = "";
+            for (var i = 0; i < sensorList.length; i++) {
+                if (sensorList[i].sensor === selectedSensor && sensorList[i].kind === "physical") {
+                    status = (sensorList[i].calibration === "none") ? "Not calibrated" : "Calibrated (" + sensorList[i].calibration + ")";
+                }
+            }
+            document.getElementById("calibrationStatus").innerText = status;
+        }
+
+        function updateSensors(sensorArray) {
+            var sensorSelect = document.getElementById("sensorSelect");
+            sensorSelect.innerHTML = '';
+            sensorList = sensorArray;
+
+            for (var i = 0; i < sensorArray.length; i++) {
+                var option = document.createElement("option");
+                option.value = sensorArray[i].sensor;
+                option.text = sensorArray[i].name;
+                if (sensorArray[i].kind === "virtual") {
+                    option.text += " (" + sensorArray[i].expr + ")";
+                }
+                else if (sensorArray[i].kind === "group") {
+                    option.text += " (" + sensorArray[i].mode + " of " + sensorArray[i].members.join(", ") + ")";
+                }
+                option.selected = (sensorArray[i].sensor === selectedSensor);
+                sensorSelect.appendChild(option);
+            }
+            updateCalibrationStatus();
+        }
+
+        // Lists the open alerts, with buttons to acknowledge them or snooze them for an hour
+        function updateAlerts(alertArray) {
+            var alertList = document.getElementById("alertList");
+            alertList.innerHTML = '';
+
+            for (var i = 0; i < alertArray.length; i++) {
+                var entry = alertArray[i];
+                var item = document.createElement("div");
+                item.className = "alert-item";
+                var text = "Alert #" + entry.id + " on " + entry.name + " since " + new Date(entry.start * 1000).toLocaleString();
+                if (entry.acknowledged) {
+                    text += (entry.snoozeUntil > 0) ? " (snoozed until " + new Date(entry.snoozeUntil * 1000).toLocaleTimeString() + ")" : " (acknowledged)";
+                }
+                item.innerText = text;
+                if (!entry.acknowledged) {
+                    var ackButton = document.createElement("button");
+                    ackButton.innerText = "Acknowledge";
+                    ackButton.onclick = acknowledgeAlert.bind(null, entry.id, 0);
+                    item.appendChild(ackButton);
+                    var snoozeButton = document.createElement("button");
+                    snoozeButton.innerText = "Snooze 1 h";
+                    snoozeButton.onclick = acknowledgeAlert.bind(null, entry.id, 3600);
+                    item.appendChild(snoozeButton);
+                }
+                alertList.appendChild(item);
+            }
+        }
+
+        function fetchAlerts() {
+            fetch('/alerts')
                 .then(response => response.json())
+                .then(alertArray => {
+                    updateAlerts(alertArray);
+                })
+                .catch(error => {
+                    console.error('Error fetching alerts:', error);
+                });
+        }
+
+        function acknowledgeAlert(id, snooze) {
+            fetch('/api/alerts/' + id + '/ack' + (snooze > 0 ? '?snooze=' + snooze : ''), { method: 'POST' })
+                .then(response => {
+                    if (!response.ok) {
+                        response.text().then(text => alert(text));
+                    }
+                    setTimeout(fetchAlerts, 1000);
+                })
+                .catch(error => {
+                    console.error('Error acknowledging alert:', error);
+                });
+        }
+
+        function selectSensor() {
+            selectedSensor = parseInt(document.getElementById("sensorSelect").value);
+            updateCalibrationStatus();
+            fetchData();
+        }
+
+        // Fetches the readings of the selected sensor, then schedules the next fetch for just after
+        // the device's next sample of it, as announced by the X-Next-Sample-In-Ms header
+        function fetchData() {
+            fetch('/data?sensor=' + selectedSensor)
+                .then(response => {
+                    scheduleDataFetch(response.headers.get('X-Next-Sample-In-Ms'));
+                    return response.json();
+                })
                 .then(dataArray => {
                     updateTable(dataArray);
                 })
                 .catch(error => {
                     console.error('Error fetching data:', error);
+                    scheduleDataFetch(null);
+                });
+        }
+
+        // Without a hint, polls at the former fixed interval
+        function scheduleDataFetch(nextSampleInMs) {
+            var delay = (nextSampleInMs === null) ? 30500 : parseInt(nextSampleInMs) + 500;
+            delay = Math.min(Math.max(delay, 2000), 600000);
+            clearTimeout(dataTimer);
+            dataTimer = setTimeout(fetchData, delay);
+        }
+
+        function fetchDataOnce() {
+            fetch('/sensors')
+                .then(response => response.json())
+                .then(sensorArray => {
+                    updateSensors(sensorArray);
+                })
+                .catch(error => {
+                    console.error('Error fetching sensors:', error);
                 });
 
+            fetchData();
+
             fetch('/info')
                 .then(response => response.json())
                 .then(infoArray => {
@@ -446,19 +601,12 @@ const char data_html[] PROGMEM = R"rawliteral(
                 .catch(error => {
                     console.error('Error fetching info:', error);
                 });
+
+            fetchAlerts();
         }
 
         function fetchDataInterval() {
             setInterval(function() {
-                fetch('/data')
-                    .then(response => response.json())
-                    .then(dataArray => {
-                        updateTable(dataArray);
-                    })
-                    .catch(error => {
-                        console.error('Error fetching data:', error);
-                    });
-
                 fetch('/info')
                     .then(response => response.json())
                     .then(infoArray => {
@@ -467,6 +615,8 @@ const char data_html[] PROGMEM = R"rawliteral(
                     .catch(error => {
                         console.error('Error fetching info:', error);
                     });
+
+                fetchAlerts();
             }, 30500);
         }
 
@@ -0,0 +1,328 @@
+/*
+  Header: model.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides an online first-order thermal model for each temperature sensor.
+  The model assumes the monitored space relaxes exponentially towards a setpoint between samples:
+
+      T[k+1] = a * T[k] + b,   a = exp(-dt / tau),   b = (1 - a) * setpoint
+
+  The parameters (a, b) are fitted with recursive least squares (RLS) and a forgetting factor,
+  one update per sample, in a fixed amount of memory (two parameters and a 2x2 covariance).
+  The one-step prediction residual is then used to classify disturbances:
+
+  - Door open: a sharp warming step that the model recovers from within MODEL_DOOR_RECOVERY_SEC.
+  - Equipment failure: a warming excursion that is still present after MODEL_DOOR_RECOVERY_SEC.
+  - Insulation degradation: the slowly averaged time constant drifts below the baseline learned
+    after warm-up by more than MODEL_DEGRADE_FRACTION over days to weeks.
+
+  Usage:
+  - Call updateThermalModel() once per valid sample with the sample period in seconds.
+  - The returned ModelEvent (if not MODEL_EVENT_NONE) should be reported by the caller.
+  - thermalModelTau() and thermalModelSetpoint() convert the fitted parameters back to physical units.
+
+  Notes:
+  - The model is only meaningful for a fixed sample period; it is reset when the period changes.
+  - Parameter updates are frozen during an excursion so that disturbances do not corrupt the fit.
+  - The model does not depend on Arduino types so it can also be compiled on a host.
+*/
+
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <math.h>
+
+// RLS forgetting factor per sample (0.999 remembers roughly the last 1000 samples).
+const float MODEL_FORGETTING = 0.999;
+
+// Initial covariance diagonal, also used to bound covariance wind-up without excitation.
+const float MODEL_INITIAL_COVARIANCE = 1000.0;
+
+// Number of samples before the model is trusted for event classification.
+const unsigned long MODEL_WARMUP_SAMPLES = 36;
+
+// Residual threshold, in standard deviations, for starting an excursion.
+const float MODEL_RESIDUAL_THRESHOLD = 4.0;
+
+// Lower bound on the residual standard deviation (in Celsius) to avoid false triggers on quiet signals.
+const float MODEL_MIN_SIGMA = 0.1;
+
+// Time (in seconds) a warming excursion may last and still be classified as a door opening.
+const float MODEL_DOOR_RECOVERY_SEC = 1200.0; // 20 minutes
+
+// Averaging time constant (in seconds) for the slow time-constant tracker.
+const float MODEL_SLOW_TAU_WINDOW_SEC = 604800.0; // 7 days
+
+// Time (in seconds) after warm-up over which the insulation baseline time constant is averaged.
+const float MODEL_BASELINE_SEC = 86400.0; // 1 day
+
+// Relative drop of the slow time constant below the baseline that signals insulation degradation.
+const float MODEL_DEGRADE_FRACTION = 0.25;
+
+// Classification state of a thermal model.
+enum ModelState {
+  MODEL_LEARNING,   // Not enough samples yet
+  MODEL_NORMAL,     // Tracking, residuals within bounds
+  MODEL_EXCURSION   // Residuals above threshold, classification pending
+};
+
+// Events produced by the model for the caller to report.
+enum ModelEvent {
+  MODEL_EVENT_NONE,
+  MODEL_EVENT_DOOR_OPEN,            // Excursion recovered within MODEL_DOOR_RECOVERY_SEC
+  MODEL_EVENT_EQUIPMENT_FAILURE,    // Excursion persisted past MODEL_DOOR_RECOVERY_SEC
+  MODEL_EVENT_RECOVERED,            // A failure excursion returned to normal
+  MODEL_EVENT_INSULATION_DEGRADED,  // Slow time constant dropped below the baseline threshold
+  MODEL_EVENT_INSULATION_RESTORED   // Slow time constant returned above the baseline threshold
+};
+
+// Fixed-size state of the online thermal model for one sensor.
+struct ThermalModel {
+  float a;                    // Fitted decay coefficient
+  float b;                    // Fitted offset coefficient
+  float P[2][2];              // RLS covariance matrix
+  float lastTemp;             // Previous sample (regressor)
+  float dtSec;                // Sample period the model was fitted for
+  float residual;             // Last one-step prediction residual
+  float residualVar;          // Exponentially averaged residual variance
+  float slowTau;              // Slowly averaged time constant (seconds)
+  float baselineTau;          // Time constant captured after warm-up (0 until captured)
+  float excursionSec;         // Duration of the current excursion
+  float trackedSec;           // Time spent tracking since warm-up
+  unsigned long samples;      // Number of samples seen
+  unsigned long doorEvents;   // Number of door-open events
+  unsigned long failureEvents;// Number of equipment-failure events
+  ModelState state;
+  bool failureReported;       // An equipment-failure event was raised for the current excursion
+  bool degraded;              // Insulation degradation is currently reported
+};
+
+/**
+ * Resets a thermal model to its initial, untrained state.
+ *
+ * @param model The model to reset.
+ * @param dtSec The sample period, in seconds, the model will be fitted for.
+ */
+void resetThermalModel(ThermalModel& model, float dtSec) {
+  model.a = 1.0;
+  model.b = 0.0;
+  model.P[0][0] = MODEL_INITIAL_COVARIANCE;
+  model.P[0][1] = 0.0;
+  model.P[1][0] = 0.0;
+  model.P[1][1] = MODEL_INITIAL_COVARIANCE;
+  model.lastTemp = 0.0;
+  model.dtSec = dtSec;
+  model.residual = 0.0;
+  model.residualVar = MODEL_MIN_SIGMA * MODEL_MIN_SIGMA;
+  model.slowTau = 0.0;
+  model.baselineTau = 0.0;
+  model.excursionSec = 0.0;
+  model.trackedSec = 0.0;
+  model.samples = 0;
+  model.doorEvents = 0;
+  model.failureEvents = 0;
+  model.state = MODEL_LEARNING;
+  model.failureReported = false;
+  model.degraded = false;
+}
+
+/**
+ * Returns the fitted cooling time constant in seconds.
+ *
+ * @param model The thermal model.
+ * @return The time constant, or NAN if the fitted parameters do not describe a stable decay.
+ */
+float thermalModelTau(const ThermalModel& model) {
+  if (model.a <= 0.0 || model.a >= 1.0) {
+    return NAN;
+  }
+  return -model.dtSec / logf(model.a);
+}
+
+/**
+ * Returns the fitted setpoint (the temperature the space relaxes towards) in Celsius.
+ *
+ * @param model The thermal model.
+ * @return The setpoint, or NAN if the fitted parameters do not describe a stable decay.
+ */
+float thermalModelSetpoint(const ThermalModel& model) {
+  if (model.a <= 0.0 || model.a >= 1.0) {
+    return NAN;
+  }
+  return model.b / (1.0 - model.a);
+}
+
+/**
+ * Returns a short name for a model state, used in JSON output.
+ */
+const char* thermalModelStateName(ModelState state) {
+  switch (state) {
+  case MODEL_NORMAL:
+    return "normal";
+  case MODEL_EXCURSION:
+    return "excursion";
+  default:
+    return "learning";
+  }
+}
+
+/**
+ * Returns the webhook event type for a model event.
+ */
+const char* thermalModelEventName(ModelEvent event) {
+  switch (event) {
+  case MODEL_EVENT_DOOR_OPEN:
+    return "door_open";
+  case MODEL_EVENT_EQUIPMENT_FAILURE:
+    return "equipment_failure";
+  case MODEL_EVENT_RECOVERED:
+    return "recovered";
+  case MODEL_EVENT_INSULATION_DEGRADED:
+    return "insulation_degraded";
+  case MODEL_EVENT_INSULATION_RESTORED:
+    return "insulation_restored";
+  default:
+    return "none";
+  }
+}
+
+/**
+ * Performs one recursive least squares step on the model parameters.
+ *
+ * @param model The thermal model.
+ * @param x The regressor (previous temperature).
+ * @param y The observation (current temperature).
+ */
+void thermalModelRls(ThermalModel& model, float x, float y) {
+  // P * phi, with phi = [x, 1]
+  float p0 = model.P[0][0] * x + model.P[0][1];
+  float p1 = model.P[1][0] * x + model.P[1][1];
+  float denom = MODEL_FORGETTING + x * p0 + p1;
+  float k0 = p0 / denom;
+  float k1 = p1 / denom;
+  float e = y - (model.a * x + model.b);
+
+  model.a += k0 * e;
+  model.b += k1 * e;
+
+  // P = (P - k * phi' * P) / lambda; phi' * P equals (P * phi)' since P is symmetric.
+  // Skip the forgetting division when the covariance is already large to prevent wind-up.
+  float scale = (model.P[0][0] + model.P[1][1] > 2.0 * MODEL_INITIAL_COVARIANCE) ? 1.0 : 1.0 / MODEL_FORGETTING;
+  float n00 = (model.P[0][0] - k0 * p0) * scale;
+  float n01 = (model.P[0][1] - k0 * p1) * scale;
+  float n11 = (model.P[1][1] - k1 * p1) * scale;
+  model.P[0][0] = n00;
+  model.P[0][1] = n01;
+  model.P[1][0] = n01;
+  model.P[1][1] = n11;
+}
+
+/**
+ * Updates the thermal model with a new temperature sample and classifies disturbances.
+ *
+ * The one-step residual is computed against the current parameters before they are updated.
+ * A warming residual above MODEL_RESIDUAL_THRESHOLD standard deviations starts an excursion,
+ * during which parameter updates are frozen. If the residuals return to normal before
+ * MODEL_DOOR_RECOVERY_SEC, the excursion is reported as a door opening; otherwise an
+ * equipment failure is reported once, followed by a recovery event when it clears.
+ *
+ * @param model The thermal model of the sensor.
+ * @param tempC The new temperature sample in Celsius.
+ * @param dtSec The time since the previous sample in seconds.
+ * @return The event raised by this sample, or MODEL_EVENT_NONE.
+ */
+ModelEvent updateThermalModel(ThermalModel& model, float tempC, float dtSec) {
+  if (model.samples == 0 || fabsf(dtSec - model.dtSec) > 0.5 * model.dtSec) {
+    resetThermalModel(model, dtSec);
+    model.lastTemp = tempC;
+    model.samples = 1;
+    return MODEL_EVENT_NONE;
+  }
+
+  ModelEvent event = MODEL_EVENT_NONE;
+  float x = model.lastTemp;
+  float e = tempC - (model.a * x + model.b);
+  float sigma = sqrtf(model.residualVar);
+  if (sigma < MODEL_MIN_SIGMA) {
+    sigma = MODEL_MIN_SIGMA;
+  }
+  bool anomalous = (model.state != MODEL_LEARNING) && (e > MODEL_RESIDUAL_THRESHOLD * sigma);
+
+  model.residual = e;
+  model.samples++;
+
+  if (model.state == MODEL_EXCURSION) {
+    model.excursionSec += dtSec;
+    if (fabsf(e) <= MODEL_RESIDUAL_THRESHOLD * sigma) {
+      // The model predicts the sample again: the disturbance is over.
+      if (model.failureReported) {
+        event = MODEL_EVENT_RECOVERED;
+      }
+      else {
+        model.doorEvents++;
+        event = MODEL_EVENT_DOOR_OPEN;
+      }
+      model.state = MODEL_NORMAL;
+      model.excursionSec = 0.0;
+      model.failureReported = false;
+    }
+    else if (model.excursionSec > MODEL_DOOR_RECOVERY_SEC && !model.failureReported) {
+      model.failureEvents++;
+      model.failureReported = true;
+      event = MODEL_EVENT_EQUIPMENT_FAILURE;
+    }
+    model.lastTemp = tempC;
+    return event;
+  }
+
+  if (anomalous) {
+    model.state = MODEL_EXCURSION;
+    model.excursionSec = 0.0;
+    model.failureReported = false;
+    model.lastTemp = tempC;
+    return MODEL_EVENT_NONE;
+  }
+
+  thermalModelRls(model, x, tempC);
+  model.residualVar += 0.05 * (e * e - model.residualVar);
+  model.lastTemp = tempC;
+
+  if (model.state == MODEL_LEARNING) {
+    if (model.samples >= MODEL_WARMUP_SAMPLES) {
+      model.state = MODEL_NORMAL;
+    }
+    return MODEL_EVENT_NONE;
+  }
+
+  // Slow tracking of the time constant for insulation degradation.
+  float tau = thermalModelTau(model);
+  if (isnan(tau)) {
+    return MODEL_EVENT_NONE;
+  }
+  model.trackedSec += dtSec;
+  if (model.baselineTau <= 0.0) {
+    // Plain running mean until the baseline is captured, so early estimates do not dominate.
+    model.slowTau += (dtSec / model.trackedSec) * (tau - model.slowTau);
+    if (model.trackedSec >= MODEL_BASELINE_SEC) {
+      model.baselineTau = model.slowTau;
+    }
+    return MODEL_EVENT_NONE;
+  }
+  model.slowTau += (dtSec / MODEL_SLOW_TAU_WINDOW_SEC) * (tau - model.slowTau);
+
+  float limit = model.baselineTau * (1.0 - MODEL_DEGRADE_FRACTION);
+  if (!model.degraded && model.slowTau < limit) {
+    model.degraded = true;
+    event = MODEL_EVENT_INSULATION_DEGRADED;
+  }
+  else if (model.degraded && model.slowTau > limit + 0.5 * (model.baselineTau - limit)) {
+    model.degraded = false;
+    event = MODEL_EVENT_INSULATION_RESTORED;
+  }
+  return event;
+}
+
+#endif
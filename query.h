@@ -0,0 +1,306 @@
+/*
+  Header: query.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides time-bucketed aggregation of stored temperature samples for the
+  "/query" endpoint. Samples are fed in chronological order, one at a time, and each completed
+  bucket is handed back to the caller, so a query is evaluated in a single streaming pass in
+  constant memory regardless of the number of samples or buckets.
+
+  Buckets are aligned to the local wall clock: a "1d" bucket starts at local midnight and a
+  "15m" bucket starts at :00, :15, :30 and :45 local time, including across daylight saving changes.
+
+  Supported aggregations: avg, min, max, count, first, last.
+  Supported bucket sizes: a positive number followed by s, m, h or d (e.g. "15m", "1h", "1d").
+
+  Usage:
+  - Parse the request with parseQueryAgg() and parseQueryBucket(), then call beginQuery().
+  - Call queryAddSample() for each sample in time order; when it returns true, a bucket is complete.
+  - Call queryFinish() after the last sample to obtain the final partial bucket, if any.
+  - QueryStream holds the state of a streamed HTTP response; the firmware fills it from its history.
+
+  Notes:
+  - The module does not depend on Arduino types so it can also be compiled on a host.
+  - Local time is taken from the C library time zone, which configTime() sets on the ESP32.
+*/
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <time.h>
+#include <string.h>
+#include <stdlib.h>
+
+// Largest accepted bucket size in seconds.
+const long QUERY_MAX_BUCKET_SEC = 31L * 86400L;
+
+// Aggregation functions supported by the query endpoint.
+enum QueryAgg {
+  QUERY_AGG_INVALID,
+  QUERY_AGG_AVG,
+  QUERY_AGG_MIN,
+  QUERY_AGG_MAX,
+  QUERY_AGG_COUNT,
+  QUERY_AGG_FIRST,
+  QUERY_AGG_LAST
+};
+
+// A completed bucket.
+struct QueryBucket {
+  time_t start;         // Start of the bucket (seconds since the Unix epoch)
+  float value;          // Aggregated value
+  unsigned long count;  // Number of samples in the bucket
+};
+
+// Running state of a query, one bucket at a time.
+struct QueryState {
+  QueryAgg agg;
+  long bucketSec;
+  time_t from;          // Inclusive lower bound (0 for none)
+  time_t to;            // Exclusive upper bound (0 for none)
+  bool open;            // A bucket has received samples
+  long key;             // Local-time bucket number of the open bucket
+  time_t start;         // Start of the open bucket
+  double sum;
+  float min;
+  float max;
+  float first;
+  float last;
+  unsigned long count;
+};
+
+/**
+ * Streaming state of a "/query" response.
+ *
+ * The stored history is scanned once, oldest row first, and each completed bucket is formatted into
+ * a small pending buffer that is copied into the response chunks as the client reads them.
+ * The memory used by a query is constant, independent of the number of rows and buckets.
+ */
+struct QueryStream {
+  QueryState query;
+  int sensor;         // Sensor being queried
+  int oldest;         // Index of the oldest row when the query started
+  int rows;           // Number of rows when the query started
+  int row;            // Next row to scan
+  time_t lastEpoch;   // Time of the last scanned row, to skip rows overwritten during the scan
+  bool started;       // The opening bracket was produced
+  bool finished;      // The closing bracket was produced
+  bool firstBucket;   // No bucket was produced yet
+  char pending[128];  // Formatted output not yet copied into a chunk
+  size_t pendingLen;
+  size_t pendingPos;
+};
+
+/**
+ * Parses the "agg" query parameter.
+ *
+ * @param name The aggregation name.
+ * @return The aggregation, or QUERY_AGG_INVALID if the name is not supported.
+ */
+QueryAgg parseQueryAgg(const char* name) {
+  static const char* const names[] = { "avg", "min", "max", "count", "first", "last" };
+  static const QueryAgg aggs[] = { QUERY_AGG_AVG, QUERY_AGG_MIN, QUERY_AGG_MAX, QUERY_AGG_COUNT, QUERY_AGG_FIRST, QUERY_AGG_LAST };
+  for (int i = 0; i < 6; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      return aggs[i];
+    }
+  }
+  return QUERY_AGG_INVALID;
+}
+
+/**
+ * Parses the "bucket" query parameter.
+ *
+ * @param text A positive number followed by a unit of s, m, h or d (e.g. "15m").
+ * @return The bucket size in seconds, or 0 if the text is invalid or out of range.
+ */
+long parseQueryBucket(const char* text) {
+  char* unit;
+  long n = strtol(text, &unit, 10);
+  if (n <= 0 || unit == text) {
+    return 0;
+  }
+  long scale = 0;
+  if (strcmp(unit, "s") == 0) {
+    scale = 1;
+  }
+  else if (strcmp(unit, "m") == 0) {
+    scale = 60;
+  }
+  else if (strcmp(unit, "h") == 0) {
+    scale = 3600;
+  }
+  else if (strcmp(unit, "d") == 0) {
+    scale = 86400;
+  }
+  else {
+    return 0;
+  }
+  if (n > QUERY_MAX_BUCKET_SEC / scale) {
+    return 0;
+  }
+  return n * scale;
+}
+
+/**
+ * Returns the offset of local time from UTC, in seconds, at the given instant.
+ *
+ * @param t The instant in seconds since the Unix epoch.
+ * @return Local time minus UTC in seconds (e.g. -18000 for EST).
+ */
+long localUtcOffset(time_t t) {
+  struct tm lt;
+  struct tm gt;
+  localtime_r(&t, &lt);
+  gmtime_r(&t, &gt);
+  long offset = (lt.tm_hour - gt.tm_hour) * 3600L + (lt.tm_min - gt.tm_min) * 60L + (lt.tm_sec - gt.tm_sec);
+  if (lt.tm_year != gt.tm_year) {
+    offset += (lt.tm_year > gt.tm_year) ? 86400L : -86400L;
+  }
+  else {
+    offset += (lt.tm_yday - gt.tm_yday) * 86400L;
+  }
+  return offset;
+}
+
+/**
+ * Returns the instant at which the local wall clock shows a given time, as computed by mktime()
+ * in the local time zone. A time skipped by a daylight saving change is moved past the change.
+ *
+ * @param local The local wall-clock time, counted in seconds like a Unix time.
+ * @param notAfter An instant known to follow the local time; of the two instants of a time repeated
+ *                 when daylight saving ends, the earlier one is used if the later one is after it.
+ * @return The instant in seconds since the Unix epoch.
+ */
+time_t localTimeToUtc(long long local, time_t notAfter) {
+  time_t wall = (time_t)local;
+  struct tm fields;
+  gmtime_r(&wall, &fields);
+  struct tm guess = fields;
+  guess.tm_isdst = -1;
+  time_t t = mktime(&guess);
+  if (t > notAfter) {
+    fields.tm_isdst = 1;
+    t = mktime(&fields);
+  }
+  return t;
+}
+
+/**
+ * Initializes a query.
+ *
+ * @param q The query state.
+ * @param agg The aggregation function.
+ * @param bucketSec The bucket size in seconds.
+ * @param from Inclusive lower time bound, or 0 for none.
+ * @param to Exclusive upper time bound, or 0 for none.
+ */
+void beginQuery(QueryState& q, QueryAgg agg, long bucketSec, time_t from, time_t to) {
+  memset(&q, 0, sizeof(q));
+  q.agg = agg;
+  q.bucketSec = bucketSec;
+  q.from = from;
+  q.to = to;
+}
+
+/**
+ * Closes the open bucket into 'out'.
+ */
+void queryCloseBucket(QueryState& q, QueryBucket& out) {
+  out.start = q.start;
+  out.count = q.count;
+  switch (q.agg) {
+  case QUERY_AGG_MIN:
+    out.value = q.min;
+    break;
+  case QUERY_AGG_MAX:
+    out.value = q.max;
+    break;
+  case QUERY_AGG_COUNT:
+    out.value = q.count;
+    break;
+  case QUERY_AGG_FIRST:
+    out.value = q.first;
+    break;
+  case QUERY_AGG_LAST:
+    out.value = q.last;
+    break;
+  default:
+    out.value = q.sum / q.count;
+    break;
+  }
+  q.open = false;
+}
+
+/**
+ * Adds a sample to the query.
+ *
+ * Samples outside the [from, to) range are ignored. When the sample falls in a later bucket
+ * than the open one, the open bucket is completed into 'out' before the sample is added.
+ *
+ * @param q The query state.
+ * @param t The time of the sample in seconds since the Unix epoch.
+ * @param value The sample value.
+ * @param out Receives the completed bucket when the function returns true.
+ * @return True if a bucket was completed.
+ */
+bool queryAddSample(QueryState& q, time_t t, float value, QueryBucket& out) {
+  if ((q.from != 0 && t < q.from) || (q.to != 0 && t >= q.to)) {
+    return false;
+  }
+
+  long offset = localUtcOffset(t);
+  long long local = (long long)t + offset;
+  long key = (long)(local / q.bucketSec);
+  if (local < 0 && local % q.bucketSec != 0) {
+    key--;
+  }
+
+  bool completed = false;
+  if (q.open && key != q.key) {
+    queryCloseBucket(q, out);
+    completed = true;
+  }
+
+  if (!q.open) {
+    q.open = true;
+    q.key = key;
+    // The offset at the bucket boundary may differ from the sample's across a daylight saving change.
+    q.start = localTimeToUtc((long long)key * q.bucketSec, t);
+    q.sum = 0.0;
+    q.min = value;
+    q.max = value;
+    q.first = value;
+    q.count = 0;
+  }
+  q.sum += value;
+  if (value < q.min) {
+    q.min = value;
+  }
+  if (value > q.max) {
+    q.max = value;
+  }
+  q.last = value;
+  q.count++;
+  return completed;
+}
+
+/**
+ * Completes the query.
+ *
+ * @param q The query state.
+ * @param out Receives the final bucket when the function returns true.
+ * @return True if a partially filled bucket remained open.
+ */
+bool queryFinish(QueryState& q, QueryBucket& out) {
+  if (!q.open) {
+    return false;
+  }
+  queryCloseBucket(q, out);
+  return true;
+}
+
+#endif
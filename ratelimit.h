@@ -0,0 +1,215 @@
+/*
+  Header: ratelimit.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the per-client rate limiting of the web server. Each source IP address
+  has a token bucket per route class (static pages, data, settings): a request takes one token,
+  and tokens are refilled at a steady rate up to a burst size. A client without a token is refused
+  before any response is built, so a scraper polling in a tight loop costs one lookup per request
+  instead of a response, and cannot starve the sampling or the other clients.
+
+  The clients are kept in a small fixed-size table; when it is full, the least recently seen client
+  is evicted, and starts again with full buckets if it returns.
+
+  Usage:
+  - Call takeRateToken() for each request; a non-zero result is the time until the client may retry.
+  - Call rateRetryAfterMs() to compute the Retry-After of a refused request again later.
+
+  Notes:
+  - The limiter is used by the web server task only, so it needs no locking.
+  - The module does not depend on Arduino types, so it can be compiled on a host.
+*/
+
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Clients tracked at once; may be set as a build flag.
+#ifndef RATE_LIMIT_CLIENTS
+#define RATE_LIMIT_CLIENTS 16
+#endif
+
+// Route classes, each with its own bucket.
+enum RateClass {
+  RATE_STATIC,    // Pages ("/")
+  RATE_DATA,      // Readings, statistics and exports
+  RATE_SETTINGS,  // Requests that change the configuration
+  RATE_CLASS_COUNT
+};
+
+// Limit of a route class: a burst of requests, then a steady rate.
+struct RateLimit {
+  uint16_t burst;       // Bucket size, in requests
+  uint16_t perMinute;   // Refill rate, in requests per minute
+};
+
+// Limits of each route class. The dashboard makes 4 data requests when loaded and about 6 a
+// minute after that; a Prometheus scrape every 15 seconds makes 4 a minute.
+const RateLimit RATE_LIMITS[RATE_CLASS_COUNT] = {
+  { 30, 60 },           // RATE_STATIC
+  { 20, 60 },           // RATE_DATA
+  { 10, 12 }            // RATE_SETTINGS
+};
+
+// Token bucket of a client for one route class.
+struct RateBucket {
+  uint32_t milliTokens; // Tokens left, in thousandths
+  uint32_t lastMs;      // Time the bucket was last refilled
+};
+
+// A client, identified by its source IP address.
+struct RateClient {
+  bool used;
+  uint32_t ip;
+  uint32_t lastSeenMs;  // Time of the client's last request, for the eviction
+  RateBucket buckets[RATE_CLASS_COUNT];
+};
+
+// Table of clients and counters.
+struct RateLimiter {
+  RateClient clients[RATE_LIMIT_CLIENTS];
+  uint32_t allowed;                     // Requests allowed
+  uint32_t limited[RATE_CLASS_COUNT];   // Requests refused, per route class
+  uint32_t evictions;                   // Clients evicted to make room for another
+};
+
+/**
+ * Returns the name of a route class.
+ */
+const char* rateClassName(RateClass cls) {
+  switch (cls) {
+    case RATE_STATIC:
+      return "static";
+    case RATE_DATA:
+      return "data";
+    case RATE_SETTINGS:
+      return "settings";
+    default:
+      return "unknown";
+  }
+}
+
+/**
+ * Finds the entry of a client, or nullptr if it is not tracked.
+ */
+RateClient* findRateClient(RateLimiter& limiter, uint32_t ip) {
+  for (int i = 0; i < RATE_LIMIT_CLIENTS; i++) {
+    if (limiter.clients[i].used && limiter.clients[i].ip == ip) {
+      return &limiter.clients[i];
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Returns the entry of a client, taking a free entry or evicting the least recently seen client
+ * if it is not tracked yet. A new client starts with full buckets.
+ */
+RateClient& trackRateClient(RateLimiter& limiter, uint32_t ip, uint32_t nowMs) {
+  RateClient* client = findRateClient(limiter, ip);
+  if (client != nullptr) {
+    return *client;
+  }
+  client = &limiter.clients[0];
+  for (int i = 0; i < RATE_LIMIT_CLIENTS; i++) {
+    RateClient& candidate = limiter.clients[i];
+    if (!candidate.used) {
+      client = &candidate;
+      break;
+    }
+    if (nowMs - candidate.lastSeenMs > nowMs - client->lastSeenMs) {
+      client = &candidate;
+    }
+  }
+  if (client->used) {
+    limiter.evictions++;
+  }
+  client->used = true;
+  client->ip = ip;
+  client->lastSeenMs = nowMs;
+  for (int c = 0; c < RATE_CLASS_COUNT; c++) {
+    client->buckets[c].milliTokens = RATE_LIMITS[c].burst * 1000UL;
+    client->buckets[c].lastMs = nowMs;
+  }
+  return *client;
+}
+
+/**
+ * Refills a bucket for the time elapsed since its last refill.
+ */
+void refillRateBucket(RateBucket& bucket, const RateLimit& limit, uint32_t nowMs) {
+  uint32_t capacity = limit.burst * 1000UL;
+  uint32_t gained = (uint32_t)((uint64_t)(nowMs - bucket.lastMs) * limit.perMinute / 60);
+  if (bucket.milliTokens + gained >= capacity) {
+    bucket.milliTokens = capacity;
+    bucket.lastMs = nowMs;
+    return;
+  }
+  if (gained > 0) {
+    bucket.milliTokens += gained;
+    bucket.lastMs += (uint32_t)((uint64_t)gained * 60 / limit.perMinute);
+  }
+}
+
+/**
+ * Returns the time until a bucket holds a whole token, in milliseconds.
+ */
+uint32_t rateBucketWaitMs(const RateBucket& bucket, const RateLimit& limit) {
+  if (bucket.milliTokens >= 1000) {
+    return 0;
+  }
+  return ((1000 - bucket.milliTokens) * 60 + limit.perMinute - 1) / limit.perMinute;
+}
+
+/**
+ * Takes a token for a request of a client.
+ *
+ * @param limiter The rate limiter.
+ * @param ip The client's IP address.
+ * @param cls The route class of the request.
+ * @param nowMs The current time in milliseconds.
+ * @return 0 if the request is allowed, or the time in milliseconds until the client has a token.
+ */
+uint32_t takeRateToken(RateLimiter& limiter, uint32_t ip, RateClass cls, uint32_t nowMs) {
+  RateClient& client = trackRateClient(limiter, ip, nowMs);
+  client.lastSeenMs = nowMs;
+  RateBucket& bucket = client.buckets[cls];
+  refillRateBucket(bucket, RATE_LIMITS[cls], nowMs);
+  if (bucket.milliTokens >= 1000) {
+    bucket.milliTokens -= 1000;
+    limiter.allowed++;
+    return 0;
+  }
+  limiter.limited[cls]++;
+  return rateBucketWaitMs(bucket, RATE_LIMITS[cls]);
+}
+
+/**
+ * Returns the time until a client has a token for a route class, without taking one.
+ */
+uint32_t rateRetryAfterMs(RateLimiter& limiter, uint32_t ip, RateClass cls, uint32_t nowMs) {
+  RateClient* client = findRateClient(limiter, ip);
+  if (client == nullptr) {
+    return 0;
+  }
+  refillRateBucket(client->buckets[cls], RATE_LIMITS[cls], nowMs);
+  return rateBucketWaitMs(client->buckets[cls], RATE_LIMITS[cls]);
+}
+
+/**
+ * Returns the number of clients tracked.
+ */
+int rateClientCount(const RateLimiter& limiter) {
+  int count = 0;
+  for (int i = 0; i < RATE_LIMIT_CLIENTS; i++) {
+    count += limiter.clients[i].used ? 1 : 0;
+  }
+  return count;
+}
+
+#endif
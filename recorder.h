@@ -0,0 +1,186 @@
+/*
+  Header: recorder.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the alert flight recorder. All sensors are recorded every
+  RECORDER_INTERVAL_MS into a small circular pre-trigger buffer that always holds the last
+  RECORDER_PRE_ROWS readings. When an alert is raised, the buffer of the alerting sensor is
+  frozen into a snapshot, which then keeps recording for RECORDER_POST_ROWS more readings, so
+  each snapshot holds the window around the alert (10 minutes before and after by default) at a
+  much higher resolution than the regular history.
+
+  The last RECORDER_SNAPSHOTS snapshots are retained. Each has an id, which the alert webhook
+  links to, and can be downloaded afterwards.
+
+  Usage:
+  - In the main loop, when recorderDue() returns true, read the sensors and pass their readings
+    to recordRecorderRow().
+  - Call triggerSnapshot() when an alert is raised and report the returned id.
+  - Look snapshots up with findSnapshot().
+
+  Notes:
+  - The module does not depend on Arduino types so it can also be compiled on a host.
+  - Each recorder reading is a blocking conversion of the 1-Wire buses of the recorded probes (up
+    to 750 ms at 12 bits, the buses in parallel), so the default interval keeps the main loop
+    converting up to 7.5% of the time. Build with -DRECORDER_INTERVAL_MS=<ms> to read less often,
+    with -DRECORDER_SENSOR_MASK=<mask> to read only some probes, or with -DRECORDER_INTERVAL_MS=0
+    to take no readings of its own and record the scheduled samples instead.
+  - A new snapshot replaces the oldest retained one, preferring completed snapshots.
+*/
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+// Interval of the recorder readings in milliseconds; 0 records the scheduled samples instead.
+#ifndef RECORDER_INTERVAL_MS
+#define RECORDER_INTERVAL_MS 10000
+#endif
+
+// Physical sensors read by the recorder, bit N for sensor N; the others are recorded with their
+// last reading.
+#ifndef RECORDER_SENSOR_MASK
+#define RECORDER_SENSOR_MASK 0xFFFF
+#endif
+
+// Readings kept before and recorded after a trigger: 10 minutes each.
+const int RECORDER_PRE_ROWS = 60;
+const int RECORDER_POST_ROWS = 60;
+
+// Number of retained snapshots.
+const int RECORDER_SNAPSHOTS = 8;
+
+// Number of sensors recorded (MAX_SENSORS).
+const int RECORDER_MAX_SENSORS = 8;
+
+// Circular pre-trigger buffer of all sensors.
+struct RecorderRing {
+  uint32_t epochs[RECORDER_PRE_ROWS];
+  int16_t centiC[RECORDER_MAX_SENSORS][RECORDER_PRE_ROWS];
+  int index;                  // Next row to write
+  int count;                  // Rows in the buffer
+  unsigned long nextMs;       // Time of the next reading
+};
+
+// Window of readings of one sensor around an alert.
+struct Snapshot {
+  uint32_t id;                // 0 for an unused slot
+  int sensor;
+  uint32_t triggerEpoch;      // Time of the alert
+  int16_t triggerCentiC;      // Reading that raised the alert
+  int preRows;                // Rows recorded before the trigger
+  int rows;                   // Rows recorded in total
+  bool complete;              // All post-trigger rows were recorded
+  uint32_t epochs[RECORDER_PRE_ROWS + RECORDER_POST_ROWS];
+  int16_t centiC[RECORDER_PRE_ROWS + RECORDER_POST_ROWS];
+};
+
+RecorderRing recorderRing;
+Snapshot snapshots[RECORDER_SNAPSHOTS];
+
+// Id of the next snapshot.
+uint32_t nextSnapshotId = 1;
+
+/**
+ * Returns whether a recorder reading is due, and schedules the next one. Never true when the
+ * recorder records the scheduled samples.
+ */
+bool recorderDue(unsigned long nowMs) {
+  if (RECORDER_INTERVAL_MS == 0 || (long)(nowMs - recorderRing.nextMs) < 0) {
+    return false;
+  }
+  recorderRing.nextMs = nowMs + RECORDER_INTERVAL_MS;
+  return true;
+}
+
+/**
+ * Records a reading of all sensors in the pre-trigger buffer and in the snapshots still
+ * recording their post-trigger window.
+ *
+ * @param epoch The time of the readings in seconds since the Unix epoch, or 0 if unknown.
+ * @param centiC The reading of every sensor, indexed by sensor.
+ */
+void recordRecorderRow(uint32_t epoch, const int16_t* centiC) {
+  RecorderRing& ring = recorderRing;
+  ring.epochs[ring.index] = epoch;
+  for (int s = 0; s < RECORDER_MAX_SENSORS; s++) {
+    ring.centiC[s][ring.index] = centiC[s];
+  }
+  ring.index = (ring.index + 1) % RECORDER_PRE_ROWS;
+  if (ring.count < RECORDER_PRE_ROWS) {
+    ring.count++;
+  }
+
+  for (int i = 0; i < RECORDER_SNAPSHOTS; i++) {
+    Snapshot& snapshot = snapshots[i];
+    if (snapshot.id == 0 || snapshot.complete) {
+      continue;
+    }
+    snapshot.epochs[snapshot.rows] = epoch;
+    snapshot.centiC[snapshot.rows] = centiC[snapshot.sensor];
+    snapshot.rows++;
+    if (snapshot.rows - snapshot.preRows >= RECORDER_POST_ROWS) {
+      snapshot.complete = true;
+    }
+  }
+}
+
+/**
+ * Freezes the pre-trigger readings of a sensor into a new snapshot.
+ *
+ * @param sensor The alerting sensor.
+ * @param epoch The time of the alert.
+ * @param centiC The reading that raised the alert.
+ * @return The id of the snapshot.
+ */
+uint32_t triggerSnapshot(int sensor, uint32_t epoch, int16_t centiC) {
+  int slot = 0;
+  for (int i = 1; i < RECORDER_SNAPSHOTS; i++) {
+    const Snapshot& best = snapshots[slot];
+    const Snapshot& candidate = snapshots[i];
+    if (best.id == 0) {
+      break;
+    }
+    if (candidate.id == 0 || (candidate.complete && !best.complete) || (candidate.complete == best.complete && candidate.id < best.id)) {
+      slot = i;
+    }
+  }
+
+  Snapshot& snapshot = snapshots[slot];
+  const RecorderRing& ring = recorderRing;
+  snapshot.id = 0;
+  snapshot.sensor = sensor;
+  snapshot.triggerEpoch = epoch;
+  snapshot.triggerCentiC = centiC;
+  int oldest = (ring.index - ring.count + RECORDER_PRE_ROWS) % RECORDER_PRE_ROWS;
+  for (int n = 0; n < ring.count; n++) {
+    int row = (oldest + n) % RECORDER_PRE_ROWS;
+    snapshot.epochs[n] = ring.epochs[row];
+    snapshot.centiC[n] = ring.centiC[sensor][row];
+  }
+  snapshot.preRows = ring.count;
+  snapshot.rows = ring.count;
+  snapshot.complete = false;
+  snapshot.id = nextSnapshotId++;
+  return snapshot.id;
+}
+
+/**
+ * Returns the retained snapshot with an id, or nullptr if it was replaced or never existed.
+ */
+const Snapshot* findSnapshot(uint32_t id) {
+  for (int i = 0; i < RECORDER_SNAPSHOTS; i++) {
+    if (id != 0 && snapshots[i].id == id) {
+      return &snapshots[i];
+    }
+  }
+  return nullptr;
+}
+
+#endif
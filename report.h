@@ -0,0 +1,352 @@
+/*
+  Header: report.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides the daily compliance report: for each sensor, the minimum, maximum
+  and mean temperature of a local day, its mean kinetic temperature (MKT), the minutes spent
+  below and above its thresholds and an hourly rollup, with the list of the alerts raised.
+
+  The report is accumulated sample by sample during the day, so closing it at midnight only
+  divides a few sums; it is then stored once and served as is.
+
+  - Minutes out of range are time weighted: a reading holds until the next sample of the sensor
+    (at most REPORT_MAX_GAP_SEC), and the day is closed at its end, so the minutes add up to the
+    time actually spent out of range whatever the sampling interval.
+  - The MKT follows USP <1160> with an activation energy of 83.144 kJ/mol:
+      MKT = (dH/R) / -ln(sum(exp(-dH/(R*T))) / n), dH/R = 10000 K, T in kelvin.
+  - An alert ends with the first valid reading back in range. An alert still open at midnight is
+    listed as open in that day and carried over to the next one.
+
+  Usage:
+  - Call startReportDay() with the local date when the clock is first known.
+  - Call recordReportSample() for each sensor sample, and recordReportAlert() for each raised alert.
+  - When the local date changes, call closeReportDay() to produce the report of the day, then
+    startReportDay() for the new one.
+
+  Notes:
+  - The module does not depend on Arduino types, so it can be compiled on a host.
+*/
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Number of sensors (MAX_SENSORS).
+const int REPORT_MAX_SENSORS = 8;
+
+// Daily reports kept in NVS. Each takes about 1.6 kB, so 3 days fit in the default 20 kB NVS
+// partition next to the other settings; may be set as a build flag on larger partitions.
+#ifndef REPORT_DAYS
+#define REPORT_DAYS 3
+#endif
+
+// Alerts listed in a report; further alerts are only counted.
+const int REPORT_MAX_ALERTS = 16;
+
+// Interval at which the main loop checks for the end of the day.
+const unsigned long REPORT_CHECK_MS = 10000;
+
+// Longest time a reading is held to count minutes out of range.
+const uint32_t REPORT_MAX_GAP_SEC = 3600;
+
+// Activation energy over the gas constant for the MKT, in kelvin (83.144 kJ/mol / 8.3144 J/mol/K).
+const double REPORT_MKT_DH_OVER_R = 10000.0;
+
+// NVS namespace of the reports (keys "day0" to "day<REPORT_DAYS - 1>") and of the push setting.
+const char* REPORT_NVS_NAMESPACE = "reports";
+const char* REPORT_NVS_PUSH_KEY = "push";
+
+// Hourly rollup of a sensor, in hundredths of a degree; invalid without a reading in the hour.
+struct ReportHour {
+  int16_t minCentiC;
+  int16_t maxCentiC;
+  int16_t meanCentiC;
+};
+
+// Summary of a sensor over a day, in hundredths of a degree.
+struct ReportSensor {
+  uint8_t used;               // The sensor was sampled during the day
+  uint8_t reserved;
+  int16_t minCentiC;          // Invalid without a valid reading
+  int16_t maxCentiC;
+  int16_t meanCentiC;
+  int16_t mktCentiC;
+  int16_t lowCentiC;          // Thresholds at the last sample of the day
+  int16_t highCentiC;
+  uint16_t samples;           // Readings, valid or not
+  uint16_t invalid;           // Readings that returned no temperature
+  uint16_t minutesBelow;      // Minutes below the minimum temperature
+  uint16_t minutesAbove;      // Minutes above the maximum temperature
+  ReportHour hours[24];
+};
+
+// An alert raised during or before a day.
+struct ReportAlert {
+  uint32_t id;
+  uint32_t startEpoch;
+  uint32_t endEpoch;          // 0 while the alert is open
+  uint8_t sensor;
+  uint8_t reserved[3];
+};
+
+// The report of a day, as stored in NVS.
+struct DailyReport {
+  uint32_t date;              // Local date as YYYYMMDD, 0 for an unused slot
+  uint32_t firstEpoch;        // First sample of the day
+  uint32_t lastEpoch;         // Close of the day
+  uint16_t alertCount;        // Alerts in 'alerts'
+  uint16_t droppedAlerts;     // Alerts beyond REPORT_MAX_ALERTS
+  ReportSensor sensors[REPORT_MAX_SENSORS];
+  ReportAlert alerts[REPORT_MAX_ALERTS];
+};
+
+// Running sums of a sensor over the current day.
+struct ReportSensorSums {
+  uint32_t samples;
+  uint32_t invalid;
+  int64_t sumCentiC;          // Sums and counts are wide enough for a day at any sampling rate
+  int16_t minCentiC;
+  int16_t maxCentiC;
+  double mktSum;              // Sum of exp(-dH/(R*T)) of the valid readings
+  uint32_t secondsBelow;
+  uint32_t secondsAbove;
+  int16_t lowCentiC;
+  int16_t highCentiC;
+  int64_t hourSum[24];
+  uint32_t hourCount[24];
+  int16_t hourMin[24];
+  int16_t hourMax[24];
+  // Kept across days.
+  uint32_t heldEpoch;         // Time up to which the last reading was counted
+  int8_t heldRange;           // -1 below, 1 above, 0 in range or invalid
+};
+
+// Accumulator of the current day, owned by the main loop.
+struct ReportAccumulator {
+  uint32_t date;              // Local date as YYYYMMDD, 0 before the clock is known
+  uint32_t firstEpoch;
+  uint16_t alertCount;
+  uint16_t droppedAlerts;
+  ReportSensorSums sensors[REPORT_MAX_SENSORS];
+  ReportAlert alerts[REPORT_MAX_ALERTS];
+};
+
+/**
+ * Clears the sums of a sensor for a new day, keeping the reading being held.
+ */
+void clearReportSums(ReportSensorSums& s, int16_t invalid) {
+  uint32_t heldEpoch = s.heldEpoch;
+  int8_t heldRange = s.heldRange;
+  memset(&s, 0, sizeof(s));
+  s.minCentiC = invalid;
+  s.maxCentiC = invalid;
+  for (int h = 0; h < 24; h++) {
+    s.hourMin[h] = invalid;
+    s.hourMax[h] = invalid;
+  }
+  s.heldEpoch = heldEpoch;
+  s.heldRange = heldRange;
+}
+
+/**
+ * Starts the accumulation of a day. Alerts still open are carried over from the previous day.
+ *
+ * @param acc The accumulator.
+ * @param date The local date as YYYYMMDD.
+ * @param invalid The value of an invalid reading.
+ */
+void startReportDay(ReportAccumulator& acc, uint32_t date, int16_t invalid) {
+  acc.date = date;
+  acc.firstEpoch = 0;
+  for (int s = 0; s < REPORT_MAX_SENSORS; s++) {
+    clearReportSums(acc.sensors[s], invalid);
+  }
+  int open = 0;
+  for (int a = 0; a < acc.alertCount; a++) {
+    if (acc.alerts[a].endEpoch == 0) {
+      acc.alerts[open++] = acc.alerts[a];
+    }
+  }
+  acc.alertCount = open;
+  acc.droppedAlerts = 0;
+}
+
+/**
+ * Counts the time a sensor's last reading was held out of range, up to a time.
+ */
+void holdReportReading(ReportSensorSums& s, uint32_t epoch) {
+  if (s.heldEpoch == 0 || epoch <= s.heldEpoch) {
+    return;
+  }
+  uint32_t held = epoch - s.heldEpoch;
+  if (held > REPORT_MAX_GAP_SEC) {
+    held = REPORT_MAX_GAP_SEC;
+  }
+  if (s.heldRange < 0) {
+    s.secondsBelow += held;
+  }
+  else if (s.heldRange > 0) {
+    s.secondsAbove += held;
+  }
+  s.heldEpoch = epoch;
+}
+
+/**
+ * Adds a sample of a sensor to the current day.
+ *
+ * @param acc The accumulator.
+ * @param sensor The sensor.
+ * @param centiC The reading in hundredths of a degree.
+ * @param lowCentiC The minimum temperature of the sensor.
+ * @param highCentiC The maximum temperature of the sensor.
+ * @param epoch The time of the sample.
+ * @param hour The local hour of the sample.
+ * @param invalid The value of an invalid reading.
+ */
+void recordReportSample(ReportAccumulator& acc, int sensor, int16_t centiC, int16_t lowCentiC, int16_t highCentiC, uint32_t epoch, int hour, int16_t invalid) {
+  if (acc.date == 0 || sensor < 0 || sensor >= REPORT_MAX_SENSORS || hour < 0 || hour > 23) {
+    return;
+  }
+  if (acc.firstEpoch == 0) {
+    acc.firstEpoch = epoch;
+  }
+  ReportSensorSums& s = acc.sensors[sensor];
+  holdReportReading(s, epoch);
+  s.heldEpoch = epoch;
+  s.samples++;
+  s.lowCentiC = lowCentiC;
+  s.highCentiC = highCentiC;
+  if (centiC == invalid) {
+    s.invalid++;
+    s.heldRange = 0;
+    return;
+  }
+  s.heldRange = centiC < lowCentiC ? -1 : (centiC > highCentiC ? 1 : 0);
+  s.sumCentiC += centiC;
+  s.mktSum += exp(-REPORT_MKT_DH_OVER_R / (centiC / 100.0 + 273.15));
+  if (s.minCentiC == invalid || centiC < s.minCentiC) {
+    s.minCentiC = centiC;
+  }
+  if (s.maxCentiC == invalid || centiC > s.maxCentiC) {
+    s.maxCentiC = centiC;
+  }
+  s.hourSum[hour] += centiC;
+  s.hourCount[hour]++;
+  if (s.hourMin[hour] == invalid || centiC < s.hourMin[hour]) {
+    s.hourMin[hour] = centiC;
+  }
+  if (s.hourMax[hour] == invalid || centiC > s.hourMax[hour]) {
+    s.hourMax[hour] = centiC;
+  }
+
+  if (s.heldRange == 0) {
+    for (int a = 0; a < acc.alertCount; a++) {
+      if (acc.alerts[a].sensor == sensor && acc.alerts[a].endEpoch == 0) {
+        acc.alerts[a].endEpoch = epoch;
+      }
+    }
+  }
+}
+
+/**
+ * Adds a raised alert to the current day.
+ */
+void recordReportAlert(ReportAccumulator& acc, uint32_t id, int sensor, uint32_t startEpoch) {
+  if (acc.date == 0) {
+    return;
+  }
+  if (acc.alertCount >= REPORT_MAX_ALERTS) {
+    acc.droppedAlerts++;
+    return;
+  }
+  ReportAlert& alert = acc.alerts[acc.alertCount++];
+  memset(&alert, 0, sizeof(alert));
+  alert.id = id;
+  alert.sensor = sensor;
+  alert.startEpoch = startEpoch;
+}
+
+/**
+ * Divides a sum by a count, rounded to the nearest.
+ */
+int16_t reportMean(int64_t sum, uint32_t count) {
+  return (int16_t)lround((double)sum / count);
+}
+
+/**
+ * Closes the current day into its report.
+ *
+ * @param acc The accumulator; start the next day with startReportDay() afterwards.
+ * @param report Receives the report.
+ * @param epoch The end of the day, up to which the last readings are held.
+ * @param invalid The value of an invalid reading.
+ */
+void closeReportDay(ReportAccumulator& acc, DailyReport& report, uint32_t epoch, int16_t invalid) {
+  memset(&report, 0, sizeof(report));
+  report.date = acc.date;
+  report.firstEpoch = acc.firstEpoch;
+  report.lastEpoch = epoch;
+  for (int i = 0; i < REPORT_MAX_SENSORS; i++) {
+    ReportSensorSums& s = acc.sensors[i];
+    ReportSensor& r = report.sensors[i];
+    holdReportReading(s, epoch);
+    uint32_t valid = s.samples - s.invalid;
+    r.used = s.samples > 0;
+    r.samples = s.samples > 0xFFFF ? 0xFFFF : s.samples;
+    r.invalid = s.invalid > 0xFFFF ? 0xFFFF : s.invalid;
+    r.minCentiC = s.minCentiC;
+    r.maxCentiC = s.maxCentiC;
+    r.meanCentiC = valid > 0 ? reportMean(s.sumCentiC, valid) : invalid;
+    r.mktCentiC = valid > 0 ? (int16_t)lround((REPORT_MKT_DH_OVER_R / -log(s.mktSum / valid) - 273.15) * 100.0) : invalid;
+    r.lowCentiC = s.lowCentiC;
+    r.highCentiC = s.highCentiC;
+    r.minutesBelow = (s.secondsBelow + 30) / 60;
+    r.minutesAbove = (s.secondsAbove + 30) / 60;
+    for (int h = 0; h < 24; h++) {
+      r.hours[h].minCentiC = s.hourMin[h];
+      r.hours[h].maxCentiC = s.hourMax[h];
+      r.hours[h].meanCentiC = s.hourCount[h] > 0 ? reportMean(s.hourSum[h], s.hourCount[h]) : invalid;
+    }
+  }
+  report.alertCount = acc.alertCount;
+  report.droppedAlerts = acc.droppedAlerts;
+  memcpy(report.alerts, acc.alerts, sizeof(report.alerts));
+}
+
+/**
+ * Returns the slot of the report of a date among stored dates, or -1 if it is not stored.
+ */
+int findReportSlot(const uint32_t dates[REPORT_DAYS], uint32_t date) {
+  for (int i = 0; i < REPORT_DAYS; i++) {
+    if (date != 0 && dates[i] == date) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Returns the slot a new report is stored in: the slot of the same date, an unused slot, or the
+ * slot of the oldest report.
+ */
+int reportSlotFor(const uint32_t dates[REPORT_DAYS], uint32_t date) {
+  int slot = findReportSlot(dates, date);
+  if (slot >= 0) {
+    return slot;
+  }
+  slot = 0;
+  for (int i = 1; i < REPORT_DAYS; i++) {
+    if (dates[i] < dates[slot]) {
+      slot = i;
+    }
+  }
+  return slot;
+}
+
+#endif
@@ -5,34 +5,28 @@
   Last Updated: January 18th, 2024
 
   Description:
-  This header file provides functionality for interfacing with a DS18B20 temperature sensor
-  using the OneWire and DallasTemperature libraries. It includes constants, variables, data structures,
-  an array for storing temperature data, and functions for reading temperature values.
-
-  Includes:
-  - OneWire: Library for communication with 1-wire devices, such as the DS18B20 temperature sensor.
-  - DallasTemperature: Library for the DS18B20 temperature sensor.
+  This header file provides functionality for reading the temperature sensors through the
+  sensor drivers of drivers.h (DS18B20 probes, SHT3x sensors and synthetic channels). It includes
+  constants, variables, data structures, the sensor table (physical probes and virtual sensors),
+  an array for storing temperature data, functions for reading temperature values, and the
+  latency statistics of the sample pipeline under synthetic load.
 
   Usage:
   - Include this header file in your main Arduino sketch to access temperature-related functionality.
   - Adjust MAX_TEMP and MIN_TEMP for initial temperature alert thresholds.
+  - Include expr.h, vote.h, calib.h and drivers.h before this header; virtual sensors, sensor
+    groups, probe calibration and sampling are built on them.
 
   Notes:
-  - Ensure proper wiring of the DS18B20 sensor to the specified pin (ONE_WIRE_BUS).
-  - Calibration may be required for accurate temperature readings.
+  - Ensure proper wiring of the DS18B20 sensors to the specified pins (ONE_WIRE_PINS in drivers.h).
+  - Calibration may be required for accurate temperature readings; see calib.h.
 */
 
 #ifndef TEMPER_H
 #define TEMPER_H
 
-// Define the GPIO pin number for the OneWire data bus (used for DS18B20 temperature sensor).
-#define ONE_WIRE_BUS 4
-
-// Create an instance of the OneWire object to communicate with OneWire devices.
-OneWire oneWire(ONE_WIRE_BUS);
-
-// Create an instance of the DallasTemperature library to interface with DS18B20 sensors.
-DallasTemperature sensors(&oneWire);
+// Duration of the last readSensors() call in milliseconds, conversion included.
+unsigned long lastSampleMs = 0;
 
 // Maximum temperature threshold for alerting (in Celsius).
 float MAX_TEMP = 25.0;
@@ -45,68 +39,1031 @@ String temperatureF = ""; // Fahrenheit
 String temperatureC = ""; // Celsius
 String currentTime = "";  // Current time when the reading was taken
 
-// Structure to store temperature data (Celsius, Fahrenheit) and the corresponding time.
-struct TemperatureData {
-  String temperatureC;    // Temperature in Celsius
-  String temperatureF;    // Temperature in Fahrenheit
-  String currentTime;     // Time of the temperature reading
+// Maximum number of sensors (physical probes and virtual sensors) tracked by the firmware.
+const int MAX_SENSORS = 8;
+
+// Value stored in place of a reading when the sensor did not return a valid temperature.
+const int16_t TEMP_INVALID = INT16_MIN;
+
+// Readings taken before the clock was synchronized are stored with an epoch of 0.
+// Any time before January 1st, 2020 is treated as unsynchronized.
+const time_t MIN_VALID_EPOCH = 1577836800;
+
+// Maximum length of a sensor name, including the terminator.
+const int SENSOR_NAME_LEN = 16;
+
+// Maximum length of a virtual sensor expression, including the terminator.
+const int SENSOR_EXPR_LEN = 64;
+
+// Kind of sensor occupying a slot of the sensorTable.
+enum SensorKind {
+  SENSOR_NONE,      // Slot unused
+  SENSOR_PHYSICAL,  // Channel of a sensor driver (e.g. a DS18B20 probe)
+  SENSOR_VIRTUAL,   // Value derived from other sensors by an expression
+  SENSOR_GROUP      // Median or voted value of redundant physical probes
+};
+
+// Structure describing one sensor slot. The slot index identifies the sensor in the
+// history, the alerts, the web API and the webhook payloads.
+struct SensorInfo {
+  SensorKind kind;
+  uint8_t driver;               // Driver of a physical sensor (DriverId)
+  uint8_t channel;              // Channel of a physical sensor within its driver
+  DeviceAddress rom;            // ROM address (or driver channel id) of a physical sensor
+  int8_t calibration;           // Index of the probe's entry in 'calibrations', or -1 if uncalibrated
+  bool present;                 // A physical sensor is connected (false after it was unplugged)
+  char name[SENSOR_NAME_LEN];   // Display name
+  char expr[SENSOR_EXPR_LEN];   // Source of a virtual sensor expression
+  ExprProgram program;          // Compiled virtual sensor expression
+  SensorGroup group;            // Members, mode and voting state of a sensor group
+  float minTemp;                // Alert thresholds of the sensor; NAN uses MIN_TEMP and MAX_TEMP
+  float maxTemp;
+  unsigned long intervalMs;     // Sampling interval of the sensor; 0 uses the global timerDelay
+};
+
+// Table of all sensors, indexed by sensor number.
+SensorInfo sensorTable[MAX_SENSORS];
+
+// Latest reading of each sensor in hundredths of a degree Celsius (TEMP_INVALID if unavailable).
+int16_t latestCentiC[MAX_SENSORS];
+
+// Latest uncalibrated reading of each physical sensor in hundredths of a degree Celsius.
+int16_t latestRawCentiC[MAX_SENSORS];
+
+// Time each sensor was last read into latestCentiC, in milliseconds since boot (0 if never).
+unsigned long latestReadMs[MAX_SENSORS];
+
+// Start of the conversion of each sensor's latest reading, in milliseconds since boot.
+unsigned long latestStartMs[MAX_SENSORS];
+
+// Events raised by each sensor group during the last readSensors(), to be reported by the caller.
+GroupUpdate groupEvents[MAX_SENSORS];
+
+// One stored reading of a sensor and the time it was taken.
+// Readings are stored as hundredths of a degree Celsius to keep the history compact;
+// the Fahrenheit value and the time string are derived when the data is served.
+struct SeriesSample {
+  uint32_t epoch;                 // Start of the reading's conversion in seconds since the Unix epoch (0 if unknown)
+  int16_t centiC;                 // Temperature in hundredths of a degree Celsius
+  uint16_t publishDelayMs;        // Time from the start of the conversion to the store (saturates at 65535)
 };
 
-// Maximum number of rows in the temperature data array.
+// Maximum number of stored readings per sensor.
 const int MAX_ROWS = 288;
 
-// Array to store temperature data readings.
-TemperatureData temperatureArray[MAX_ROWS];
+// Stored readings of one sensor in a circular buffer. Each sensor is stored at its own
+// sampling interval, so a slowly sampled sensor covers a longer time span.
+struct SensorSeries {
+  SeriesSample samples[MAX_ROWS];
+  int index;                      // Position of the next reading
+  int count;                      // Number of stored readings
+};
+
+// History of each sensor.
+SensorSeries sensorSeries[MAX_SENSORS];
+
+// Start of the sampling schedule; the sampling times of all sensors are multiples of their
+// interval after it, so sensors with related intervals fall due together.
+unsigned long scheduleOriginMs = 0;
+
+// Time of the next scheduled sample of each sensor, in milliseconds since boot.
+unsigned long nextSampleMs[MAX_SENSORS];
+
+// Time each sensor was last stored, in milliseconds since boot.
+unsigned long lastStoredMs[MAX_SENSORS];
 
-// Index to track the current position in the temperatureArray for the next reading.
-int Temp_Array_Index = 0;
+// Interval between the starts of two presence scan passes.
+const unsigned long PRESENCE_SCAN_INTERVAL_MS = 30000;
+
+// Time kept free before a scheduled sample; a scan step is only taken if it cannot delay the sample.
+const unsigned long PRESENCE_SCAN_STEP_MS = 50;
+
+// A presence scan pass is running, and the time the last one started.
+bool presenceScanActive = false;
+unsigned long presenceScanStartMs = 0;
+
+// Kind of change of a sensor found by a presence scan.
+enum SensorPresence {
+  PRESENCE_ADDED,     // A new sensor was connected and assigned a slot
+  PRESENCE_REMOVED,   // A sensor was disconnected; its slot and history are kept
+  PRESENCE_RESTORED   // A disconnected sensor was connected again
+};
 
 /**
- * Reads the temperature in Celsius from a DS18B20 sensor.
- * 
- * This function initiates a temperature reading request to the DS18B20 sensor
- * and retrieves the temperature in Celsius. The temperature is read from the first 
- * (index 0) sensor on the bus.
- * 
- * If the sensor does not return a valid reading (indicated by a value of -127.00),
- * the function returns a placeholder string "--" to indicate an error or unavailable reading.
- * Otherwise, it returns the temperature as a string.
- * 
- * @return A string representing the temperature in Celsius. Returns "--" if the sensor reading is invalid.
+ * Formats a stored reading in Celsius or Fahrenheit.
+ *
+ * @param centiC The reading in hundredths of a degree Celsius, or TEMP_INVALID.
+ * @param fahrenheit True to convert the reading to Fahrenheit.
+ * @return The formatted temperature, or "--" for an invalid reading.
  */
-String readDSTemperatureC() {
-  sensors.requestTemperatures();
-  float tempC = sensors.getTempCByIndex(0);
-
-  if (tempC == -127.00) {
+String formatTemperature(int16_t centiC, bool fahrenheit) {
+  if (centiC == TEMP_INVALID) {
     return "--";
-  } 
-  return String(tempC);
+  }
+  float tempC = centiC / 100.0;
+  return String(fahrenheit ? tempC * 9.0 / 5.0 + 32.0 : tempC);
 }
 
 /**
- * Reads the temperature in Fahrenheit from a DS18B20 sensor.
- * 
- * This function sends a request to the DS18B20 sensor to measure the temperature
- * and retrieves the temperature in Fahrenheit. It reads the temperature from the first 
- * sensor on the bus (index 0).
- * 
- * In cases where the sensor returns an invalid reading, which is indicated by a 
- * temperature of -196 degrees Fahrenheit (equivalent to the error value of -127.00 
- * degrees Celsius in the sensor's reading), the function returns a placeholder string "--".
- * This indicates an error or that the reading is unavailable. Otherwise, it returns 
- * the temperature as a string.
- * 
- * @return A string representing the temperature in Fahrenheit. Returns "--" if the sensor reading is invalid.
+ * Returns the name of a sensor kind, used in JSON output.
+ */
+const char* sensorKindName(SensorKind kind) {
+  switch (kind) {
+  case SENSOR_PHYSICAL:
+    return "physical";
+  case SENSOR_VIRTUAL:
+    return "virtual";
+  case SENSOR_GROUP:
+    return "group";
+  default:
+    return "none";
+  }
+}
+
+/**
+ * Formats a ROM address as 16 hexadecimal digits.
  */
-String readDSTemperatureF() {
-  sensors.requestTemperatures();
-  float tempF = sensors.getTempFByIndex(0);
+String romToString(const uint8_t* rom) {
+  char text[17];
+  for (int i = 0; i < 8; i++) {
+    snprintf(text + 2 * i, 3, "%02X", rom[i]);
+  }
+  return String(text);
+}
 
-  if (int(tempF) == -196) {
-    return "--";
-  } 
-  return String(tempF);
+/**
+ * Returns the group a physical sensor is a member of.
+ *
+ * @param sensor The sensor number.
+ * @return The sensor number of the group, or -1 if the sensor is not a group member.
+ */
+int sensorGroupOf(int sensor) {
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind == SENSOR_GROUP && (sensorTable[i].group.memberMask & (1 << sensor))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Returns whether a sensor is referenced by a virtual sensor expression.
+ */
+bool sensorReferenced(int sensor) {
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind == SENSOR_VIRTUAL && (sensorTable[i].program.sensorMask & (1 << sensor))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Returns whether a sensor number refers to a configured sensor.
+ */
+bool sensorInUse(int sensor) {
+  return sensor >= 0 && sensor < MAX_SENSORS && sensorTable[sensor].kind != SENSOR_NONE;
+}
+
+/**
+ * Returns the minimum alert threshold of a sensor in Celsius.
+ */
+float sensorMinTemp(int sensor) {
+  return isnan(sensorTable[sensor].minTemp) ? MIN_TEMP : sensorTable[sensor].minTemp;
+}
+
+/**
+ * Returns the maximum alert threshold of a sensor in Celsius.
+ */
+float sensorMaxTemp(int sensor) {
+  return isnan(sensorTable[sensor].maxTemp) ? MAX_TEMP : sensorTable[sensor].maxTemp;
+}
+
+/**
+ * Discards a sensor's history and restores its default sampling interval.
+ *
+ * Used when a slot is assigned to a different sensor so that old readings are not attributed to it.
+ * The sensor is sampled at the next scheduler pass.
+ */
+void clearSensorHistory(int sensor) {
+  sensorSeries[sensor].index = 0;
+  sensorSeries[sensor].count = 0;
+  latestCentiC[sensor] = TEMP_INVALID;
+  sensorTable[sensor].intervalMs = 0;
+  nextSampleMs[sensor] = millis();
+}
+
+/**
+ * Initializes the sensor drivers and the sensor table with the channels they found.
+ *
+ * Channels are assigned to sensor slots in driver order (DS18B20 probes first, in bus order) and
+ * their ids are cached as the calibration key. Slot 0 is always a physical sensor, even if no probe
+ * is found, so that a missing probe is reported as "--" as before.
+ */
+void setupSensors() {
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    sensorTable[i].kind = SENSOR_NONE;
+    sensorTable[i].minTemp = NAN;
+    sensorTable[i].maxTemp = NAN;
+    latestCentiC[i] = TEMP_INVALID;
+    latestRawCentiC[i] = TEMP_INVALID;
+    sensorTable[i].calibration = -1;
+  }
+  beginDrivers();
+  int slot = 0;
+  for (int d = 0; d < DRIVER_COUNT; d++) {
+    for (int c = 0; c < driverStats[d].channels && slot < MAX_SENSORS; c++) {
+      sensorTable[slot].kind = SENSOR_PHYSICAL;
+      sensorTable[slot].present = true;
+      sensorTable[slot].driver = d;
+      sensorTable[slot].channel = c;
+      sensorDrivers[d].channelId(c, sensorTable[slot].rom);
+      sensorTable[slot].calibration = findCalibration(sensorTable[slot].rom);
+      snprintf(sensorTable[slot].name, SENSOR_NAME_LEN, "probe%d", slot);
+      slot++;
+    }
+  }
+  if (slot == 0) {
+    sensorTable[0].kind = SENSOR_PHYSICAL;
+    sensorTable[0].present = false;
+    sensorTable[0].driver = DRIVER_DS18B20;
+    sensorTable[0].channel = 0;
+    memset(sensorTable[0].rom, 0, sizeof(DeviceAddress));
+    snprintf(sensorTable[0].name, SENSOR_NAME_LEN, "probe0");
+  }
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    sensorTable[i].intervalMs = 0;
+    sensorSeries[i].index = 0;
+    sensorSeries[i].count = 0;
+  }
+}
+
+/**
+ * Looks up the calibration of every physical sensor again, after the calibration table changed.
+ */
+void refreshSensorCalibrations() {
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind == SENSOR_PHYSICAL) {
+      sensorTable[i].calibration = findCalibration(sensorTable[i].rom);
+    }
+  }
+}
+
+/**
+ * Returns the sampling interval of a sensor in milliseconds.
+ *
+ * @param sensor The sensor.
+ * @param defaultMs The interval of sensors without their own (timerDelay).
+ */
+unsigned long sensorIntervalMs(int sensor, unsigned long defaultMs) {
+  unsigned long interval = sensorTable[sensor].intervalMs > 0 ? sensorTable[sensor].intervalMs : defaultMs;
+  return max(interval, 1000UL);
+}
+
+/**
+ * Schedules the next sample of a sensor at the first multiple of its interval after 'now',
+ * counted from scheduleOriginMs. Samples missed while the loop was busy are skipped.
+ */
+void scheduleSensor(int sensor, unsigned long now, unsigned long defaultMs) {
+  unsigned long interval = sensorIntervalMs(sensor, defaultMs);
+  nextSampleMs[sensor] = scheduleOriginMs + ((now - scheduleOriginMs) / interval + 1) * interval;
+}
+
+/**
+ * Starts the sampling schedule of all sensors at 'now', after the initial sample.
+ */
+void startSchedule(unsigned long now, unsigned long defaultMs) {
+  scheduleOriginMs = now;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    lastStoredMs[i] = now;
+    scheduleSensor(i, now, defaultMs);
+  }
+}
+
+/**
+ * Returns the sensors due for a sample and schedules their next sample.
+ *
+ * @param now The current time in milliseconds since boot.
+ * @param defaultMs The interval of sensors without their own (timerDelay).
+ * @return Bit N set if sensor N is due.
+ */
+uint16_t dueSensors(unsigned long now, unsigned long defaultMs) {
+  uint16_t due = 0;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind == SENSOR_NONE || (long)(now - nextSampleMs[i]) < 0) {
+      continue;
+    }
+    due |= 1 << i;
+    scheduleSensor(i, now, defaultMs);
+  }
+  return due;
+}
+
+/**
+ * Adds the inputs of the sensor groups and virtual sensors in a mask, so that a derived sensor
+ * is computed from fresh readings of the sensors it depends on.
+ *
+ * A virtual sensor may reference a group in any slot, whose members must then be added too, so
+ * the slots are scanned until no input is added. Inputs cannot form a cycle (group members are
+ * physical, virtual sensors only reference virtual sensors in lower slots), so this ends after a
+ * few passes.
+ *
+ * @param mask Bit N set for each sensor N to sample.
+ * @return The mask with all inputs added.
+ */
+uint16_t sensorInputs(uint16_t mask) {
+  uint16_t previous;
+  do {
+    previous = mask;
+    for (int i = MAX_SENSORS - 1; i >= 0; i--) {
+      if (!(mask & (1 << i))) {
+        continue;
+      }
+      if (sensorTable[i].kind == SENSOR_GROUP) {
+        mask |= sensorTable[i].group.memberMask;
+      }
+      else if (sensorTable[i].kind == SENSOR_VIRTUAL) {
+        mask |= sensorTable[i].program.sensorMask;
+      }
+    }
+  } while (mask != previous);
+  return mask;
+}
+
+/**
+ * Returns the time until the next scheduled sample of any sensor, in milliseconds (0 if one is due).
+ */
+unsigned long msUntilNextSample(unsigned long now) {
+  unsigned long wait = 0xFFFFFFFFUL;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind == SENSOR_NONE) {
+      continue;
+    }
+    long remaining = (long)(nextSampleMs[i] - now);
+    wait = min(wait, (unsigned long)max(remaining, 0L));
+  }
+  return wait;
+}
+
+// Stages of the sample pipeline run by loop() for each sample.
+enum PipelineStage {
+  STAGE_READ,   // readSensors()
+  STAGE_ALERT,  // Threshold alerts and group events
+  STAGE_MODEL,  // Thermal model
+  STAGE_STORE,  // Series storage
+  STAGE_COUNT
+};
+
+// Latency of a pipeline stage in microseconds.
+struct StageStats {
+  unsigned long count;
+  uint64_t totalUs;
+  unsigned long maxUs;
+};
+
+StageStats stageStats[STAGE_COUNT];
+
+// Synthetic load: while syntheticConfig.rateHz is set, the synthetic sensors are run through the
+// pipeline at that rate instead of at their interval. Samples more than LOAD_MAX_BACKLOG_MS
+// behind are dropped, and loop() spends at most LOAD_BUDGET_MS per call on the load so that the
+// DNS server and the other sensors keep being served.
+const unsigned long LOAD_MAX_BACKLOG_MS = 100;
+const unsigned long LOAD_BUDGET_MS = 20;
+
+// Statistics of the synthetic load.
+struct LoadStats {
+  unsigned long startMs;   // Start of the load
+  unsigned long lastUs;    // Last time samples were credited
+  uint64_t creditMicro;    // Samples owed, in millionths
+  unsigned long samples;   // Samples run through the pipeline
+  unsigned long dropped;   // Samples dropped behind the backlog limit
+};
+
+LoadStats loadStats;
+
+/**
+ * Returns the name of a pipeline stage.
+ */
+const char* pipelineStageName(PipelineStage stage) {
+  switch (stage) {
+    case STAGE_READ:
+      return "read";
+    case STAGE_ALERT:
+      return "alert";
+    case STAGE_MODEL:
+      return "model";
+    case STAGE_STORE:
+      return "store";
+    default:
+      return "unknown";
+  }
+}
+
+/**
+ * Records the latency of a pipeline stage that started at 'startUs'.
+ */
+void recordStage(PipelineStage stage, unsigned long startUs) {
+  unsigned long elapsed = micros() - startUs;
+  stageStats[stage].count++;
+  stageStats[stage].totalUs += elapsed;
+  stageStats[stage].maxUs = max(stageStats[stage].maxUs, elapsed);
+}
+
+/**
+ * Returns whether a sensor is a physical sensor on the synthetic driver.
+ */
+bool syntheticSensor(int sensor) {
+  return sensorTable[sensor].kind == SENSOR_PHYSICAL && sensorTable[sensor].driver == DRIVER_SYNTHETIC;
+}
+
+/**
+ * Returns the physical sensors on the synthetic driver.
+ */
+uint16_t syntheticSensors() {
+  uint16_t mask = 0;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (syntheticSensor(i)) {
+      mask |= 1 << i;
+    }
+  }
+  return mask;
+}
+
+/**
+ * Sets the synthetic load rate and clears the load and stage statistics.
+ *
+ * @param rateHz Samples per second, or 0 to sample the synthetic sensors at their interval.
+ */
+void startSyntheticLoad(unsigned long rateHz) {
+  syntheticConfig.rateHz = min(rateHz, SYNTHETIC_MAX_RATE_HZ);
+  memset(&loadStats, 0, sizeof(loadStats));
+  memset(stageStats, 0, sizeof(stageStats));
+  loadStats.startMs = millis();
+  loadStats.lastUs = micros();
+}
+
+/**
+ * Credits the samples due since the last call and drops those beyond the backlog limit.
+ *
+ * @param nowUs The current time in microseconds.
+ * @return The number of samples to run now.
+ */
+unsigned long syntheticLoadPending(unsigned long nowUs) {
+  loadStats.creditMicro += (uint64_t)syntheticConfig.rateHz * (nowUs - loadStats.lastUs);
+  loadStats.lastUs = nowUs;
+  unsigned long pending = (unsigned long)(loadStats.creditMicro / 1000000ULL);
+  unsigned long backlog = max(syntheticConfig.rateHz * LOAD_MAX_BACKLOG_MS / 1000, 1UL);
+  if (pending > backlog) {
+    loadStats.dropped += pending - backlog;
+    loadStats.creditMicro -= (uint64_t)(pending - backlog) * 1000000ULL;
+    pending = backlog;
+  }
+  return pending;
+}
+
+/**
+ * Accounts for one synthetic sample run through the pipeline.
+ */
+void syntheticLoadDone() {
+  loadStats.creditMicro -= min(loadStats.creditMicro, (uint64_t)1000000ULL);
+  loadStats.samples++;
+}
+
+/**
+ * Returns the sustained synthetic ingest rate since the load started, in samples per second.
+ */
+float syntheticIngestRate() {
+  unsigned long elapsed = millis() - loadStats.startMs;
+  return elapsed > 0 ? loadStats.samples * 1000.0f / elapsed : 0.0f;
+}
+
+// On-demand fresh readings ("/read?fresh=1"): requests made while a fresh sample is pending wait
+// for that same sample, and a new one is taken at most every FRESH_MIN_INTERVAL_MS; requests in
+// between are answered with the last one. A request gives up waiting after FRESH_TIMEOUT_MS.
+const unsigned long FRESH_MIN_INTERVAL_MS = 2000;
+const unsigned long FRESH_TIMEOUT_MS = 5000;
+
+// State of the fresh samples. 'requested' is only written by the web server task and 'completed'
+// by loop(), so both can be compared without a lock.
+struct FreshReadState {
+  volatile uint32_t requested;         // Generation of the last requested fresh sample
+  volatile uint32_t completed;         // Generation of the last completed fresh sample
+  volatile unsigned long completedMs;  // Time the last fresh sample completed
+  unsigned long requests;              // Fresh requests received
+  unsigned long conversions;           // Fresh samples taken
+};
+
+FreshReadState freshRead;
+
+// A "/read?fresh=1" response waiting for its fresh sample.
+struct FreshReadStream {
+  uint32_t generation;  // Fresh sample the response waits for
+  unsigned long startMs;
+  String body;          // Response body, once the sample completed
+  size_t pos;           // Part of the body already sent
+  bool ready;
+};
+
+/**
+ * Requests a fresh sample of all sensors, joining the pending one if there is one.
+ * Called from the web server task; the sample is taken by loop().
+ *
+ * @param now The current time in milliseconds.
+ * @return The generation to wait for: the request is served once freshRead.completed reaches it.
+ */
+uint32_t requestFreshRead(unsigned long now) {
+  freshRead.requests++;
+  if (freshRead.requested != freshRead.completed) {
+    return freshRead.requested;
+  }
+  if (freshRead.completed != 0 && now - freshRead.completedMs < FRESH_MIN_INTERVAL_MS) {
+    return freshRead.completed;
+  }
+  freshRead.requested = freshRead.completed + 1;
+  return freshRead.requested;
+}
+
+/**
+ * Returns whether a fresh sample was requested and not taken yet.
+ */
+bool freshReadPending() {
+  return freshRead.requested != freshRead.completed;
+}
+
+/**
+ * Returns whether the fresh sample of a generation completed.
+ */
+bool freshReadDone(uint32_t generation) {
+  return (int32_t)(freshRead.completed - generation) >= 0;
+}
+
+/**
+ * Reads sensors into latestCentiC.
+ *
+ * The requested sensors and their inputs are sampled together: one sample of the driver channels
+ * of all physical sensors involved is taken by sampleDrivers(), which overlaps the conversions of
+ * all drivers and 1-Wire buses and leaves buses without a requested probe idle. Each physical
+ * sensor's reading is then corrected with its calibration, in fixed point. Sensor groups are then
+ * combined from their members, and their events stored in groupEvents. Reads between a group's
+ * regular samples pass 'advanceGroups' false: the group value is computed without counting the
+ * read towards the voting streaks, so extra reads do not fail or restore members sooner, and no
+ * events are raised. Virtual sensors are evaluated last, in slot order, so a virtual sensor may
+ * use physical sensors, groups and virtual sensors in lower slots.
+ *
+ * Channels that do not return a valid reading, and disconnected sensors, are stored as TEMP_INVALID.
+ * The time of the read is stored in latestReadMs, and the start of its conversion in latestStartMs,
+ * for every sensor read.
+ *
+ * @param mask Bit N set for each sensor N to read; all sensors by default.
+ * @param advanceGroups Whether this is a regular sample of the groups, which updates their state.
+ * @return The sensors that were read, including the inputs of the requested ones.
+ */
+uint16_t readSensors(uint16_t mask = 0xFFFF, bool advanceGroups = true) {
+  unsigned long sampleStart = millis();
+  mask = sensorInputs(mask);
+  uint32_t channelMask = 0;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    int index = driverChannelIndex(sensorTable[i].driver, sensorTable[i].channel);
+    if ((mask & (1 << i)) && sensorTable[i].kind == SENSOR_PHYSICAL && sensorTable[i].present && index >= 0) {
+      channelMask |= 1UL << index;
+    }
+  }
+  int16_t channels[DRIVER_MAX_CHANNELS];
+  sampleDrivers(channels, DRIVER_MAX_CHANNELS, TEMP_INVALID, channelMask);
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind != SENSOR_PHYSICAL || !(mask & (1 << i))) {
+      continue;
+    }
+    int index = driverChannelIndex(sensorTable[i].driver, sensorTable[i].channel);
+    latestRawCentiC[i] = (index < 0 || !sensorTable[i].present) ? TEMP_INVALID : channels[index];
+    latestCentiC[i] = (latestRawCentiC[i] == TEMP_INVALID) ? TEMP_INVALID : applyCalibration(sensorTable[i].calibration, latestRawCentiC[i]);
+  }
+
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind != SENSOR_GROUP || !(mask & (1 << i))) {
+      continue;
+    }
+    if (advanceGroups) {
+      latestCentiC[i] = updateSensorGroup(sensorTable[i].group, latestCentiC, MAX_SENSORS, TEMP_INVALID, groupEvents[i]);
+    }
+    else {
+      int used;
+      latestCentiC[i] = sensorGroupValue(sensorTable[i].group, latestCentiC, MAX_SENSORS, TEMP_INVALID, used);
+    }
+  }
+
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind != SENSOR_VIRTUAL || !(mask & (1 << i))) {
+      continue;
+    }
+    int32_t value = evaluateExpr(sensorTable[i].program, latestCentiC, MAX_SENSORS, TEMP_INVALID);
+    latestCentiC[i] = (value == EXPR_INVALID || value <= INT16_MIN || value > INT16_MAX) ? TEMP_INVALID : (int16_t)value;
+  }
+
+  unsigned long readMs = millis();
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind != SENSOR_NONE && (mask & (1 << i))) {
+      latestReadMs[i] = readMs;
+      latestStartMs[i] = sampleStart;
+    }
+  }
+
+  temperatureC = formatTemperature(latestCentiC[0], false);
+  temperatureF = formatTemperature(latestCentiC[0], true);
+  lastSampleMs = readMs - sampleStart;
+  return mask;
+}
+
+/**
+ * Stores the latest reading of a sensor in its series.
+ *
+ * @param sensor The sensor.
+ * @param epoch The start of the reading's conversion in seconds since the Unix epoch, or 0 if unknown.
+ * @param publishDelayMs The time from the start of the conversion to the store, in milliseconds.
+ */
+void storeSensorSample(int sensor, time_t epoch, unsigned long publishDelayMs = 0) {
+  SensorSeries& series = sensorSeries[sensor];
+  series.samples[series.index].epoch = (uint32_t)epoch;
+  series.samples[series.index].centiC = latestCentiC[sensor];
+  series.samples[series.index].publishDelayMs = min(publishDelayMs, 65535UL);
+  series.index = (series.index + 1) % MAX_ROWS;
+  if (series.count < MAX_ROWS) {
+    series.count++;
+  }
+  lastStoredMs[sensor] = millis();
+}
+
+/**
+ * Returns a stored reading of a sensor in chronological order.
+ *
+ * @param sensor The sensor.
+ * @param n The position of the reading, where 0 is the oldest stored reading and the series count - 1 the newest.
+ * @return The stored reading.
+ */
+const SeriesSample& sensorSample(int sensor, int n) {
+  const SensorSeries& series = sensorSeries[sensor];
+  int oldest = (series.count < MAX_ROWS) ? 0 : series.index;
+  return series.samples[(oldest + n) % MAX_ROWS];
+}
+
+/**
+ * Returns a free sensor slot, or -1 if all slots are in use.
+ */
+int freeSensorSlot() {
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind == SENSOR_NONE) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Runs the presence scans of the sensor drivers in the idle time between samples.
+ *
+ * A pass is started every PRESENCE_SCAN_INTERVAL_MS and advanced by one short step per call, and
+ * only when no sample is due within PRESENCE_SCAN_STEP_MS, so scanning never delays sampling.
+ * Changes are applied to the sensor table in place: a new sensor takes the first free slot with
+ * an empty history, and a disconnected sensor keeps its slot and history, stores invalid readings
+ * until it is connected again, and resumes in the same slot.
+ *
+ * @param now The current time in milliseconds since boot.
+ * @param presence Receives the kind of change.
+ * @return The sensor that changed, or -1 if there is nothing to report.
+ */
+int scanSensorPresence(unsigned long now, SensorPresence& presence) {
+  if (!presenceScanActive) {
+    if (now - presenceScanStartMs < PRESENCE_SCAN_INTERVAL_MS) {
+      return -1;
+    }
+    presenceScanActive = true;
+    presenceScanStartMs = now;
+  }
+  if (msUntilNextSample(now) < PRESENCE_SCAN_STEP_MS) {
+    return -1;
+  }
+
+  int driver;
+  DriverChange change;
+  ScanResult result = scanDrivers(driver, change);
+  if (result == SCAN_DONE) {
+    presenceScanActive = false;
+  }
+  if (result != SCAN_CHANGE) {
+    return -1;
+  }
+
+  int slot = -1;
+  for (int i = 0; i < MAX_SENSORS && slot < 0; i++) {
+    if (sensorTable[i].kind == SENSOR_PHYSICAL && sensorTable[i].driver == driver && sensorTable[i].channel == change.channel) {
+      slot = i;
+    }
+  }
+  if (slot < 0 && change.present) {
+    slot = freeSensorSlot();
+    change.added = true;
+  }
+  if (slot < 0) {
+    return -1;
+  }
+
+  SensorInfo& info = sensorTable[slot];
+  if (change.added) {
+    // A new sensor, or the first one taking over the placeholder slot 0 when none was found at boot.
+    info.kind = SENSOR_PHYSICAL;
+    info.driver = driver;
+    info.channel = change.channel;
+    sensorDrivers[driver].channelId(change.channel, info.rom);
+    info.calibration = findCalibration(info.rom);
+    info.minTemp = NAN;
+    info.maxTemp = NAN;
+    snprintf(info.name, SENSOR_NAME_LEN, "probe%d", slot);
+    clearSensorHistory(slot);
+    info.present = true;
+    presence = PRESENCE_ADDED;
+    return slot;
+  }
+  info.present = change.present;
+  if (!change.present) {
+    latestCentiC[slot] = TEMP_INVALID;
+    latestRawCentiC[slot] = TEMP_INVALID;
+  }
+  presence = change.present ? PRESENCE_RESTORED : PRESENCE_REMOVED;
+  return slot;
+}
+
+/**
+ * Finds a sensor by name.
+ *
+ * @param name The sensor name.
+ * @return The sensor number, or -1 if no sensor has that name.
+ */
+int findSensor(const String& name) {
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (sensorTable[i].kind != SENSOR_NONE && name == sensorTable[i].name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Returns whether a name can be given to a sensor: 1 to SENSOR_NAME_LEN - 1 printable ASCII
+ * characters other than quotes and backslashes, so it is written into JSON and Prometheus labels
+ * without escaping.
+ */
+bool validSensorName(const String& name) {
+  if (name.length() == 0 || name.length() >= SENSOR_NAME_LEN) {
+    return false;
+  }
+  for (unsigned int i = 0; i < name.length(); i++) {
+    char c = name[i];
+    if (c < 0x20 || c > 0x7E || c == '"' || c == '\\') {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Checks the definition of a virtual sensor without applying it.
+ *
+ * @param name The name of the virtual sensor.
+ * @param expr The expression defining the sensor (see expr.h).
+ * @param slot Receives the slot of the sensor: its current slot, or the first free slot for a new sensor.
+ * @param program Receives the compiled expression.
+ * @return nullptr if the definition is valid, or a short description of the error.
+ */
+const char* checkVirtualSensor(const String& name, const String& expr, int& slot, ExprProgram& program) {
+  if (!validSensorName(name)) {
+    return "invalid name";
+  }
+  if (expr.length() >= SENSOR_EXPR_LEN) {
+    return "expression too long";
+  }
+
+  slot = findSensor(name);
+  if (slot >= 0 && sensorTable[slot].kind != SENSOR_VIRTUAL) {
+    return "name used by another sensor";
+  }
+  if (slot < 0) {
+    slot = freeSensorSlot();
+    if (slot < 0) {
+      return "no free sensor slot";
+    }
+  }
+
+  const char* error = compileExpr(expr.c_str(), program);
+  if (error != nullptr) {
+    return error;
+  }
+  for (int i = 0; i <= EXPR_MAX_SENSOR; i++) {
+    if ((program.sensorMask & (1 << i)) == 0) {
+      continue;
+    }
+    if (i >= MAX_SENSORS || sensorTable[i].kind == SENSOR_NONE) {
+      return "reference to an unknown sensor";
+    }
+    if (sensorTable[i].kind == SENSOR_VIRTUAL && i >= slot) {
+      return "reference to a virtual sensor in the same or a higher slot";
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Defines or redefines a virtual sensor.
+ *
+ * The expression is compiled once here. A virtual sensor may reference physical sensors, groups
+ * and virtual sensors in lower slots, which are evaluated before it. A new virtual sensor takes the
+ * first free slot, and its history starts empty. The sensor table is sampled by the main loop, so
+ * this is only called from it.
+ *
+ * @param name The name of the virtual sensor.
+ * @param expr The expression defining the sensor (see expr.h).
+ * @param minTemp The minimum alert threshold, or NAN to use MIN_TEMP.
+ * @param maxTemp The maximum alert threshold, or NAN to use MAX_TEMP.
+ * @return nullptr on success, or a short description of the error.
+ */
+const char* defineVirtualSensor(const String& name, const String& expr, float minTemp, float maxTemp) {
+  int slot;
+  ExprProgram program;
+  const char* error = checkVirtualSensor(name, expr, slot, program);
+  if (error != nullptr) {
+    return error;
+  }
+
+  SensorInfo& info = sensorTable[slot];
+  bool created = info.kind == SENSOR_NONE;
+  info.program = program;
+  strncpy(info.expr, expr.c_str(), SENSOR_EXPR_LEN);
+  strncpy(info.name, name.c_str(), SENSOR_NAME_LEN);
+  info.minTemp = minTemp;
+  info.maxTemp = maxTemp;
+  if (created) {
+    clearSensorHistory(slot);
+  }
+  info.kind = SENSOR_VIRTUAL;
+  return nullptr;
+}
+
+/**
+ * Checks the removal of a virtual sensor without applying it.
+ *
+ * @param name The name of the virtual sensor.
+ * @param slot Receives the slot of the sensor.
+ * @return nullptr if the sensor can be removed, or a short description of the error.
+ */
+const char* checkRemoveVirtualSensor(const String& name, int& slot) {
+  slot = findSensor(name);
+  if (slot < 0 || sensorTable[slot].kind != SENSOR_VIRTUAL) {
+    return "no virtual sensor with that name";
+  }
+  if (sensorReferenced(slot)) {
+    return "sensor is used by a virtual sensor";
+  }
+  return nullptr;
+}
+
+/**
+ * Removes a virtual sensor. Only called from the main loop, as defineVirtualSensor().
+ *
+ * @param name The name of the virtual sensor.
+ * @return nullptr on success, or a short description of the error.
+ */
+const char* removeVirtualSensor(const String& name) {
+  int slot;
+  const char* error = checkRemoveVirtualSensor(name, slot);
+  if (error != nullptr) {
+    return error;
+  }
+  sensorTable[slot].kind = SENSOR_NONE;
+  clearSensorHistory(slot);
+  return nullptr;
+}
+
+/**
+ * Checks the definition of a sensor group without applying it.
+ *
+ * @param name The name of the group.
+ * @param memberMask Bit N set for each member sensor N (at least two members).
+ * @param toleranceC The largest accepted deviation of a member from the group value, in Celsius.
+ * @param slot Receives the slot of the group: its current slot, or the first free slot for a new group.
+ * @return nullptr if the definition is valid, or a short description of the error.
+ */
+const char* checkSensorGroup(const String& name, uint16_t memberMask, float toleranceC, int& slot) {
+  if (!validSensorName(name)) {
+    return "invalid name";
+  }
+  if (!(toleranceC > 0.0) || toleranceC > 100.0) {
+    return "invalid tolerance";
+  }
+
+  slot = findSensor(name);
+  if (slot >= 0 && sensorTable[slot].kind != SENSOR_GROUP) {
+    return "name used by another sensor";
+  }
+  int members = 0;
+  for (int i = 0; i < MAX_SENSORS; i++) {
+    if (!(memberMask & (1 << i))) {
+      continue;
+    }
+    if (sensorTable[i].kind != SENSOR_PHYSICAL) {
+      return "members must be physical sensors";
+    }
+    int group = sensorGroupOf(i);
+    if (group >= 0 && group != slot) {
+      return "member already belongs to another group";
+    }
+    members++;
+  }
+  if (members < 2 || (memberMask >> MAX_SENSORS) != 0) {
+    return "a group needs at least two valid members";
+  }
+
+  if (slot < 0) {
+    slot = freeSensorSlot();
+    if (slot < 0) {
+      return "no free sensor slot";
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Defines or redefines a sensor group of redundant physical probes.
+ *
+ * Members must be physical sensors that are not members of another group. While a probe is a
+ * group member, the group is alerted on in its place. A new group takes the first free slot,
+ * and its history starts empty. A redefined group restarts its voting state, so this is only
+ * called from the main loop, which updates the groups while it samples.
+ *
+ * @param name The name of the group.
+ * @param memberMask Bit N set for each member sensor N (at least two members).
+ * @param mode How the member readings are combined.
+ * @param toleranceC The largest accepted deviation of a member from the group value, in Celsius.
+ * @param minTemp The minimum alert threshold, or NAN to use MIN_TEMP.
+ * @param maxTemp The maximum alert threshold, or NAN to use MAX_TEMP.
+ * @return nullptr on success, or a short description of the error.
+ */
+const char* defineSensorGroup(const String& name, uint16_t memberMask, GroupMode mode, float toleranceC, float minTemp, float maxTemp) {
+  int slot;
+  const char* error = checkSensorGroup(name, memberMask, toleranceC, slot);
+  if (error != nullptr) {
+    return error;
+  }
+
+  SensorInfo& info = sensorTable[slot];
+  bool created = info.kind == SENSOR_NONE;
+  memset(&info.group, 0, sizeof(info.group));
+  info.group.memberMask = memberMask;
+  info.group.mode = mode;
+  info.group.tolerance = (int16_t)lroundf(toleranceC * 100.0);
+  info.expr[0] = '\0';
+  strncpy(info.name, name.c_str(), SENSOR_NAME_LEN);
+  info.minTemp = minTemp;
+  info.maxTemp = maxTemp;
+  if (created) {
+    clearSensorHistory(slot);
+  }
+  info.kind = SENSOR_GROUP;
+  return nullptr;
+}
+
+/**
+ * Checks the removal of a sensor group without applying it.
+ *
+ * @param name The name of the group.
+ * @param slot Receives the slot of the group.
+ * @return nullptr if the group can be removed, or a short description of the error.
+ */
+const char* checkRemoveSensorGroup(const String& name, int& slot) {
+  slot = findSensor(name);
+  if (slot < 0 || sensorTable[slot].kind != SENSOR_GROUP) {
+    return "no sensor group with that name";
+  }
+  if (sensorReferenced(slot)) {
+    return "sensor is used by a virtual sensor";
+  }
+  return nullptr;
+}
+
+/**
+ * Removes a sensor group. Its members are alerted on individually again. Only called from the
+ * main loop, as defineSensorGroup().
+ *
+ * @param name The name of the group.
+ * @return nullptr on success, or a short description of the error.
+ */
+const char* removeSensorGroup(const String& name) {
+  int slot;
+  const char* error = checkRemoveSensorGroup(name, slot);
+  if (error != nullptr) {
+    return error;
+  }
+  sensorTable[slot].kind = SENSOR_NONE;
+  clearSensorHistory(slot);
+  return nullptr;
 }
 
 /**
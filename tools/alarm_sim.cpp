@@ -0,0 +1,167 @@
+/*
+  Program: alarm_sim.cpp
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+    Host test of the local alarm (alarm.h) on the emulated GPIO of host/Arduino.h. Readings are
+    passed to updateAlarm() as the main loop does after a sample, and runAlarmOutputs() is run every
+    tick as by the alarm task, in virtual time. The scenarios are:
+
+    - latency: a reading above the maximum must sound the buzzer and light the LED within one tick,
+      and a reading back in range must stop them within one tick.
+    - patterns: the rising edges of the buzzer in 10 seconds must match each pattern.
+    - priority: with one sensor low and one high, the more urgent pattern plays, and the other one
+      takes over when it clears.
+    - rules: a threshold mapped to "none" never alarms, and an invalid reading keeps the alarm.
+    - silence: a bounce of the button is ignored; a press silences the buzzer but not the LED; a
+      new alarm during the silence sounds again; the silence ends after ALARM_SILENCE_MS.
+    - web: a silence requested from another task is applied at the next tick.
+
+  Usage:
+    g++ -std=c++17 -O2 -Itools/host tools/alarm_sim.cpp -o alarm_sim
+    ./alarm_sim
+
+    The exit status is 1 if a check failed.
+*/
+
+#include <Arduino.h>
+#include <stdio.h>
+#include "../alarm.h"
+
+// Value of an invalid reading.
+const int16_t INVALID = INT16_MIN;
+
+// Thresholds of every sensor, in hundredths of a degree.
+const int32_t MIN_CENTI = 0;
+const int32_t MAX_CENTI = 800;
+
+int failures = 0;
+
+/**
+ * Records a failed check.
+ */
+void check(bool ok, const char* scenario, const char* message) {
+  if (!ok) {
+    printf("  FAIL %s: %s\n", scenario, message);
+    failures++;
+  }
+}
+
+/**
+ * Runs the alarm task for a time.
+ */
+void runFor(unsigned long ms) {
+  unsigned long end = millis() + ms;
+  while ((long)(millis() - end) < 0) {
+    delay(ALARM_TICK_MS);
+    runAlarmOutputs(millis());
+  }
+}
+
+/**
+ * Holds the silence button down for a time.
+ */
+void press(unsigned long ms) {
+  emuPinInputLow[ALARM_BUTTON_PIN] = true;
+  runFor(ms);
+  emuPinInputLow[ALARM_BUTTON_PIN] = false;
+  runFor(200);
+}
+
+/**
+ * Returns the rising edges of the buzzer during a time.
+ */
+uint32_t buzzerRises(unsigned long ms) {
+  uint32_t before = emuPinRises[ALARM_BUZZER_PIN];
+  runFor(ms);
+  return emuPinRises[ALARM_BUZZER_PIN] - before;
+}
+
+/**
+ * Resets the alarm, all sensors in range.
+ */
+void reset() {
+  memset((void*)&alarmState, 0, sizeof(alarmState));
+  defaultAlarmRules();
+  setupAlarmOutputs();
+  runFor(1000);
+}
+
+bool buzzer() {
+  return emuPinLevel[ALARM_BUZZER_PIN] == HIGH;
+}
+
+bool led() {
+  return emuPinLevel[ALARM_LED_PIN] == HIGH;
+}
+
+int main() {
+  reset();
+  const char* s = "latency";
+  updateAlarm(0, 900, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  runFor(ALARM_TICK_MS);
+  check(buzzer() && led(), s, "outputs not on one tick after the reading");
+  check(alarmState.latencyMs <= ALARM_TICK_MS, s, "latency longer than one tick");
+  updateAlarm(0, 500, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  runFor(ALARM_TICK_MS);
+  check(!buzzer() && !led(), s, "outputs not off one tick after the reading returned to range");
+  printf("%-9s raise to output %lu ms\n", s, (unsigned long)alarmState.latencyMs);
+
+  s = "patterns";
+  const uint32_t expected[ALARM_PATTERN_COUNT] = { 0, 1, 10, 40, 1 };
+  for (int p = ALARM_CHIRP; p < ALARM_PATTERN_COUNT; p++) {
+    reset();
+    alarmRules[0].highPattern = p;
+    updateAlarm(0, 900, MIN_CENTI, MAX_CENTI, INVALID, millis());
+    uint32_t rises = buzzerRises(10000);
+    printf("%-9s %-6s %2u buzzer starts in 10 s (expected %u)\n", s, alarmPatternName(p), rises, expected[p]);
+    check(rises == expected[p], s, "wrong number of buzzer starts");
+  }
+
+  s = "priority";
+  reset();
+  updateAlarm(1, -100, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  updateAlarm(2, 900, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  check(buzzerRises(10000) == 40, s, "the fast pattern of the high sensor does not play");
+  updateAlarm(2, 500, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  check(buzzerRises(10000) == 10, s, "the slow pattern of the low sensor does not take over");
+
+  s = "rules";
+  reset();
+  alarmRules[3].lowPattern = ALARM_NONE;
+  updateAlarm(3, -500, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  check(buzzerRises(2000) == 0 && !led(), s, "a threshold mapped to none alarms");
+  updateAlarm(4, 900, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  updateAlarm(4, INVALID, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  check(buzzerRises(2000) == 8, s, "an invalid reading changed the alarm");
+
+  s = "silence";
+  reset();
+  updateAlarm(0, 900, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  runFor(1000);
+  press(ALARM_DEBOUNCE_MS / 2);
+  check(buzzerRises(2000) == 8, s, "a bounce of the button silenced the buzzer");
+  press(100);
+  uint32_t ledBefore = emuPinRises[ALARM_LED_PIN];
+  check(buzzerRises(2000) == 0, s, "the button did not silence the buzzer");
+  check(emuPinRises[ALARM_LED_PIN] - ledBefore == 8, s, "the LED stopped during the silence");
+  updateAlarm(5, -100, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  check(buzzerRises(2000) == 2, s, "a new alarm during the silence does not sound");
+  press(100);
+  check(buzzerRises(ALARM_SILENCE_MS - 10000) == 0, s, "the buzzer sounded during the silence");
+  check(buzzerRises(20000) > 0, s, "the buzzer did not sound again after the silence");
+  check(alarmState.silences == 2, s, "silences not counted");
+
+  s = "web";
+  reset();
+  updateAlarm(0, 900, MIN_CENTI, MAX_CENTI, INVALID, millis());
+  runFor(1000);
+  requestAlarmSilence();
+  runFor(ALARM_TICK_MS);
+  check(!alarmState.buzzerPattern && buzzerRises(2000) == 0, s, "a requested silence was not applied");
+
+  printf("%s\n", failures ? "FAIL" : "ok");
+  return failures > 0 ? 1 : 0;
+}
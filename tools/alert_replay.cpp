@@ -0,0 +1,528 @@
+/*
+  Program: alert_replay.cpp
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+    Replays recorded sample traces through the firmware's alert logic (alert.h) and thermal model
+    (model.h) on a PC, as fast as the traces can be read, and prints every threshold notification
+    and model event that would have been sent, with its time. With two rule configurations it
+    prints only the notifications and events that differ, to see how a change of thresholds
+    would have behaved on real data. It can also build the daily reports (report.h) of the
+    first configuration, to check the minutes out of range and the alerts listed for each day.
+
+    Each sample is processed as loop() does: the reading is checked against the sensor's alert
+    rule (an invalid reading reads as 0 C, as in checkTemperatureAlert()), and valid readings
+    update the sensor's thermal model with the time since the sensor's previous sample.
+
+  Usage:
+    g++ -std=c++17 -O2 tools/alert_replay.cpp -o alert_replay
+    ./alert_replay [-a rules] [-b rules] [-m] [-q] [-r] [-o out.bin] trace...
+
+    -a rules   Rule configuration (default: the firmware defaults, 22 to 25 C and 30 minutes).
+    -b rules   Second rule configuration; only the differences are printed, "-" for
+               notifications of -a only and "+" for those of -b only.
+    -m         Leave out the thermal model events.
+    -q         Print only the summary.
+    -r         Also print the daily report of each UTC day of the trace, closed at midnight as
+               checkReportDay() does and at the last sample for the last day.
+    -o file    Also write all samples read to a binary trace, which replays faster than CSV.
+
+    An alert is closed ("cleared") by the first reading back in range, and the next excursion
+    raises a new one. With the default rules, a trace of 5-minute samples at 23.5 C with two
+    excursions to 30 C (samples 20 to 29 and 120 to 129) prints, with -m:
+      defaults: 6 events, raised 2, repeated 2, cleared 2
+    and with -r -q, both excursions are listed in the report of the day:
+      report 2025-10-18: 2 alerts
+        sensor   0  above 100 min, below 0 min
+        alert 1  sensor   0  2025-10-18 01:40:00 to 2025-10-18 02:30:00
+        alert 2  sensor   0  2025-10-18 10:00:00 to 2025-10-18 10:50:00
+
+  Traces:
+    - CSV (*.csv): one sample per line as "epoch,sensor,celsius", e.g. "1760745600,0,4.25".
+      An empty or "--" reading is invalid. Lines that do not start with a digit are skipped.
+    - Binary (any other name): 8-byte little-endian records of uint32 epoch, int16 hundredths
+      of a degree Celsius (-32768 for invalid), uint8 sensor and a zero byte.
+    Samples of each sensor must be in time order; sensors may be interleaved or in separate files.
+
+  Rules:
+    One "key=value" per line, "#" starts a comment. The keys follow the "/updateSettings" route:
+      minTemperature=22         Default thresholds in Celsius.
+      maxTemperature=25
+      notificationDelay=30      Repeat period in minutes.
+      sensor2.minTemperature=2  Thresholds of a single sensor.
+      sensor2.maxTemperature=8
+
+  Notes:
+    - Sensor groups are not replayed; give the group's own trace instead of its members.
+    - Reports cover sensors 0 to REPORT_MAX_SENSORS - 1 and need the samples in time order
+      across sensors.
+    - The exit status is 1 if a file cannot be read.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "../alert.h"
+#include "../model.h"
+#include "../report.h"
+
+// Number of sensor ids in a trace.
+const int REPLAY_SENSORS = 256;
+
+// Value of an invalid reading, as TEMP_INVALID in temper.h.
+const int16_t REPLAY_INVALID = INT16_MIN;
+
+// Sample of a trace.
+struct TraceSample {
+  uint32_t epoch;
+  int16_t centiC;
+  uint8_t sensor;
+};
+
+// Alert rules of all sensors.
+struct RuleSet {
+  std::string name;
+  AlertRule rules[REPLAY_SENSORS];
+};
+
+// Notification or model event produced by a replay.
+struct ReplayEvent {
+  uint32_t epoch;
+  uint8_t sensor;
+  const char* type;
+  int16_t centiC;
+
+  bool operator<(const ReplayEvent& other) const {
+    if (epoch != other.epoch) {
+      return epoch < other.epoch;
+    }
+    if (sensor != other.sensor) {
+      return sensor < other.sensor;
+    }
+    return strcmp(type, other.type) < 0;
+  }
+
+  bool operator==(const ReplayEvent& other) const {
+    return epoch == other.epoch && sensor == other.sensor && strcmp(type, other.type) == 0;
+  }
+};
+
+// State of one replay.
+struct Replay {
+  RuleSet ruleSet;
+  AlertState alerts[REPLAY_SENSORS];
+  ThermalModel models[REPLAY_SENSORS];
+  uint32_t lastEpoch[REPLAY_SENSORS];
+  std::vector<ReplayEvent> events;
+};
+
+bool includeModel = true;
+
+// Daily report of the first replay, with the ids its alerts get from the firmware.
+bool includeReports = false;
+ReportAccumulator reportAccumulator;
+uint32_t reportLastEpoch = 0;
+uint32_t nextAlertId = 1;
+
+/**
+ * Loads a rule configuration on top of the firmware defaults.
+ *
+ * @return False if the file cannot be read or has an invalid line.
+ */
+bool loadRules(const char* path, RuleSet& ruleSet) {
+  AlertRule defaults = { 22.0f, 25.0f, 1800000UL };
+  ruleSet.name = path ? path : "defaults";
+  std::vector<std::pair<int, std::pair<int, float>>> overrides;
+  if (path != nullptr) {
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+      fprintf(stderr, "alert_replay: cannot read %s\n", path);
+      return false;
+    }
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file)) {
+      lineNumber++;
+      char* comment = strchr(line, '#');
+      if (comment != nullptr) {
+        *comment = '\0';
+      }
+      char key[64];
+      float value;
+      if (sscanf(line, " %63[^= \t] = %f", key, &value) != 2) {
+        if (strspn(line, " \t\r\n") != strlen(line)) {
+          fprintf(stderr, "alert_replay: %s:%d: invalid line\n", path, lineNumber);
+          fclose(file);
+          return false;
+        }
+        continue;
+      }
+      int sensor = -1;
+      char field[64];
+      if (sscanf(key, "sensor%d.%63s", &sensor, field) == 2 && sensor >= 0 && sensor < REPLAY_SENSORS) {
+        strcpy(key, field);
+      }
+      else {
+        sensor = -1;
+      }
+      if (strcmp(key, "minTemperature") == 0 || strcmp(key, "maxTemperature") == 0) {
+        int bound = key[1] == 'a' ? 1 : 0;
+        if (sensor < 0) {
+          (bound ? defaults.maxC : defaults.minC) = value;
+        }
+        else {
+          overrides.push_back({ sensor, { bound, value } });
+        }
+      }
+      else if (strcmp(key, "notificationDelay") == 0 && sensor < 0) {
+        defaults.repeatMs = (unsigned long)(value * 60000.0f);
+      }
+      else {
+        fprintf(stderr, "alert_replay: %s:%d: unknown key %s\n", path, lineNumber, key);
+        fclose(file);
+        return false;
+      }
+    }
+    fclose(file);
+  }
+  for (int i = 0; i < REPLAY_SENSORS; i++) {
+    ruleSet.rules[i] = defaults;
+  }
+  for (const auto& entry : overrides) {
+    AlertRule& rule = ruleSet.rules[entry.first];
+    (entry.second.first ? rule.maxC : rule.minC) = entry.second.second;
+  }
+  return true;
+}
+
+/**
+ * Runs one sample through a replay, as loop() does.
+ *
+ * @return The alert action of the sample.
+ */
+AlertAction replaySample(Replay& replay, const TraceSample& sample) {
+  int sensor = sample.sensor;
+  float tempC = (sample.centiC == REPLAY_INVALID) ? 0.0f : sample.centiC / 100.0f;
+  unsigned long nowMs = (unsigned long)sample.epoch * 1000UL;
+  AlertAction action = updateAlert(replay.alerts[sensor], replay.ruleSet.rules[sensor], tempC, nowMs, sample.epoch);
+  if (action != ALERT_NONE) {
+    replay.events.push_back({ sample.epoch, sample.sensor, alertActionName(action), sample.centiC });
+  }
+
+  if (includeModel && sample.centiC != REPLAY_INVALID && replay.lastEpoch[sensor] != 0) {
+    float dtSec = (float)(sample.epoch - replay.lastEpoch[sensor]);
+    ModelEvent event = updateThermalModel(replay.models[sensor], tempC, dtSec);
+    if (event != MODEL_EVENT_NONE) {
+      replay.events.push_back({ sample.epoch, sample.sensor, thermalModelEventName(event), sample.centiC });
+    }
+  }
+  replay.lastEpoch[sensor] = sample.epoch;
+  return action;
+}
+
+/**
+ * Parses a CSV sample line.
+ *
+ * @return False if the line is not a sample.
+ */
+bool parseCsvSample(const char* line, TraceSample& sample) {
+  if (*line < '0' || *line > '9') {
+    return false;
+  }
+  char* end;
+  unsigned long epoch = strtoul(line, &end, 10);
+  if (*end != ',') {
+    return false;
+  }
+  long sensor = strtol(end + 1, &end, 10);
+  if (*end != ',' || sensor < 0 || sensor >= REPLAY_SENSORS) {
+    return false;
+  }
+  const char* value = end + 1;
+  sample.epoch = (uint32_t)epoch;
+  sample.sensor = (uint8_t)sensor;
+  double celsius = strtod(value, &end);
+  if (end == value || isnan(celsius) || celsius < -327.0 || celsius > 327.0) {
+    sample.centiC = REPLAY_INVALID;
+  }
+  else {
+    sample.centiC = (int16_t)lround(celsius * 100.0);
+  }
+  return true;
+}
+
+/**
+ * Reads a trace and passes each sample to 'handle'.
+ *
+ * @return The number of samples, or -1 if the file cannot be read.
+ */
+template <class Handler>
+long readTrace(const char* path, Handler handle) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "alert_replay: cannot read %s\n", path);
+    return -1;
+  }
+  long count = 0;
+  size_t length = strlen(path);
+  if (length > 4 && strcmp(path + length - 4, ".csv") == 0) {
+    char line[256];
+    TraceSample sample;
+    while (fgets(line, sizeof(line), file)) {
+      if (parseCsvSample(line, sample)) {
+        handle(sample);
+        count++;
+      }
+    }
+  }
+  else {
+    static uint8_t buffer[8 * 8192];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), file)) >= 8) {
+      for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        const uint8_t* record = buffer + i;
+        TraceSample sample;
+        sample.epoch = record[0] | (record[1] << 8) | (record[2] << 16) | ((uint32_t)record[3] << 24);
+        sample.centiC = (int16_t)(record[4] | (record[5] << 8));
+        sample.sensor = record[6];
+        handle(sample);
+        count++;
+      }
+    }
+  }
+  fclose(file);
+  return count;
+}
+
+/**
+ * Formats an epoch as a UTC date and time.
+ */
+const char* formatEpoch(uint32_t epoch) {
+  static char text[32];
+  time_t t = epoch;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &tm);
+  return text;
+}
+
+/**
+ * Prints an event, with a prefix for differences.
+ */
+void printEvent(const char* prefix, const ReplayEvent& event) {
+  if (event.centiC == REPLAY_INVALID) {
+    printf("%s%s  sensor %3d  %-20s --\n", prefix, formatEpoch(event.epoch), event.sensor, event.type);
+  }
+  else {
+    printf("%s%s  sensor %3d  %-20s %.2f C\n", prefix, formatEpoch(event.epoch), event.sensor, event.type, event.centiC / 100.0);
+  }
+}
+
+/**
+ * Returns the UTC date of an epoch as YYYYMMDD, and the UTC hour and start of its day.
+ */
+uint32_t utcDate(uint32_t epoch, int& hour, uint32_t& dayStart) {
+  time_t t = epoch;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  hour = tm.tm_hour;
+  dayStart = epoch - (tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec);
+  return (tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday;
+}
+
+/**
+ * Prints the report of a day: the minutes out of range of each sensor sampled and its alerts.
+ */
+void printReport(const DailyReport& report) {
+  printf("report %04u-%02u-%02u: %u alerts", report.date / 10000, report.date / 100 % 100, report.date % 100, report.alertCount);
+  if (report.droppedAlerts > 0) {
+    printf(", %u dropped", report.droppedAlerts);
+  }
+  printf("\n");
+  for (int i = 0; i < REPORT_MAX_SENSORS; i++) {
+    if (report.sensors[i].used) {
+      printf("  sensor %3d  above %u min, below %u min\n", i, report.sensors[i].minutesAbove, report.sensors[i].minutesBelow);
+    }
+  }
+  for (int a = 0; a < report.alertCount; a++) {
+    const ReportAlert& alert = report.alerts[a];
+    printf("  alert %u  sensor %3d  %s to ", alert.id, alert.sensor, formatEpoch(alert.startEpoch));
+    printf("%s\n", alert.endEpoch != 0 ? formatEpoch(alert.endEpoch) : "open");
+  }
+}
+
+/**
+ * Adds a sample and its alert action to the daily report, as processSamples() and
+ * checkTemperatureAlert() do, closing the previous day at midnight.
+ */
+void reportSample(const Replay& replay, const TraceSample& sample, AlertAction action) {
+  int sensor = sample.sensor;
+  if (sensor >= REPORT_MAX_SENSORS) {
+    return;
+  }
+  int hour;
+  uint32_t dayStart;
+  uint32_t date = utcDate(sample.epoch, hour, dayStart);
+  if (reportAccumulator.date != date) {
+    if (reportAccumulator.date != 0) {
+      static DailyReport report;
+      closeReportDay(reportAccumulator, report, dayStart, REPLAY_INVALID);
+      printReport(report);
+    }
+    startReportDay(reportAccumulator, date, REPLAY_INVALID);
+  }
+  reportLastEpoch = sample.epoch;
+  const AlertRule& rule = replay.ruleSet.rules[sensor];
+  recordReportSample(reportAccumulator, sensor, sample.centiC, (int16_t)lroundf(rule.minC * 100), (int16_t)lroundf(rule.maxC * 100), sample.epoch, hour, REPLAY_INVALID);
+  if (action == ALERT_RAISED) {
+    recordReportAlert(reportAccumulator, nextAlertId++, sensor, sample.epoch);
+  }
+}
+
+/**
+ * Prints the number of events of each type of a replay.
+ */
+void printSummary(const Replay& replay) {
+  std::vector<std::pair<std::string, int>> counts;
+  for (const ReplayEvent& event : replay.events) {
+    auto it = std::find_if(counts.begin(), counts.end(), [&](const std::pair<std::string, int>& c) { return c.first == event.type; });
+    if (it == counts.end()) {
+      counts.push_back({ event.type, 1 });
+    }
+    else {
+      it->second++;
+    }
+  }
+  printf("%s: %zu events", replay.ruleSet.name.c_str(), replay.events.size());
+  for (const auto& c : counts) {
+    printf(", %s %d", c.first.c_str(), c.second);
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  const char* rulesA = nullptr;
+  const char* rulesB = nullptr;
+  const char* output = nullptr;
+  bool quiet = false;
+  std::vector<const char*> traces;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+      rulesA = argv[++i];
+    }
+    else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      rulesB = argv[++i];
+    }
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    }
+    else if (strcmp(argv[i], "-m") == 0) {
+      includeModel = false;
+    }
+    else if (strcmp(argv[i], "-q") == 0) {
+      quiet = true;
+    }
+    else if (strcmp(argv[i], "-r") == 0) {
+      includeReports = true;
+    }
+    else if (argv[i][0] == '-') {
+      fprintf(stderr, "usage: alert_replay [-a rules] [-b rules] [-m] [-q] [-r] [-o out.bin] trace...\n");
+      return 1;
+    }
+    else {
+      traces.push_back(argv[i]);
+    }
+  }
+  if (traces.empty()) {
+    fprintf(stderr, "usage: alert_replay [-a rules] [-b rules] [-m] [-q] [-r] [-o out.bin] trace...\n");
+    return 1;
+  }
+
+  static Replay replays[2];
+  int replayCount = rulesB ? 2 : 1;
+  if (!loadRules(rulesA, replays[0].ruleSet) || (rulesB && !loadRules(rulesB, replays[1].ruleSet))) {
+    return 1;
+  }
+
+  FILE* out = nullptr;
+  if (output != nullptr && (out = fopen(output, "wb")) == nullptr) {
+    fprintf(stderr, "alert_replay: cannot write %s\n", output);
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  long samples = 0;
+  for (const char* path : traces) {
+    long count = readTrace(path, [&](const TraceSample& sample) {
+      for (int r = 0; r < replayCount; r++) {
+        AlertAction action = replaySample(replays[r], sample);
+        if (includeReports && r == 0) {
+          reportSample(replays[r], sample, action);
+        }
+      }
+      if (out != nullptr) {
+        uint8_t record[8] = { (uint8_t)sample.epoch, (uint8_t)(sample.epoch >> 8), (uint8_t)(sample.epoch >> 16), (uint8_t)(sample.epoch >> 24),
+          (uint8_t)sample.centiC, (uint8_t)((uint16_t)sample.centiC >> 8), sample.sensor, 0 };
+        fwrite(record, 1, sizeof(record), out);
+      }
+      });
+    if (count < 0) {
+      return 1;
+    }
+    samples += count;
+  }
+  if (out != nullptr) {
+    fclose(out);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  for (int r = 0; r < replayCount; r++) {
+    std::stable_sort(replays[r].events.begin(), replays[r].events.end());
+  }
+  if (!quiet) {
+    if (replayCount == 1) {
+      for (const ReplayEvent& event : replays[0].events) {
+        printEvent("", event);
+      }
+    }
+    else {
+      const std::vector<ReplayEvent>& a = replays[0].events;
+      const std::vector<ReplayEvent>& b = replays[1].events;
+      size_t i = 0;
+      size_t j = 0;
+      while (i < a.size() || j < b.size()) {
+        if (j >= b.size() || (i < a.size() && a[i] < b[j])) {
+          printEvent("- ", a[i++]);
+        }
+        else if (i >= a.size() || b[j] < a[i]) {
+          printEvent("+ ", b[j++]);
+        }
+        else {
+          i++;
+          j++;
+        }
+      }
+    }
+  }
+
+  if (includeReports && reportAccumulator.date != 0) {
+    static DailyReport report;
+    closeReportDay(reportAccumulator, report, reportLastEpoch, REPLAY_INVALID);
+    printReport(report);
+  }
+
+  printf("%ld samples replayed in %.2f s (%.0f samples/s)\n", samples, seconds, seconds > 0 ? samples / seconds : 0.0);
+  for (int r = 0; r < replayCount; r++) {
+    printSummary(replays[r]);
+  }
+  return 0;
+}
@@ -0,0 +1,457 @@
+/*
+  Program: chain_verify.cpp
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+    Verifies exports of the tamper-evident reading chain (chain.h) offline. Every block's hash is
+    recomputed from its previous hash, sequence number and readings with a software SHA-256, and
+    each block must link to the hash of the block before it. Exports taken at different times may
+    be given together: blocks exported more than once must be identical. Anchors published by the
+    device in its heartbeats and alert webhooks are then checked against the verified blocks,
+    which proves the export matches what the device had stored when it published them.
+
+    It reports the blocks and readings verified, the gaps (blocks not in any export, e.g. when
+    exports were pulled less often than the ring turns over) and every failure:
+    - ALTERED: a block whose hash does not match its content.
+    - BROKEN: a block that does not link to the hash of the previous block.
+    - CONFLICT: two exports of the same block that differ.
+    - ANCHOR: an anchor whose hash differs from the verified block of that sequence number.
+
+  Usage:
+    g++ -std=c++17 -O2 tools/chain_verify.cpp -o chain_verify
+    ./chain_verify [-a log]... [-c out.csv] export...
+    ./chain_verify -s
+
+    -a log     Log of received heartbeats or webhooks, one JSON payload per line; the members
+               "chainSeq" and "chainHash" of each line are checked as an anchor.
+    -c file    Write the verified readings as CSV ("epoch,sensor,celsius"), as read by alert_replay.
+    -s         Self test: builds a chain with chain.h, exports it, verifies it, then checks that an
+               altered reading and a removed block are detected, and that a chain restarted from
+               an older saved head only leaves a gap.
+
+    Exports are the output of "/chain/export?from=<seq>".
+    The exit status is 1 if a check failed or a file cannot be read.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../chain.h"
+
+// SHA-256 round constants.
+static const uint32_t SHA256_K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static uint32_t rotr(uint32_t x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+/**
+ * Processes one 64-byte block of SHA-256.
+ */
+static void sha256Block(uint32_t h[8], const uint8_t* p) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    k = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+/**
+ * Software SHA-256 used by chain.h on the host.
+ */
+void chainSha256(const uint8_t* data, size_t len, uint8_t hash[CHAIN_HASH_SIZE]) {
+  uint32_t h[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+  size_t full = len / 64 * 64;
+  for (size_t i = 0; i < full; i += 64) {
+    sha256Block(h, data + i);
+  }
+  uint8_t tail[128];
+  size_t rest = len - full;
+  memset(tail, 0, sizeof(tail));
+  memcpy(tail, data + full, rest);
+  tail[rest] = 0x80;
+  size_t tailLen = rest + 9 <= 64 ? 64 : 128;
+  uint64_t bits = (uint64_t)len * 8;
+  for (int i = 0; i < 8; i++) {
+    tail[tailLen - 1 - i] = (uint8_t)(bits >> (8 * i));
+  }
+  for (size_t i = 0; i < tailLen; i += 64) {
+    sha256Block(h, tail + i);
+  }
+  for (int i = 0; i < 8; i++) {
+    hash[4 * i] = h[i] >> 24;
+    hash[4 * i + 1] = h[i] >> 16;
+    hash[4 * i + 2] = h[i] >> 8;
+    hash[4 * i + 3] = h[i];
+  }
+}
+
+// A block read from an export.
+struct ExportedBlock {
+  uint32_t seq;
+  std::string prevHex;
+  std::string hashHex;
+  std::vector<ChainRecord> records;
+  uint32_t count;
+  std::string source;
+};
+
+int failures = 0;
+
+/**
+ * Records a failed check.
+ */
+void fail(const char* kind, uint32_t seq, const std::string& detail) {
+  printf("  %-8s block %u: %s\n", kind, (unsigned)seq, detail.c_str());
+  failures++;
+}
+
+/**
+ * Parses 64 hexadecimal digits into a hash.
+ */
+bool parseHash(const std::string& hex, uint8_t hash[CHAIN_HASH_SIZE]) {
+  if (hex.size() != 2 * CHAIN_HASH_SIZE) {
+    return false;
+  }
+  for (int i = 0; i < CHAIN_HASH_SIZE; i++) {
+    char byte[3] = { hex[2 * i], hex[2 * i + 1], 0 };
+    char* end;
+    hash[i] = (uint8_t)strtoul(byte, &end, 16);
+    if (*end != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Adds a block to the verified set, checking it against an earlier export of the same block.
+ */
+void addBlock(std::map<uint32_t, ExportedBlock>& blocks, ExportedBlock& block) {
+  if (block.seq == 0) {
+    return;
+  }
+  auto it = blocks.find(block.seq);
+  if (it == blocks.end()) {
+    blocks[block.seq] = block;
+    return;
+  }
+  const ExportedBlock& other = it->second;
+  bool same = other.prevHex == block.prevHex && other.hashHex == block.hashHex && other.records.size() == block.records.size();
+  for (size_t i = 0; same && i < block.records.size(); i++) {
+    same = memcmp(&other.records[i], &block.records[i], sizeof(ChainRecord)) == 0;
+  }
+  if (!same) {
+    fail("CONFLICT", block.seq, other.source + " and " + block.source + " differ");
+  }
+}
+
+/**
+ * Reads an export from a stream.
+ */
+void readExport(FILE* f, const std::string& source, std::map<uint32_t, ExportedBlock>& blocks) {
+  char line[256];
+  ExportedBlock block;
+  block.seq = 0;
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    if (line[0] == 'B') {
+      addBlock(blocks, block);
+      char prev[80];
+      char hash[80];
+      unsigned seq;
+      unsigned count;
+      block = ExportedBlock();
+      block.seq = 0;
+      if (sscanf(line, "B,%u,%u,%79[0-9a-f],%79[0-9a-f]", &seq, &count, prev, hash) == 4) {
+        block.seq = seq;
+        block.count = count;
+        block.prevHex = prev;
+        block.hashHex = hash;
+        block.source = source;
+      }
+    }
+    else if (line[0] == 'R' && block.seq != 0) {
+      unsigned epoch;
+      unsigned sensor;
+      int centiC;
+      if (sscanf(line, "R,%u,%u,%d", &epoch, &sensor, &centiC) == 3) {
+        ChainRecord r = { epoch, (uint8_t)sensor, 0, (int16_t)centiC };
+        block.records.push_back(r);
+      }
+    }
+  }
+  addBlock(blocks, block);
+}
+
+/**
+ * Verifies the hashes and links of the blocks.
+ *
+ * @return The number of gaps between blocks.
+ */
+int verifyBlocks(const std::map<uint32_t, ExportedBlock>& blocks, bool quiet) {
+  int gaps = 0;
+  const ExportedBlock* previous = nullptr;
+  for (const auto& entry : blocks) {
+    const ExportedBlock& block = entry.second;
+    uint8_t prev[CHAIN_HASH_SIZE];
+    uint8_t stated[CHAIN_HASH_SIZE];
+    uint8_t computed[CHAIN_HASH_SIZE];
+    if (!parseHash(block.prevHex, prev) || !parseHash(block.hashHex, stated) || block.records.size() != block.count) {
+      fail("ALTERED", block.seq, "malformed block");
+      previous = &block;
+      continue;
+    }
+    hashChainBlock(block.seq, prev, block.records.data(), block.count, computed);
+    if (memcmp(computed, stated, CHAIN_HASH_SIZE) != 0) {
+      fail("ALTERED", block.seq, "hash does not match the readings");
+    }
+    if (previous != nullptr && previous->seq + 1 == block.seq && previous->hashHex != block.prevHex) {
+      fail("BROKEN", block.seq, "does not link to block " + std::to_string(previous->seq));
+    }
+    if (previous != nullptr && previous->seq + 1 != block.seq) {
+      gaps++;
+      if (!quiet) {
+        printf("  gap      blocks %u to %u not exported\n", (unsigned)previous->seq + 1, (unsigned)block.seq - 1);
+      }
+    }
+    previous = &block;
+  }
+  return gaps;
+}
+
+/**
+ * Checks the anchors of a log against the verified blocks.
+ *
+ * @return false if the log cannot be read.
+ */
+bool checkAnchors(const char* path, const std::map<uint32_t, ExportedBlock>& blocks, int& checked, int& unverified) {
+  FILE* f = fopen(path, "r");
+  if (f == nullptr) {
+    fprintf(stderr, "chain_verify: cannot read %s\n", path);
+    return false;
+  }
+  static char line[8192];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    const char* seqText = strstr(line, "\"chainSeq\"");
+    const char* hashText = strstr(line, "\"chainHash\"");
+    if (seqText == nullptr || hashText == nullptr) {
+      continue;
+    }
+    uint32_t seq = strtoul(seqText + strlen("\"chainSeq\"") + strspn(seqText + strlen("\"chainSeq\""), " :"), nullptr, 10);
+    const char* quote = strchr(hashText + strlen("\"chainHash\""), '"');
+    if (seq == 0 || quote == nullptr) {
+      continue;
+    }
+    std::string hash(quote + 1, strcspn(quote + 1, "\""));
+    auto it = blocks.find(seq);
+    if (it == blocks.end()) {
+      unverified++;
+      continue;
+    }
+    checked++;
+    if (it->second.hashHex != hash) {
+      fail("ANCHOR", seq, "anchored hash " + hash.substr(0, 16) + "... differs from the export");
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+/**
+ * Exports all the sealed blocks of a chain as text.
+ */
+std::string exportChain(const ChainState& state) {
+  static ChainExport ex;
+  startChainExport(state, ex, 0);
+  std::string text;
+  uint8_t chunk[100];
+  size_t n;
+  while ((n = fillChainExport(state, ex, chunk, sizeof(chunk))) > 0) {
+    text.append((const char*)chunk, n);
+  }
+  return text;
+}
+
+/**
+ * Builds a chain of a few blocks, exports it and checks that the verifier accepts it and detects
+ * an altered reading and a removed block. The chain is also restarted from the head saved at
+ * block 2, as after a reboot with blocks 3 to 5 unsaved: with the export of the first run, the
+ * blocks of the second must leave a gap and no conflict.
+ */
+int selfTest() {
+  static ChainState state;
+  ChainHead head;
+  ChainHead saved;
+  memset(&head, 0, sizeof(head));
+  startChain(state, head);
+  for (int i = 0; i < 5 * CHAIN_BLOCK_RECORDS; i++) {
+    if (appendChainRecord(state, 1760745600 + i * 300, i % 3, 400 + i)) {
+      sealChainBlock(state);
+      if (state.head.seq == 2) {
+        saved = state.head;
+      }
+    }
+  }
+
+  static ChainState rebooted;
+  startChain(rebooted, saved);
+  for (int i = 0; i < 2 * CHAIN_BLOCK_RECORDS; i++) {
+    if (appendChainRecord(rebooted, 1760800000 + i * 300, i % 3, 500 + i)) {
+      sealChainBlock(rebooted);
+    }
+  }
+
+  // Known answer of the hash function.
+  uint8_t hash[CHAIN_HASH_SIZE];
+  char hex[2 * CHAIN_HASH_SIZE + 1];
+  chainSha256((const uint8_t*)"abc", 3, hash);
+  chainHashHex(hash, hex);
+  if (strcmp(hex, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad") != 0) {
+    fail("SHA256", 0, "wrong hash of \"abc\"");
+  }
+
+  std::string text = exportChain(state);
+
+  const char* cases[] = { "intact", "altered", "removed", "reboot" };
+  int expected[] = { 0, 1, 1, 0 };
+  for (int c = 0; c < 4; c++) {
+    std::string variant = text;
+    if (c == 1) {
+      size_t pos = variant.find("R,", variant.find("B,3,"));
+      pos = variant.find('\n', pos) - 1;
+      variant[pos] = variant[pos] == '9' ? '8' : variant[pos] + 1;
+    }
+    if (c == 2) {
+      size_t start = variant.find("B,3,");
+      variant.erase(start, variant.find("B,4,") - start);
+      // Renumber the next block to hide the gap; the sequence number is part of its hash.
+      variant.replace(variant.find("B,4,"), 4, "B,3,");
+    }
+    if (c == 3) {
+      variant += exportChain(rebooted);
+    }
+    FILE* f = fmemopen((void*)variant.data(), variant.size(), "r");
+    std::map<uint32_t, ExportedBlock> blocks;
+    readExport(f, cases[c], blocks);
+    fclose(f);
+    int before = failures;
+    verifyBlocks(blocks, true);
+    int found = failures - before;
+    failures = before;
+    printf("%-8s %zu blocks, %d failures (expected %s)\n", cases[c], blocks.size(), found, expected[c] ? "at least 1" : "0");
+    if ((found > 0) != (expected[c] > 0)) {
+      failures++;
+    }
+  }
+  printf("%s\n", failures ? "FAIL" : "ok");
+  return failures > 0 ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  std::vector<const char*> anchors;
+  std::vector<const char*> exports;
+  const char* csv = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+      anchors.push_back(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      csv = argv[++i];
+    }
+    else if (strcmp(argv[i], "-s") == 0) {
+      return selfTest();
+    }
+    else if (argv[i][0] == '-') {
+      fprintf(stderr, "usage: chain_verify [-a log]... [-c out.csv] export...\n");
+      return 1;
+    }
+    else {
+      exports.push_back(argv[i]);
+    }
+  }
+  if (exports.empty()) {
+    fprintf(stderr, "usage: chain_verify [-a log]... [-c out.csv] export...\n");
+    return 1;
+  }
+
+  bool ok = true;
+  std::map<uint32_t, ExportedBlock> blocks;
+  for (const char* path : exports) {
+    FILE* f = fopen(path, "r");
+    if (f == nullptr) {
+      fprintf(stderr, "chain_verify: cannot read %s\n", path);
+      ok = false;
+      continue;
+    }
+    readExport(f, path, blocks);
+    fclose(f);
+  }
+  int gaps = verifyBlocks(blocks, false);
+  int checked = 0;
+  int unverified = 0;
+  for (const char* path : anchors) {
+    ok = checkAnchors(path, blocks, checked, unverified) && ok;
+  }
+
+  long readings = 0;
+  for (const auto& entry : blocks) {
+    readings += entry.second.records.size();
+  }
+  if (csv != nullptr) {
+    FILE* out = fopen(csv, "w");
+    if (out == nullptr) {
+      fprintf(stderr, "chain_verify: cannot write %s\n", csv);
+      return 1;
+    }
+    for (const auto& entry : blocks) {
+      for (const ChainRecord& r : entry.second.records) {
+        if (r.centiC == INT16_MIN) {
+          fprintf(out, "%u,%u,--\n", (unsigned)r.epoch, (unsigned)r.sensor);
+        }
+        else {
+          fprintf(out, "%u,%u,%.2f\n", (unsigned)r.epoch, (unsigned)r.sensor, r.centiC / 100.0);
+        }
+      }
+    }
+    fclose(out);
+  }
+  if (!blocks.empty()) {
+    printf("blocks %u to %u: %zu blocks, %ld readings, %d gaps\n", (unsigned)blocks.begin()->first, (unsigned)blocks.rbegin()->first, blocks.size(), readings, gaps);
+  }
+  printf("anchors: %d matched, %d outside the exports\n", checked, unverified);
+  printf("%s\n", failures ? "FAIL" : "ok");
+  return (failures > 0 || !ok) ? 1 : 0;
+}
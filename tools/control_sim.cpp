@@ -0,0 +1,262 @@
+/*
+  Program: control_sim.cpp
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+    Host test of the thermostat control (control.h) against a simulated thermal plant: a cold room
+    losing heat to a 25 C ambient through its walls, cooled by a compressor at a fixed rate while
+    the relay is on. The room is read by a probe with a first-order lag and 1/16 C resolution,
+    sampled every 10 seconds, while the controller runs every second as in the firmware. The
+    scenarios are:
+
+    - pid: pull-down from 20 C to a 4 C setpoint, then holding it.
+    - hysteresis: the same with the on/off controller and a 1 C band.
+    - windup: the door is left open for 40 minutes with the relay saturated; after it is closed the
+      undershoot must stay small (anti-windup).
+    - fault: the probe returns invalid readings, then stops updating; the relay must run at the
+      failsafe duty and control must resume when the probe recovers.
+    - jitter: the control period varies by up to +-300 ms and the probe by up to 5 seconds.
+
+    Every scenario checks that the minimum on and off times were never violated. For each it
+    reports the mean and the range of the room temperature once settled, the relay duty, the
+    number of compressor starts and any check that failed.
+
+  Usage:
+    g++ -std=c++17 -O2 tools/control_sim.cpp -o control_sim
+    ./control_sim [-v]
+
+    -v prints the room temperature, the duty and the relay every minute.
+    The exit status is 1 if a check failed.
+
+  Notes:
+    - Time is simulated and runs are reproducible.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../control.h"
+
+// Value of an invalid reading.
+const int16_t INVALID = INT16_MIN;
+
+// Simulated cold room.
+struct Plant {
+  double roomC = 20.0;        // Air temperature
+  double probeC = 20.0;       // Temperature of the probe, lagging the air
+  double ambientC = 25.0;
+  double lossTauS = 7200.0;   // Time constant of the losses through the walls
+  double coolingCPerS = 0.006; // Cooling rate of the compressor
+  double probeTauS = 30.0;    // Time constant of the probe
+
+  void step(double dtS, bool relayOn) {
+    double rate = (ambientC - roomC) / lossTauS - (relayOn ? coolingCPerS : 0.0);
+    roomC += rate * dtS;
+    probeC += (roomC - probeC) * (1.0 - exp(-dtS / probeTauS));
+  }
+
+  // Reading of the probe, rounded to 1/16 C as a DS18B20 at 12 bits.
+  int16_t read() const {
+    return (int16_t)lround(round(probeC * 16.0) / 16.0 * 100.0);
+  }
+};
+
+// Results of a scenario.
+struct SimResult {
+  int failures = 0;
+  int starts = 0;
+  double sumC = 0.0;
+  double minC = 1e9;
+  double maxC = -1e9;
+  long settledSamples = 0;
+  unsigned long onMs = 0;
+  unsigned long totalMs = 0;
+};
+
+// Print the trace every minute.
+bool verbose = false;
+
+/**
+ * Records a failed check.
+ */
+void fail(SimResult& result, const char* scenario, const char* message) {
+  printf("  FAIL %s: %s\n", scenario, message);
+  result.failures++;
+}
+
+// Disturbances of a scenario, by simulated time.
+struct Scenario {
+  const char* name;
+  ControlConfig config;
+  unsigned long durationMs;
+  unsigned long settleMs;          // Statistics are taken after this time
+  unsigned long doorOpenMs;        // Door open from this time (0 if never)
+  unsigned long doorCloseMs;
+  unsigned long invalidFromMs;     // Probe returns invalid readings (0 if never)
+  unsigned long frozenFromMs;      // Probe stops updating (0 if never)
+  unsigned long probeRecoverMs;    // Probe works again
+  long periodJitterMs;             // Largest deviation of the control period
+  long sampleJitterMs;             // Largest delay of a probe sample
+};
+
+/**
+ * Runs a scenario and checks the relay timing.
+ *
+ * @param s The scenario.
+ * @param state Receives the final controller state.
+ * @param faultDuty Receives the relay duty measured while the probe was faulted.
+ */
+SimResult runScenario(const Scenario& s, ControlState& state, double& faultDuty) {
+  SimResult result;
+  Plant plant;
+  srand(12345);
+  unsigned long now = 0;
+  startControl(state, now);
+
+  int16_t reading = plant.read();
+  unsigned long readingMs = 0;
+  unsigned long nextSampleMs = 10000;
+  bool relay = false;
+  unsigned long relayChangedMs = 0;
+  unsigned long faultOnMs = 0;
+  unsigned long faultTotalMs = 0;
+  unsigned long nextTraceMs = 0;
+
+  while (now < s.durationMs) {
+    long jitter = s.periodJitterMs > 0 ? (rand() % (2 * s.periodJitterMs + 1)) - s.periodJitterMs : 0;
+    unsigned long dt = s.config.periodMs + jitter;
+    // Advance the plant in 100 ms steps.
+    for (unsigned long t = 0; t < dt; t += 100) {
+      plant.step(0.1, relay);
+    }
+    now += dt;
+    bool doorOpen = s.doorOpenMs > 0 && now >= s.doorOpenMs && now < s.doorCloseMs;
+    plant.lossTauS = doorOpen ? 600.0 : 7200.0;
+
+    if (now >= nextSampleMs) {
+      bool invalid = s.invalidFromMs > 0 && now >= s.invalidFromMs && now < s.frozenFromMs;
+      bool frozen = s.frozenFromMs > 0 && now >= s.frozenFromMs && now < s.probeRecoverMs;
+      if (!frozen) {
+        reading = invalid ? INVALID : plant.read();
+        readingMs = now;
+      }
+      nextSampleMs = now + 10000 + (s.sampleJitterMs > 0 ? rand() % s.sampleJitterMs : 0);
+    }
+
+    bool on = updateControl(state, s.config, reading, now - readingMs, now, INVALID);
+    recordControlPeriod(state, dt * 1000, s.config.periodMs);
+    if (on != relay) {
+      unsigned long held = now - relayChangedMs;
+      if (relay && held < s.config.minOnMs) {
+        fail(result, s.name, "relay on for less than the minimum on time");
+      }
+      if (!relay && relayChangedMs > 0 && held < s.config.minOffMs) {
+        fail(result, s.name, "relay off for less than the minimum off time");
+      }
+      if (!relay && relayChangedMs == 0 && now < s.config.minOffMs) {
+        fail(result, s.name, "relay switched on before the minimum off time after the start");
+      }
+      if (on) {
+        result.starts++;
+      }
+      relay = on;
+      relayChangedMs = now;
+    }
+
+    // Duty while faulted, after the first full window of the fault.
+    if (s.invalidFromMs > 0 && now >= s.invalidFromMs + s.config.staleMs + s.config.windowMs && now < s.probeRecoverMs) {
+      faultTotalMs += dt;
+      faultOnMs += relay ? dt : 0;
+    }
+    if (now >= s.settleMs && !doorOpen && (s.invalidFromMs == 0 || now < s.invalidFromMs)) {
+      result.sumC += plant.roomC;
+      result.minC = fmin(result.minC, plant.roomC);
+      result.maxC = fmax(result.maxC, plant.roomC);
+      result.settledSamples++;
+      result.totalMs += dt;
+      result.onMs += relay ? dt : 0;
+    }
+    if (verbose && now >= nextTraceMs) {
+      printf("    %7.1f min  room %6.2f C  probe %6.2f C  duty %4d  relay %d%s\n", now / 60000.0, plant.roomC, plant.probeC, (int)state.duty, relay ? 1 : 0, state.faulted ? "  faulted" : "");
+      nextTraceMs += 60000;
+    }
+  }
+  faultDuty = faultTotalMs > 0 ? (double)faultOnMs / faultTotalMs : 0.0;
+  return result;
+}
+
+/**
+ * Prints the results of a scenario.
+ */
+void report(const char* name, const SimResult& result, const ControlState& state) {
+  double mean = result.settledSamples > 0 ? result.sumC / result.settledSamples : NAN;
+  printf("%-11s mean %6.2f C  range %6.2f..%6.2f C  duty %5.1f %%  starts %4d  jitter max %6lu us  %s\n",
+    name, mean, result.minC, result.maxC, result.totalMs > 0 ? 100.0 * result.onMs / result.totalMs : 0.0,
+    result.starts, (unsigned long)state.maxJitterUs, result.failures ? "FAIL" : "ok");
+}
+
+int main(int argc, char** argv) {
+  verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+  const unsigned long MINUTE = 60000;
+  const unsigned long HOUR = 60 * MINUTE;
+  int failures = 0;
+
+  ControlConfig pid = CONTROL_DEFAULTS;
+  pid.mode = CONTROL_PID;
+  ControlConfig hysteresis = CONTROL_DEFAULTS;
+  hysteresis.mode = CONTROL_HYSTERESIS;
+
+  Scenario scenarios[] = {
+    { "pid", pid, 24 * HOUR, 12 * HOUR, 0, 0, 0, 0, 0, 0, 0 },
+    { "hysteresis", hysteresis, 24 * HOUR, 12 * HOUR, 0, 0, 0, 0, 0, 0, 0 },
+    { "windup", pid, 24 * HOUR, 14 * HOUR, 12 * HOUR, 12 * HOUR + 40 * MINUTE, 0, 0, 0, 0, 0 },
+    { "fault", pid, 24 * HOUR, 8 * HOUR, 0, 0, 12 * HOUR, 14 * HOUR, 16 * HOUR, 0, 0 },
+    { "jitter", pid, 24 * HOUR, 12 * HOUR, 0, 0, 0, 0, 0, 300, 5000 },
+  };
+
+  for (const Scenario& s : scenarios) {
+    if (verbose) {
+      printf("%s:\n", s.name);
+    }
+    ControlState state;
+    double faultDuty = 0.0;
+    SimResult result = runScenario(s, state, faultDuty);
+    double mean = result.sumC / result.settledSamples;
+    double target = s.config.setpointCentiC / 100.0;
+
+    if (fabs(mean - target) > 0.5) {
+      fail(result, s.name, "mean temperature more than 0.5 C from the setpoint");
+    }
+    if (result.maxC - result.minC > 4.0) {
+      fail(result, s.name, "temperature range wider than 4 C once settled");
+    }
+    if (strcmp(s.name, "windup") == 0) {
+      // The undershoot after the door closed, when the integral would have wound up.
+      if (result.minC < target - 2.0) {
+        fail(result, s.name, "undershoot of more than 2 C after the door was closed");
+      }
+    }
+    if (strcmp(s.name, "fault") == 0) {
+      double expected = s.config.failsafeDuty / 1000.0;
+      if (fabs(faultDuty - expected) > 0.05) {
+        fail(result, s.name, "relay duty while faulted differs from the failsafe duty");
+      }
+      if (state.faults != 1) {
+        fail(result, s.name, "the fault was not entered exactly once");
+      }
+      if (state.faulted) {
+        fail(result, s.name, "control did not resume after the probe recovered");
+      }
+      printf("%-11s duty while faulted %5.1f %% (failsafe %.1f %%)\n", "", 100.0 * faultDuty, 100.0 * expected);
+    }
+    if (strcmp(s.name, "jitter") == 0 && state.maxJitterUs != 300000) {
+      fail(result, s.name, "control period jitter not measured");
+    }
+    report(s.name, result, state);
+    failures += result.failures;
+  }
+  return failures > 0 ? 1 : 0;
+}
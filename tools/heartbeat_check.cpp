@@ -0,0 +1,237 @@
+/*
+  Program: heartbeat_check.cpp
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+    Checks the heartbeats received from the temperature servers (see heartbeat.h) and flags the
+    devices whose heartbeat is overdue, which are dead, off the network or unable to post. It is
+    meant to run periodically (e.g. from cron) next to the webhook receiver, whose log it reads.
+
+    For each device it reports the time since its last heartbeat, its interval, the heartbeats
+    received, the heartbeats missed (gaps in the sequence numbers), the reboots (the uptime or
+    the sequence number went back), the posts that failed before a heartbeat got through and the
+    lowest free heap reported. A device is overdue when no heartbeat was received for more than
+    the grace factor times its interval.
+
+  Usage:
+    g++ -std=c++17 -O2 tools/heartbeat_check.cpp -o heartbeat_check
+    ./heartbeat_check [-g grace] [-n now] [-e devices] log...
+
+    -g grace    Overdue after this many intervals without a heartbeat (default 2.5, so one failed
+                post is not flagged).
+    -n now      Unix time to check against (default: the current time).
+    -e devices  File of the devices expected to report, one MAC address per line ("#" starts a
+                comment); an expected device that never reported is flagged as missing.
+
+  Logs:
+    One heartbeat payload per line, as posted by the device. A line may be prefixed by the Unix
+    time it was received and a space ("1760745600 {...}"); that time is used in place of the
+    device's own "epoch", so a device with a wrong clock is still checked correctly. Lines that
+    are not heartbeats are skipped. Heartbeats of each device must be in the order received.
+
+  Notes:
+    - The exit status is 1 if a device is overdue or missing, or a file cannot be read.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Heartbeat history of a device.
+struct Device {
+  std::string ip;
+  long long lastSeen = 0;       // Time of the last heartbeat
+  long long interval = 0;       // Interval announced by the last heartbeat, in seconds
+  long long lastSeq = 0;
+  long long lastUptime = 0;
+  long heartbeats = 0;
+  long missed = 0;
+  long reboots = 0;
+  long failedPosts = 0;
+  long long minHeap = -1;
+  long openAlerts = 0;
+  bool expected = false;
+};
+
+/**
+ * Finds the value of a member of a flat JSON object.
+ *
+ * @return A pointer to the first character of the value, or nullptr if the member is missing.
+ */
+const char* findMember(const char* json, const char* key) {
+  std::string quoted = "\"" + std::string(key) + "\"";
+  const char* p = strstr(json, quoted.c_str());
+  if (p == nullptr) {
+    return nullptr;
+  }
+  p += quoted.size();
+  while (*p == ' ' || *p == ':') {
+    p++;
+  }
+  return p;
+}
+
+/**
+ * Reads a numeric member, or returns a default if it is missing.
+ */
+long long numberMember(const char* json, const char* key, long long otherwise) {
+  const char* p = findMember(json, key);
+  return p != nullptr ? strtoll(p, nullptr, 10) : otherwise;
+}
+
+/**
+ * Reads a string member, or returns an empty string if it is missing.
+ */
+std::string stringMember(const char* json, const char* key) {
+  const char* p = findMember(json, key);
+  if (p == nullptr || *p != '"') {
+    return "";
+  }
+  const char* end = strchr(p + 1, '"');
+  return end != nullptr ? std::string(p + 1, end) : "";
+}
+
+/**
+ * Adds a received heartbeat to the history of its device.
+ */
+void addHeartbeat(std::map<std::string, Device>& devices, const char* json, long long received) {
+  std::string mac = stringMember(json, "device");
+  if (mac.empty()) {
+    return;
+  }
+  Device& d = devices[mac];
+  long long seq = numberMember(json, "seq", 0);
+  long long uptime = numberMember(json, "uptime", 0);
+  if (d.heartbeats > 0) {
+    if (uptime < d.lastUptime || seq <= d.lastSeq) {
+      d.reboots++;
+    }
+    else if (seq > d.lastSeq + 1) {
+      d.missed += seq - d.lastSeq - 1;
+    }
+  }
+  d.heartbeats++;
+  d.lastSeq = seq;
+  d.lastUptime = uptime;
+  d.lastSeen = received != 0 ? received : numberMember(json, "epoch", 0);
+  d.interval = numberMember(json, "interval", d.interval);
+  d.ip = stringMember(json, "ip");
+  d.failedPosts += numberMember(json, "failedPosts", 0);
+  d.openAlerts = numberMember(json, "openAlerts", 0);
+  long long heap = numberMember(json, "minHeap", -1);
+  if (heap >= 0 && (d.minHeap < 0 || heap < d.minHeap)) {
+    d.minHeap = heap;
+  }
+}
+
+/**
+ * Reads a log of heartbeats.
+ *
+ * @return false if the file cannot be read.
+ */
+bool readLog(const char* path, std::map<std::string, Device>& devices) {
+  FILE* f = fopen(path, "r");
+  if (f == nullptr) {
+    fprintf(stderr, "heartbeat_check: cannot read %s\n", path);
+    return false;
+  }
+  static char line[8192];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    char* json = strchr(line, '{');
+    if (json == nullptr || strstr(json, "\"heartbeat\"") == nullptr) {
+      continue;
+    }
+    long long received = (line[0] >= '0' && line[0] <= '9') ? strtoll(line, nullptr, 10) : 0;
+    addHeartbeat(devices, json, received);
+  }
+  fclose(f);
+  return true;
+}
+
+/**
+ * Reads the list of expected devices.
+ *
+ * @return false if the file cannot be read.
+ */
+bool readExpected(const char* path, std::map<std::string, Device>& devices) {
+  FILE* f = fopen(path, "r");
+  if (f == nullptr) {
+    fprintf(stderr, "heartbeat_check: cannot read %s\n", path);
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    char mac[64];
+    if (line[0] != '#' && sscanf(line, "%63s", mac) == 1) {
+      devices[mac].expected = true;
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  double grace = 2.5;
+  long long now = (long long)time(nullptr);
+  const char* expected = nullptr;
+  std::vector<const char*> logs;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+      grace = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      now = strtoll(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      expected = argv[++i];
+    }
+    else if (argv[i][0] == '-') {
+      fprintf(stderr, "usage: heartbeat_check [-g grace] [-n now] [-e devices] log...\n");
+      return 1;
+    }
+    else {
+      logs.push_back(argv[i]);
+    }
+  }
+  if (logs.empty() || grace < 1.0) {
+    fprintf(stderr, "usage: heartbeat_check [-g grace] [-n now] [-e devices] log...\n");
+    return 1;
+  }
+
+  std::map<std::string, Device> devices;
+  bool ok = expected == nullptr || readExpected(expected, devices);
+  for (const char* log : logs) {
+    ok = readLog(log, devices) && ok;
+  }
+
+  int flagged = 0;
+  printf("%-17s %-15s %8s %8s %6s %6s %7s %6s %8s %6s  %s\n", "device", "ip", "age s", "interval", "beats", "missed", "reboots", "failed", "min heap", "alerts", "status");
+  for (const auto& entry : devices) {
+    const Device& d = entry.second;
+    const char* status = "ok";
+    if (d.heartbeats == 0) {
+      status = "MISSING";
+    }
+    else if (d.interval > 0 && now - d.lastSeen > (long long)(grace * d.interval)) {
+      status = "OVERDUE";
+    }
+    else if (d.interval == 0) {
+      status = "disabled";
+    }
+    flagged += (strcmp(status, "MISSING") == 0 || strcmp(status, "OVERDUE") == 0) ? 1 : 0;
+    if (d.heartbeats == 0) {
+      printf("%-17s %-15s %8s %8s %6d %6s %7s %6s %8s %6s  %s\n", entry.first.c_str(), "-", "-", "-", 0, "-", "-", "-", "-", "-", status);
+      continue;
+    }
+    printf("%-17s %-15s %8lld %8lld %6ld %6ld %7ld %6ld %8lld %6ld  %s\n", entry.first.c_str(), d.ip.c_str(), now - d.lastSeen,
+      d.interval, d.heartbeats, d.missed, d.reboots, d.failedPosts, d.minHeap, d.openAlerts, status);
+  }
+  printf("%zu devices, %d overdue or missing\n", devices.size(), flagged);
+  return (flagged > 0 || !ok) ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+/*
+  Header: Arduino.h (host)
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  Minimal host replacement for the Arduino core, used to compile the firmware's sensor code and
+  the DallasTemperature library on a PC for the tools in this directory.
+
+  Time is virtual: millis() and micros() return emuMicros, which only advances through delay(),
+  delayMicroseconds() and the emulated bus operations. Runs are therefore deterministic and
+  independent of the speed of the host.
+
+  GPIO is emulated too: digitalWrite() records the level and rising edges of each pin, and
+  digitalRead() returns the level a test applied with emuPinInputLow.
+
+  Notes:
+  - Only what the firmware code under test and DallasTemperature use is provided.
+*/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+using std::min;
+using std::max;
+
+template <class T, class L, class H>
+inline T constrain(T x, L low, H high) {
+  return x < low ? low : (x > high ? high : x);
+}
+
+// Virtual time in microseconds since boot.
+inline uint64_t emuMicros = 0;
+
+inline unsigned long millis() {
+  return (unsigned long)(emuMicros / 1000);
+}
+
+inline unsigned long micros() {
+  return (unsigned long)emuMicros;
+}
+
+inline void delayMicroseconds(unsigned int us) {
+  emuMicros += us;
+}
+
+inline void delay(unsigned long ms) {
+  emuMicros += (uint64_t)ms * 1000;
+}
+
+inline void yield() {
+}
+
+// Emulated GPIO: the level last written to each pin and its rising edges, and the inputs pulled
+// low by a test (inputs read HIGH otherwise, as if pulled up).
+const int EMU_PINS = 40;
+inline uint8_t emuPinLevel[EMU_PINS];
+inline uint32_t emuPinRises[EMU_PINS];
+inline bool emuPinInputLow[EMU_PINS];
+
+inline void pinMode(uint8_t, uint8_t) {
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin >= EMU_PINS) {
+    return;
+  }
+  if (level && !emuPinLevel[pin]) {
+    emuPinRises[pin]++;
+  }
+  emuPinLevel[pin] = level ? HIGH : LOW;
+}
+
+inline int digitalRead(uint8_t pin) {
+  return (pin < EMU_PINS && emuPinInputLow[pin]) ? LOW : HIGH;
+}
+
+#endif
@@ -0,0 +1,633 @@
+/*
+  Header: OneWire.h (host)
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  Host replacement for the OneWire library backed by a bit-level emulation of 1-Wire buses and
+  DS18B20 probes. It has the same interface as the OneWire library, so the DallasTemperature
+  library and the firmware's DS18B20 driver (drivers.h) run on top of it unchanged.
+
+  Every reset, write slot and read slot is passed to the emulated probes, which implement the
+  DS18B20 ROM and function commands as a bit-serial state machine: SEARCH ROM (F0h, with real
+  wired-AND bit collisions), MATCH ROM (55h), SKIP ROM (CCh), READ ROM (33h), CONVERT T (44h),
+  READ SCRATCHPAD (BEh), WRITE SCRATCHPAD (4Eh), READ POWER SUPPLY (B4h), COPY (48h) and RECALL (B8h).
+  Bus slots take their standard-speed duration in virtual time (see Arduino.h).
+
+  Each probe is configured with its ROM code, resolution, power mode, a temperature waveform
+  (base, sine, ramp, step and noise), a conversion time scale and injected faults:
+  - crcErrorRate: probability that a scratchpad read has a flipped bit (caught by the CRC).
+  - dropoutRate: probability that the probe misses a reset and sits out one transaction.
+  - disconnectAtSec / reconnectAtSec: the probe is unplugged between these times and comes back
+    with its power-on scratchpad (85 C) and resolution.
+  A parasite powered probe aborts its conversion, reading 85 C, if the strong pull-up is not
+  held for the whole conversion time.
+
+  Usage:
+  - Add probes with emuAddProbe(pin, config) before the buses are enumerated.
+  - Use OneWire(pin) / begin(pin) as on the device; each pin is a separate emulated bus.
+  - emuBus(pin) gives the bus statistics (resets, slots and bus time).
+
+  Notes:
+  - Random faults and noise use a per-probe seeded generator, so runs are reproducible.
+*/
+
+#ifndef HOST_ONEWIRE_H
+#define HOST_ONEWIRE_H
+
+#include "Arduino.h"
+#include <deque>
+#include <vector>
+
+// Duration of the bus operations at standard speed, in microseconds.
+const unsigned int EMU_RESET_US = 960;
+const unsigned int EMU_WRITE1_US = 65;
+const unsigned int EMU_WRITE0_US = 70;
+const unsigned int EMU_READ_US = 66;
+
+// Power-on value of the temperature register (85 C).
+const int16_t EMU_POWER_ON_RAW = 0x0550;
+
+// Configuration of an emulated DS18B20 probe.
+struct EmuProbeConfig {
+  uint8_t rom[8] = { 0x28, 0, 0, 0, 0, 0, 0, 0 };   // Family 28h and serial number; the CRC byte is computed
+  uint8_t resolution = 12;        // Resolution at power-on, 9 to 12 bits
+  bool parasite = false;          // Parasite powered
+  float baseC = 4.0f;             // Temperature waveform: base
+  float amplitudeC = 0.0f;        //   + amplitude * sin(2 pi t / period)
+  float periodSec = 600.0f;
+  float rampCPerHour = 0.0f;      //   + ramp * t
+  float stepAtSec = -1.0f;        //   + step after stepAtSec (negative: no step)
+  float stepC = 0.0f;
+  float noiseC = 0.0f;            //   + uniform noise in [-noise, noise]
+  float conversionScale = 0.8f;   // Conversion time as a fraction of the datasheet maximum
+  float crcErrorRate = 0.0f;
+  float dropoutRate = 0.0f;
+  float disconnectAtSec = -1.0f;  // Unplugged from this time (negative: never)
+  float reconnectAtSec = -1.0f;   // Plugged in again at this time (negative: never)
+  uint32_t seed = 1;
+};
+
+// Protocol state of a probe.
+enum EmuState {
+  EMU_IDLE,             // Not addressed until the next reset
+  EMU_ROM_COMMAND,
+  EMU_SEARCH,
+  EMU_MATCH,
+  EMU_READ_ROM,
+  EMU_FUNCTION_COMMAND,
+  EMU_READ_SCRATCHPAD,
+  EMU_WRITE_SCRATCHPAD,
+  EMU_CONVERT,          // Read slots report the conversion status
+  EMU_READ_POWER,
+  EMU_DONE              // Read slots return 1
+};
+
+// An emulated DS18B20 probe.
+struct EmuProbe {
+  EmuProbeConfig config;
+  uint8_t scratchpad[9];
+  uint8_t readBuffer[9];          // Scratchpad as sent by the running READ SCRATCHPAD
+  bool absent = false;
+  bool converting = false;
+  uint64_t conversionDoneUs = 0;
+  EmuState state = EMU_IDLE;
+  uint8_t shift = 0;
+  int bits = 0;
+  int searchPhase = 0;
+  uint32_t rng = 1;
+  unsigned long conversions = 0;
+  unsigned long abortedConversions = 0;
+  unsigned long corruptedReads = 0;
+};
+
+// An emulated 1-Wire bus.
+struct EmuBus {
+  uint8_t pin = 0;
+  std::vector<EmuProbe> probes;
+  bool strongPullup = false;      // Power held after write(..., power = 1)
+  uint64_t busyUs = 0;            // Time spent in resets and slots
+  unsigned long resets = 0;
+  unsigned long slots = 0;
+};
+
+// All emulated buses; a deque keeps references valid while buses are added.
+inline std::deque<EmuBus> emuBuses;
+
+/**
+ * Returns the bus on a pin, creating it if needed.
+ */
+inline EmuBus& emuBus(uint8_t pin) {
+  for (EmuBus& bus : emuBuses) {
+    if (bus.pin == pin) {
+      return bus;
+    }
+  }
+  emuBuses.emplace_back();
+  emuBuses.back().pin = pin;
+  return emuBuses.back();
+}
+
+/**
+ * Returns a pseudo-random number in [0, 1) from a probe's generator.
+ */
+inline float emuRandom(EmuProbe& probe) {
+  probe.rng = probe.rng * 1664525UL + 1013904223UL;
+  return (probe.rng >> 8) / 16777216.0f;
+}
+
+/**
+ * Computes the Dallas/Maxim CRC-8 (polynomial x^8 + x^5 + x^4 + 1).
+ */
+inline uint8_t emuCrc8(const uint8_t* data, int length) {
+  uint8_t crc = 0;
+  for (int i = 0; i < length; i++) {
+    uint8_t byte = data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      uint8_t mix = (crc ^ byte) & 0x01;
+      crc >>= 1;
+      if (mix) {
+        crc ^= 0x8C;
+      }
+      byte >>= 1;
+    }
+  }
+  return crc;
+}
+
+/**
+ * Returns the temperature of a probe's waveform at a time, in Celsius.
+ */
+inline float emuTemperature(EmuProbe& probe, double seconds) {
+  const EmuProbeConfig& c = probe.config;
+  double t = c.baseC + c.rampCPerHour * seconds / 3600.0;
+  if (c.amplitudeC != 0.0f && c.periodSec > 0.0f) {
+    t += c.amplitudeC * sin(2.0 * PI * seconds / c.periodSec);
+  }
+  if (c.stepAtSec >= 0.0f && seconds >= c.stepAtSec) {
+    t += c.stepC;
+  }
+  if (c.noiseC > 0.0f) {
+    t += c.noiseC * (2.0f * emuRandom(probe) - 1.0f);
+  }
+  return (float)t;
+}
+
+/**
+ * Returns the current resolution of a probe from its configuration register.
+ */
+inline int emuResolution(const EmuProbe& probe) {
+  return 9 + ((probe.scratchpad[4] >> 5) & 0x03);
+}
+
+/**
+ * Stores a temperature register value and updates the scratchpad CRC.
+ */
+inline void emuSetTemperatureRaw(EmuProbe& probe, int16_t raw) {
+  probe.scratchpad[0] = raw & 0xFF;
+  probe.scratchpad[1] = (raw >> 8) & 0xFF;
+  probe.scratchpad[8] = emuCrc8(probe.scratchpad, 8);
+}
+
+/**
+ * Puts a probe in its power-on state: 85 C, default alarm registers, configured resolution.
+ */
+inline void emuPowerOn(EmuProbe& probe) {
+  probe.scratchpad[2] = 0x4B;
+  probe.scratchpad[3] = 0x46;
+  probe.scratchpad[4] = 0x1F | ((probe.config.resolution - 9) << 5);
+  probe.scratchpad[5] = 0xFF;
+  probe.scratchpad[6] = 0x0C;
+  probe.scratchpad[7] = 0x10;
+  emuSetTemperatureRaw(probe, EMU_POWER_ON_RAW);
+  probe.converting = false;
+  probe.state = EMU_IDLE;
+}
+
+/**
+ * Adds a probe to the bus on a pin. The CRC byte of the ROM code is computed.
+ *
+ * @return The index of the probe on its bus.
+ */
+inline int emuAddProbe(uint8_t pin, const EmuProbeConfig& config) {
+  EmuBus& bus = emuBus(pin);
+  EmuProbe probe;
+  probe.config = config;
+  probe.config.rom[7] = emuCrc8(probe.config.rom, 7);
+  probe.rng = config.seed ? config.seed : 1;
+  emuPowerOn(probe);
+  bus.probes.push_back(probe);
+  return bus.probes.size() - 1;
+}
+
+/**
+ * Brings the probes of a bus up to the current time before a bus operation: unplugs and plugs
+ * in probes, completes finished conversions, and aborts parasite conversions that lose power.
+ */
+inline void emuUpdate(EmuBus& bus) {
+  double seconds = emuMicros / 1e6;
+  for (EmuProbe& probe : bus.probes) {
+    const EmuProbeConfig& c = probe.config;
+    bool absent = c.disconnectAtSec >= 0.0f && seconds >= c.disconnectAtSec && (c.reconnectAtSec < 0.0f || seconds < c.reconnectAtSec);
+    if (absent != probe.absent) {
+      probe.absent = absent;
+      emuPowerOn(probe);
+    }
+    if (!probe.converting) {
+      continue;
+    }
+    if (emuMicros >= probe.conversionDoneUs) {
+      probe.converting = false;
+      int resolution = emuResolution(probe);
+      float t = std::max(-55.0f, std::min(125.0f, emuTemperature(probe, probe.conversionDoneUs / 1e6)));
+      int16_t raw = (int16_t)lroundf(t * 16.0f);
+      raw &= ~((1 << (12 - resolution)) - 1);
+      emuSetTemperatureRaw(probe, raw);
+    }
+    else if (c.parasite) {
+      // The strong pull-up is released by this operation (or was never held): the conversion fails.
+      probe.converting = false;
+      probe.abortedConversions++;
+      emuSetTemperatureRaw(probe, EMU_POWER_ON_RAW);
+    }
+  }
+  bus.strongPullup = false;
+}
+
+/**
+ * Handles a command byte received by a probe.
+ */
+inline void emuCommand(EmuBus& bus, EmuProbe& probe, uint8_t command) {
+  probe.bits = 0;
+  probe.shift = 0;
+  if (probe.state == EMU_ROM_COMMAND) {
+    switch (command) {
+    case 0xF0:
+      probe.state = EMU_SEARCH;
+      probe.searchPhase = 0;
+      break;
+    case 0x55:
+      probe.state = EMU_MATCH;
+      break;
+    case 0xCC:
+      probe.state = EMU_FUNCTION_COMMAND;
+      break;
+    case 0x33:
+      probe.state = EMU_READ_ROM;
+      break;
+    default:
+      probe.state = EMU_IDLE;   // Alarm search and unknown commands: no alarms are emulated
+      break;
+    }
+    return;
+  }
+
+  switch (command) {
+  case 0x44: {
+    static const unsigned long maxUs[] = { 93750, 187500, 375000, 750000 };
+    probe.converting = true;
+    probe.conversions++;
+    probe.conversionDoneUs = emuMicros + (uint64_t)(maxUs[emuResolution(probe) - 9] * probe.config.conversionScale);
+    probe.state = EMU_CONVERT;
+    break;
+  }
+  case 0xBE:
+    memcpy(probe.readBuffer, probe.scratchpad, 9);
+    if (probe.config.crcErrorRate > 0.0f && emuRandom(probe) < probe.config.crcErrorRate) {
+      int bit = (int)(emuRandom(probe) * 64);
+      probe.readBuffer[bit / 8] ^= 1 << (bit % 8);
+      probe.corruptedReads++;
+    }
+    probe.state = EMU_READ_SCRATCHPAD;
+    break;
+  case 0x4E:
+    probe.state = EMU_WRITE_SCRATCHPAD;
+    break;
+  case 0xB4:
+    probe.state = EMU_READ_POWER;
+    break;
+  default:
+    probe.state = EMU_DONE;     // COPY and RECALL complete at once
+    break;
+  }
+}
+
+/**
+ * Passes a bit written by the master to a probe.
+ */
+inline void emuReceiveBit(EmuBus& bus, EmuProbe& probe, uint8_t v) {
+  int index = probe.bits;
+  switch (probe.state) {
+  case EMU_ROM_COMMAND:
+  case EMU_FUNCTION_COMMAND:
+    probe.shift |= v << index;
+    if (++probe.bits == 8) {
+      emuCommand(bus, probe, probe.shift);
+    }
+    break;
+  case EMU_SEARCH:
+    if (probe.searchPhase != 2) {
+      break;
+    }
+    if (v != ((probe.config.rom[index / 8] >> (index % 8)) & 1)) {
+      probe.state = EMU_IDLE;
+      break;
+    }
+    probe.searchPhase = 0;
+    if (++probe.bits == 64) {
+      probe.bits = 0;
+      probe.shift = 0;
+      probe.state = EMU_FUNCTION_COMMAND;
+    }
+    break;
+  case EMU_MATCH:
+    if (v != ((probe.config.rom[index / 8] >> (index % 8)) & 1)) {
+      probe.state = EMU_IDLE;
+      break;
+    }
+    if (++probe.bits == 64) {
+      probe.bits = 0;
+      probe.shift = 0;
+      probe.state = EMU_FUNCTION_COMMAND;
+    }
+    break;
+  case EMU_WRITE_SCRATCHPAD:
+    probe.shift |= v << (index % 8);
+    if (++probe.bits % 8 == 0) {
+      int reg = 2 + (probe.bits / 8) - 1;
+      probe.scratchpad[reg] = (reg == 4) ? ((probe.shift & 0x60) | 0x1F) : probe.shift;
+      probe.scratchpad[8] = emuCrc8(probe.scratchpad, 8);
+      probe.shift = 0;
+      if (reg == 4) {
+        probe.state = EMU_DONE;
+      }
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * Returns the bit a probe drives in a read slot (1 if it leaves the bus released).
+ */
+inline uint8_t emuSendBit(EmuBus& bus, EmuProbe& probe) {
+  int index = probe.bits;
+  switch (probe.state) {
+  case EMU_SEARCH: {
+    uint8_t bit = (probe.config.rom[index / 8] >> (index % 8)) & 1;
+    if (probe.searchPhase == 0) {
+      probe.searchPhase = 1;
+      return bit;
+    }
+    if (probe.searchPhase == 1) {
+      probe.searchPhase = 2;
+      return !bit;
+    }
+    return 1;
+  }
+  case EMU_READ_ROM: {
+    uint8_t bit = (probe.config.rom[index / 8] >> (index % 8)) & 1;
+    if (++probe.bits == 64) {
+      probe.state = EMU_DONE;
+    }
+    return bit;
+  }
+  case EMU_READ_SCRATCHPAD: {
+    uint8_t bit = (probe.readBuffer[index / 8] >> (index % 8)) & 1;
+    if (++probe.bits == 72) {
+      probe.state = EMU_DONE;
+    }
+    return bit;
+  }
+  case EMU_CONVERT:
+    return probe.converting ? 0 : 1;
+  case EMU_READ_POWER:
+    return probe.config.parasite ? 0 : 1;
+  default:
+    return 1;
+  }
+}
+
+/**
+ * Host OneWire class with the interface of the OneWire library, driving an emulated bus.
+ */
+class OneWire {
+public:
+  OneWire() {
+  }
+
+  OneWire(uint8_t pin) {
+    begin(pin);
+  }
+
+  void begin(uint8_t pin) {
+    bus = &emuBus(pin);
+    reset_search();
+  }
+
+  uint8_t reset() {
+    emuUpdate(*bus);
+    emuMicros += EMU_RESET_US;
+    bus->busyUs += EMU_RESET_US;
+    bus->resets++;
+    uint8_t presence = 0;
+    for (EmuProbe& probe : bus->probes) {
+      probe.bits = 0;
+      probe.shift = 0;
+      if (probe.absent || (probe.config.dropoutRate > 0.0f && emuRandom(probe) < probe.config.dropoutRate)) {
+        probe.state = EMU_IDLE;
+        continue;
+      }
+      probe.state = EMU_ROM_COMMAND;
+      presence = 1;
+    }
+    return presence;
+  }
+
+  void write_bit(uint8_t v) {
+    emuUpdate(*bus);
+    advance(v ? EMU_WRITE1_US : EMU_WRITE0_US);
+    for (EmuProbe& probe : bus->probes) {
+      if (probe.state != EMU_IDLE) {
+        emuReceiveBit(*bus, probe, v & 1);
+      }
+    }
+  }
+
+  uint8_t read_bit() {
+    emuUpdate(*bus);
+    advance(EMU_READ_US);
+    uint8_t line = 1;
+    for (EmuProbe& probe : bus->probes) {
+      if (probe.state != EMU_IDLE) {
+        line &= emuSendBit(*bus, probe);
+      }
+    }
+    return line;
+  }
+
+  void write(uint8_t v, uint8_t power = 0) {
+    for (int i = 0; i < 8; i++) {
+      write_bit((v >> i) & 1);
+    }
+    bus->strongPullup = power;
+  }
+
+  void write_bytes(const uint8_t* buf, uint16_t count, bool power = 0) {
+    for (uint16_t i = 0; i < count; i++) {
+      write(buf[i]);
+    }
+    bus->strongPullup = power;
+  }
+
+  uint8_t read() {
+    uint8_t v = 0;
+    for (int i = 0; i < 8; i++) {
+      v |= read_bit() << i;
+    }
+    return v;
+  }
+
+  void read_bytes(uint8_t* buf, uint16_t count) {
+    for (uint16_t i = 0; i < count; i++) {
+      buf[i] = read();
+    }
+  }
+
+  void select(const uint8_t rom[8]) {
+    write(0x55);
+    for (int i = 0; i < 8; i++) {
+      write(rom[i]);
+    }
+  }
+
+  void skip() {
+    write(0xCC);
+  }
+
+  void depower() {
+    emuUpdate(*bus);
+  }
+
+  void reset_search() {
+    lastDiscrepancy = 0;
+    lastDeviceFlag = false;
+    lastFamilyDiscrepancy = 0;
+    memset(romNo, 0, sizeof(romNo));
+  }
+
+  void target_search(uint8_t family_code) {
+    romNo[0] = family_code;
+    memset(romNo + 1, 0, 7);
+    lastDiscrepancy = 64;
+    lastFamilyDiscrepancy = 0;
+    lastDeviceFlag = false;
+  }
+
+  /**
+   * Finds the next device on the bus (Maxim application note 187).
+   */
+  bool search(uint8_t* newAddr, bool search_mode = true) {
+    uint8_t idBitNumber = 1;
+    uint8_t lastZero = 0;
+    uint8_t romByteNumber = 0;
+    uint8_t romByteMask = 1;
+    bool result = false;
+
+    if (!lastDeviceFlag) {
+      if (!reset()) {
+        reset_search();
+        return false;
+      }
+      write(search_mode ? 0xF0 : 0xEC);
+      do {
+        uint8_t idBit = read_bit();
+        uint8_t cmpIdBit = read_bit();
+        if (idBit == 1 && cmpIdBit == 1) {
+          break;
+        }
+        uint8_t direction;
+        if (idBit != cmpIdBit) {
+          direction = idBit;
+        }
+        else {
+          if (idBitNumber < lastDiscrepancy) {
+            direction = (romNo[romByteNumber] & romByteMask) > 0;
+          }
+          else {
+            direction = (idBitNumber == lastDiscrepancy);
+          }
+          if (direction == 0) {
+            lastZero = idBitNumber;
+            if (lastZero < 9) {
+              lastFamilyDiscrepancy = lastZero;
+            }
+          }
+        }
+        if (direction) {
+          romNo[romByteNumber] |= romByteMask;
+        }
+        else {
+          romNo[romByteNumber] &= ~romByteMask;
+        }
+        write_bit(direction);
+        idBitNumber++;
+        romByteMask <<= 1;
+        if (romByteMask == 0) {
+          romByteNumber++;
+          romByteMask = 1;
+        }
+      } while (romByteNumber < 8);
+
+      if (idBitNumber >= 65) {
+        lastDiscrepancy = lastZero;
+        if (lastDiscrepancy == 0) {
+          lastDeviceFlag = true;
+        }
+        result = true;
+      }
+    }
+    if (!result || !romNo[0]) {
+      reset_search();
+      return false;
+    }
+    memcpy(newAddr, romNo, 8);
+    return true;
+  }
+
+  static uint8_t crc8(const uint8_t* addr, uint8_t len) {
+    return emuCrc8(addr, len);
+  }
+
+  static uint16_t crc16(const uint8_t* input, uint16_t len, uint16_t crc = 0) {
+    for (uint16_t i = 0; i < len; i++) {
+      crc ^= input[i];
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+      }
+    }
+    return crc;
+  }
+
+  static bool check_crc16(const uint8_t* input, uint16_t len, const uint8_t* inverted_crc, uint16_t crc = 0) {
+    crc = ~crc16(input, len, crc);
+    return (crc & 0xFF) == inverted_crc[0] && (crc >> 8) == inverted_crc[1];
+  }
+
+private:
+  void advance(unsigned int us) {
+    emuMicros += us;
+    bus->busyUs += us;
+    bus->slots++;
+  }
+
+  EmuBus* bus = nullptr;
+  uint8_t romNo[8];
+  uint8_t lastDiscrepancy = 0;
+  uint8_t lastFamilyDiscrepancy = 0;
+  bool lastDeviceFlag = false;
+};
+
+#endif
@@ -0,0 +1,43 @@
+/*
+  Header: Wire.h (host)
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  Host replacement for the Arduino I2C library with no devices on the bus: every address
+  is NACKed, so the I2C drivers find no sensors.
+*/
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+  bool begin() {
+    return true;
+  }
+  void beginTransmission(uint8_t) {
+  }
+  uint8_t endTransmission(bool = true) {
+    return 2;
+  }
+  size_t write(uint8_t) {
+    return 1;
+  }
+  uint8_t requestFrom(uint8_t, uint8_t) {
+    return 0;
+  }
+  int available() {
+    return 0;
+  }
+  int read() {
+    return -1;
+  }
+};
+
+inline TwoWire Wire;
+
+#endif
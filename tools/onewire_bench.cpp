@@ -0,0 +1,317 @@
+/*
+  Program: onewire_bench.cpp
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+    Host benchmark and fault test of the DS18B20 sampling path. The firmware's sensor drivers
+    (drivers.h) and the DallasTemperature library are compiled on the PC on top of the emulated
+    1-Wire buses of host/OneWire.h, and run through a set of deterministic scenarios:
+
+    - nominal: four probes on one bus.
+    - two-buses: eight probes on two buses; a sample must still take one conversion period.
+    - 9-bit: four probes at 9-bit resolution; readings are truncated to 0.5 C steps.
+    - parasite: a parasite powered bus next to a powered one; no conversion may be aborted.
+    - faults: CRC errors and missed resets; corrupted readings must never be accepted.
+    - hotplug: a probe unplugged and plugged in again and a new probe added, found by the
+      incremental presence scan run between samples as in loop().
+    - hotplug-12bit: a 12-bit probe plugged into a bus that was empty at boot, next to a bus of
+      9-bit probes; its first readings must wait for its full conversion time, not the 94 ms of
+      the resolution found at boot.
+
+    For each scenario it reports the sample time (virtual milliseconds, conversion included),
+    the 1-Wire bus time, invalid readings, the largest error of a valid reading against the
+    emulated temperature, and any check that failed.
+
+  Usage:
+    g++ -std=c++17 -O2 -DONE_WIRE_PIN_LIST=4,16 -Itools/host -I<DallasTemperature> \
+        tools/onewire_bench.cpp <DallasTemperature>/DallasTemperature.cpp -o onewire_bench
+    ./onewire_bench
+
+    <DallasTemperature> is the directory of the Arduino DallasTemperature library.
+    The exit status is 1 if a check failed.
+
+  Notes:
+    - Time is virtual and runs are reproducible; see host/Arduino.h and host/OneWire.h.
+*/
+
+#include <Arduino.h>
+#include <OneWire.h>
+#include <DallasTemperature.h>
+#include <Wire.h>
+#include <stdio.h>
+#include "../drivers.h"
+
+// Pins of the two emulated buses; must match ONE_WIRE_PIN_LIST.
+const uint8_t BUS_A = 4;
+const uint8_t BUS_B = 16;
+
+// Value of an invalid reading in the sample.
+const int16_t INVALID = INT16_MIN;
+
+// Results of a scenario.
+struct BenchResult {
+  int samples = 0;
+  unsigned long totalSampleMs = 0;
+  unsigned long maxSampleMs = 0;
+  unsigned long readings = 0;
+  unsigned long invalid = 0;
+  float maxErrorC = 0.0f;
+  int failures = 0;
+};
+
+/**
+ * Clears the emulated buses, the virtual clock and the scan state of the drivers.
+ */
+void resetBench() {
+  emuBuses.clear();
+  emuMicros = 0;
+  ds18b20ScanBus = 0;
+  ds18b20ScanComparing = false;
+  ds18b20ScanFoundCount = 0;
+  scanDriver = 0;
+}
+
+/**
+ * Returns a probe configuration with a serial number and a slow sine waveform.
+ */
+EmuProbeConfig probeConfig(uint8_t serial, float baseC) {
+  EmuProbeConfig config;
+  config.rom[1] = serial;
+  config.rom[2] = 0xA5;
+  config.baseC = baseC;
+  config.amplitudeC = 2.0f;
+  config.periodSec = 900.0f;
+  config.seed = serial;
+  return config;
+}
+
+/**
+ * Finds the emulated probe with a ROM code.
+ */
+EmuProbe* findProbe(const uint8_t* rom) {
+  for (EmuBus& bus : emuBuses) {
+    for (EmuProbe& probe : bus.probes) {
+      if (memcmp(probe.config.rom, rom, 8) == 0) {
+        return &probe;
+      }
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Reports a failed check.
+ */
+void fail(BenchResult& result, const char* scenario, const char* message) {
+  printf("  FAIL %s: %s\n", scenario, message);
+  result.failures++;
+}
+
+/**
+ * Takes one sample of all channels and checks each valid reading against the emulated waveform.
+ */
+void benchSample(BenchResult& result, const char* scenario, float toleranceC) {
+  int16_t values[DRIVER_MAX_CHANNELS];
+  unsigned long start = millis();
+  sampleDrivers(values, DRIVER_MAX_CHANNELS, INVALID, 0xFFFFFFFFUL);
+  unsigned long elapsed = millis() - start;
+  result.samples++;
+  result.totalSampleMs += elapsed;
+  result.maxSampleMs = max(result.maxSampleMs, elapsed);
+
+  for (int c = 0; c < driverStats[DRIVER_DS18B20].channels; c++) {
+    result.readings++;
+    if (values[c] == INVALID) {
+      result.invalid++;
+      continue;
+    }
+    EmuProbe* probe = findProbe(ds18b20Channels[c].rom);
+    if (probe == nullptr || !ds18b20Channels[c].present) {
+      continue;
+    }
+    EmuProbe copy = *probe;
+    copy.config.noiseC = 0.0f;
+    float expected = emuTemperature(copy, emuMicros / 1e6);
+    float error = fabsf(values[c] / 100.0f - expected);
+    result.maxErrorC = max(result.maxErrorC, error);
+    if (error > toleranceC) {
+      char message[96];
+      snprintf(message, sizeof(message), "channel %d read %.2f C, expected %.2f C", c, values[c] / 100.0f, expected);
+      fail(result, scenario, message);
+    }
+  }
+}
+
+/**
+ * Runs the presence scan in the idle time before the next sample, as loop() does.
+ */
+void benchIdle(unsigned long untilMs, const char* scenario) {
+  while (millis() + 50 < untilMs) {
+    int driver;
+    DriverChange change;
+    unsigned long before = millis();
+    ScanResult scan = scanDrivers(driver, change);
+    if (scan == SCAN_CHANGE) {
+      printf("  %7.2f s  channel %d %s\n", millis() / 1000.0, change.channel, change.added ? "added" : (change.present ? "restored" : "removed"));
+    }
+    if (scan == SCAN_DONE || millis() == before) {
+      delay(min(untilMs - 50 - millis(), 1000UL));
+    }
+  }
+  delay(untilMs > millis() ? untilMs - millis() : 0);
+}
+
+/**
+ * Prints the results of a scenario.
+ */
+void report(const char* scenario, const BenchResult& result) {
+  uint64_t busUs = 0;
+  for (const EmuBus& bus : emuBuses) {
+    busUs += bus.busyUs;
+  }
+  printf("%-10s samples %4d  sample ms avg %6.1f max %4lu  bus ms/sample %6.2f  invalid %4lu/%-5lu  max error %.3f C  %s\n",
+    scenario, result.samples, (double)result.totalSampleMs / max(result.samples, 1), result.maxSampleMs,
+    busUs / 1000.0 / max(result.samples, 1), result.invalid, result.readings, result.maxErrorC,
+    result.failures ? "FAIL" : "ok");
+}
+
+/**
+ * Runs a scenario of 'samples' samples taken every 'periodMs'.
+ */
+int runScenario(const char* scenario, int samples, unsigned long periodMs, float toleranceC) {
+  BenchResult result;
+  beginDrivers();
+  for (int i = 0; i < samples; i++) {
+    unsigned long next = millis() + periodMs;
+    benchSample(result, scenario, toleranceC);
+    benchIdle(next, scenario);
+  }
+  report(scenario, result);
+  return result.failures;
+}
+
+int main() {
+  int failures = 0;
+
+  resetBench();
+  for (int i = 0; i < 4; i++) {
+    emuAddProbe(BUS_A, probeConfig(i + 1, 4.0f + i));
+  }
+  failures += runScenario("nominal", 200, 5000, 0.1f);
+
+  resetBench();
+  for (int i = 0; i < 8; i++) {
+    emuAddProbe(i < 4 ? BUS_A : BUS_B, probeConfig(i + 1, 4.0f + i));
+  }
+  {
+    BenchResult result;
+    beginDrivers();
+    for (int i = 0; i < 100; i++) {
+      unsigned long next = millis() + 5000;
+      benchSample(result, "two-buses", 0.1f);
+      benchIdle(next, "two-buses");
+    }
+    if (result.maxSampleMs > 760) {
+      fail(result, "two-buses", "sample took longer than one conversion period");
+    }
+    report("two-buses", result);
+    failures += result.failures;
+  }
+
+  resetBench();
+  for (int i = 0; i < 4; i++) {
+    EmuProbeConfig config = probeConfig(i + 1, 20.0f);
+    config.resolution = 9;
+    emuAddProbe(BUS_A, config);
+  }
+  failures += runScenario("9-bit", 200, 1000, 0.55f);
+
+  resetBench();
+  for (int i = 0; i < 4; i++) {
+    EmuProbeConfig config = probeConfig(i + 1, -18.0f);
+    config.parasite = true;
+    emuAddProbe(BUS_A, config);
+    emuAddProbe(BUS_B, probeConfig(i + 11, 3.0f));
+  }
+  {
+    BenchResult result;
+    beginDrivers();
+    for (int i = 0; i < 100; i++) {
+      unsigned long next = millis() + 5000;
+      benchSample(result, "parasite", 0.1f);
+      benchIdle(next, "parasite");
+    }
+    for (const EmuProbe& probe : emuBus(BUS_A).probes) {
+      if (probe.abortedConversions > 0) {
+        fail(result, "parasite", "a parasite conversion lost its strong pull-up");
+        break;
+      }
+    }
+    report("parasite", result);
+    failures += result.failures;
+  }
+
+  resetBench();
+  for (int i = 0; i < 6; i++) {
+    EmuProbeConfig config = probeConfig(i + 1, 5.0f);
+    config.crcErrorRate = 0.05f;
+    config.dropoutRate = 0.02f;
+    emuAddProbe(i % 2 ? BUS_B : BUS_A, config);
+  }
+  failures += runScenario("faults", 500, 2000, 0.1f);
+
+  resetBench();
+  for (int i = 0; i < 3; i++) {
+    EmuProbeConfig config = probeConfig(i + 1, 4.0f);
+    if (i == 1) {
+      config.disconnectAtSec = 120.0f;
+      config.reconnectAtSec = 300.0f;
+    }
+    emuAddProbe(BUS_A, config);
+  }
+  {
+    BenchResult result;
+    beginDrivers();
+    for (int i = 0; i < 120; i++) {
+      if (i == 40) {
+        emuAddProbe(BUS_B, probeConfig(9, 6.0f));
+      }
+      unsigned long next = millis() + 5000;
+      benchSample(result, "hotplug", 0.1f);
+      benchIdle(next, "hotplug");
+    }
+    if (driverStats[DRIVER_DS18B20].channels != 4 || !ds18b20Channels[1].present || !ds18b20Channels[3].present) {
+      fail(result, "hotplug", "probes were not tracked across the unplug and the addition");
+    }
+    report("hotplug", result);
+    failures += result.failures;
+  }
+
+  resetBench();
+  for (int i = 0; i < 2; i++) {
+    EmuProbeConfig config = probeConfig(i + 1, 4.0f);
+    config.resolution = 9;
+    emuAddProbe(BUS_A, config);
+  }
+  {
+    BenchResult result;
+    beginDrivers();
+    for (int i = 0; i < 60; i++) {
+      if (i == 20) {
+        emuAddProbe(BUS_B, probeConfig(9, 6.0f));
+      }
+      unsigned long next = millis() + 2000;
+      benchSample(result, "hotplug-12bit", 0.55f);
+      benchIdle(next, "hotplug-12bit");
+    }
+    if (driverStats[DRIVER_DS18B20].channels != 3 || !ds18b20Channels[2].present) {
+      fail(result, "hotplug-12bit", "the new probe was not added");
+    }
+    report("hotplug-12bit", result);
+    failures += result.failures;
+  }
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+/*
+  Header: vote.h
+  Author: Davin Chiupka
+  Date: October 18, 2026
+  Last Updated: October 18, 2026
+
+  Description:
+  This header file provides redundant-probe sensor groups. Critical spaces can be fitted with
+  two or three probes at the same location; a group combines their readings into a single
+  logical sensor whose value is either the median or the majority-voted value of the members.
+
+  - Median: the median of the healthy members (mean of the middle two for an even count).
+  - Vote: the mean of the largest cluster of members agreeing within the tolerance, provided
+    it holds a strict majority of the healthy members; otherwise the median is used.
+
+  A member deviating from the group value by more than the tolerance, or returning no reading,
+  is an outlier. Any outlier among the healthy members is a disagreement, reported once when it
+  starts and once when it ends. A member that is an outlier for GROUP_FAIL_SAMPLES consecutive
+  samples is marked failed and excluded from the group value, and is restored after agreeing
+  again for GROUP_FAIL_SAMPLES consecutive samples.
+
+  Usage:
+  - Fill a SensorGroup with the member mask, mode and tolerance (clearing the rest).
+  - Call updateSensorGroup() once per sample with the latest readings of all sensors.
+  - Report the events returned in GroupUpdate.
+  - Call sensorGroupValue() for a value between samples: it leaves the streaks and events alone.
+
+  Notes:
+  - Readings are in hundredths of a degree; the module does not depend on Arduino types.
+*/
+
+#ifndef VOTE_H
+#define VOTE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Maximum number of sensors a group can draw members from.
+const int GROUP_MAX_INPUTS = 16;
+
+// Consecutive outlier (or agreeing) samples before a member is failed (or restored).
+const uint8_t GROUP_FAIL_SAMPLES = 3;
+
+// How a group combines the readings of its members.
+enum GroupMode {
+  GROUP_MEDIAN,
+  GROUP_VOTE
+};
+
+// Configuration and state of a sensor group.
+struct SensorGroup {
+  uint16_t memberMask;                  // Bit N is set if sensor N is a member
+  GroupMode mode;
+  int16_t tolerance;                    // Largest accepted deviation in hundredths of a degree
+  uint16_t failedMask;                  // Members currently excluded as failed
+  uint16_t outlierMask;                 // Members that were outliers in the last sample
+  uint8_t streak[GROUP_MAX_INPUTS];     // Consecutive samples contradicting each member's failed state
+  uint8_t used;                         // Number of members that contributed to the last value
+  int16_t spread;                       // Largest deviation of a healthy member in the last sample
+  bool disagreeing;                     // A disagreement is currently reported
+};
+
+// Events raised by one update of a group.
+struct GroupUpdate {
+  uint16_t failed;              // Members that were marked failed by this sample
+  uint16_t restored;            // Members that were restored by this sample
+  bool disagreementStarted;
+  bool disagreementEnded;
+};
+
+/**
+ * Returns the name of a group mode, used in JSON output and the settings API.
+ */
+const char* groupModeName(GroupMode mode) {
+  return (mode == GROUP_VOTE) ? "vote" : "median";
+}
+
+/**
+ * Sorts a small array of readings in place (insertion sort).
+ */
+void groupSort(int32_t* values, int count) {
+  for (int i = 1; i < count; i++) {
+    int32_t v = values[i];
+    int j = i - 1;
+    while (j >= 0 && values[j] > v) {
+      values[j + 1] = values[j];
+      j--;
+    }
+    values[j + 1] = v;
+  }
+}
+
+/**
+ * Combines sorted readings according to the group mode.
+ */
+int32_t groupCombine(const SensorGroup& group, const int32_t* sorted, int count) {
+  int32_t median = (count % 2 == 1) ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+  if (group.mode != GROUP_VOTE) {
+    return median;
+  }
+
+  // Largest window of sorted readings spanning at most the tolerance.
+  int bestStart = 0;
+  int bestLength = 0;
+  int start = 0;
+  for (int end = 0; end < count; end++) {
+    while (sorted[end] - sorted[start] > group.tolerance) {
+      start++;
+    }
+    if (end - start + 1 > bestLength) {
+      bestStart = start;
+      bestLength = end - start + 1;
+    }
+  }
+  if (2 * bestLength <= count) {
+    return median;
+  }
+  int32_t sum = 0;
+  for (int i = bestStart; i < bestStart + bestLength; i++) {
+    sum += sorted[i];
+  }
+  return sum / bestLength;
+}
+
+/**
+ * Computes the value of a group from the latest readings without updating its state: the members
+ * failed so far are excluded, unless every healthy member is silent.
+ *
+ * @param group The group.
+ * @param values The latest reading of every sensor in hundredths of a degree.
+ * @param count The number of entries in 'values'.
+ * @param invalid The value marking an invalid reading.
+ * @param used Receives the number of members that contributed to the value.
+ * @return The group value in hundredths of a degree, or 'invalid' if no member has a reading.
+ */
+int32_t sensorGroupValue(const SensorGroup& group, const int16_t* values, int count, int16_t invalid, int& used) {
+  int32_t sorted[GROUP_MAX_INPUTS];
+  int n = 0;
+  for (int i = 0; i < count && i < GROUP_MAX_INPUTS; i++) {
+    if ((group.memberMask & (1 << i)) && !(group.failedMask & (1 << i)) && values[i] != invalid) {
+      sorted[n++] = values[i];
+    }
+  }
+  if (n == 0) {
+    // Every healthy member is silent: fall back to the failed members rather than report nothing.
+    for (int i = 0; i < count && i < GROUP_MAX_INPUTS; i++) {
+      if ((group.memberMask & (1 << i)) && values[i] != invalid) {
+        sorted[n++] = values[i];
+      }
+    }
+  }
+  used = n;
+  if (n == 0) {
+    return invalid;
+  }
+  groupSort(sorted, n);
+  return groupCombine(group, sorted, n);
+}
+
+/**
+ * Updates a group with the latest readings and computes its value.
+ *
+ * @param group The group.
+ * @param values The latest reading of every sensor in hundredths of a degree.
+ * @param count The number of entries in 'values'.
+ * @param invalid The value marking an invalid reading.
+ * @param events Receives the events raised by this sample.
+ * @return The group value in hundredths of a degree, or 'invalid' if no member has a reading.
+ */
+int16_t updateSensorGroup(SensorGroup& group, const int16_t* values, int count, int16_t invalid, GroupUpdate& events) {
+  events.failed = 0;
+  events.restored = 0;
+  events.disagreementStarted = false;
+  events.disagreementEnded = false;
+
+  int used;
+  int32_t value = sensorGroupValue(group, values, count, invalid, used);
+  group.used = used;
+
+  group.outlierMask = 0;
+  group.spread = 0;
+  bool disagreement = false;
+  for (int i = 0; i < count && i < GROUP_MAX_INPUTS; i++) {
+    uint16_t bit = 1 << i;
+    if (!(group.memberMask & bit)) {
+      continue;
+    }
+    bool outlier = (values[i] == invalid) || (value == invalid) || (abs(values[i] - value) > group.tolerance);
+    bool failed = group.failedMask & bit;
+    if (outlier) {
+      group.outlierMask |= bit;
+    }
+    if (!failed && values[i] != invalid && value != invalid) {
+      int32_t deviation = abs(values[i] - value);
+      if (deviation > group.spread) {
+        group.spread = deviation;
+      }
+    }
+    if (!failed && outlier) {
+      disagreement = true;
+    }
+
+    // A streak counts samples contradicting the member's current state.
+    if (outlier != failed) {
+      if (++group.streak[i] >= GROUP_FAIL_SAMPLES) {
+        group.streak[i] = 0;
+        group.failedMask ^= bit;
+        if (failed) {
+          events.restored |= bit;
+        }
+        else {
+          events.failed |= bit;
+        }
+      }
+    }
+    else {
+      group.streak[i] = 0;
+    }
+  }
+
+  if (disagreement && !group.disagreeing) {
+    group.disagreeing = true;
+    events.disagreementStarted = true;
+  }
+  else if (!disagreement && group.disagreeing) {
+    group.disagreeing = false;
+    events.disagreementEnded = true;
+  }
+  return value;
+}
+
+#endif